@@ -0,0 +1,191 @@
+#pragma once
+
+/*
+ * Arduino.h  (host build)
+ *
+ * Minimal stand-in for the Arduino-ESP32 core so that src/main.cpp compiles
+ * and runs on Linux under the PlatformIO "native" environment.
+ *
+ * Only the subset the emulator actually uses is provided:
+ *   - millis() / micros() / delay()  driven by the virtual clock (hal_host.cpp)
+ *   - pinMode() / digitalWrite()     recorded, no hardware behind them
+ *   - Serial                         console (stdout)
+ *   - Serial1, Serial2               NMEA UARTs, each backed by a pseudo-
+ *                                    terminal, with a TX ring draining at the
+ *                                    baud rate
+ *   - String                         the few WString methods main.cpp calls
+ *   - IPAddress                      four octets
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+
+// ---------------------------------------------------------------------------
+// Pins and constants
+// ---------------------------------------------------------------------------
+
+#define LOW     0
+#define HIGH    1
+#define INPUT   0
+#define OUTPUT  1
+
+#ifndef LED_BUILTIN
+#define LED_BUILTIN  12
+#endif
+
+#define SERIAL_8N1  0x800001c
+
+// UART0 (the console), UART1 and UART2, as on the ESP32 and ESP32-S3.
+#define SOC_UART_NUM  3
+
+// ---------------------------------------------------------------------------
+// Time and GPIO
+// ---------------------------------------------------------------------------
+
+uint32_t millis();
+uint32_t micros();
+void     delay(uint32_t ms);
+void     delayMicroseconds(uint32_t us);
+void     yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+
+// ---------------------------------------------------------------------------
+// String — thin wrapper around std::string with the WString API subset
+// ---------------------------------------------------------------------------
+
+class String {
+public:
+    String() {}
+    String(const char* s) : s_(s ? s : "") {}
+    String(const char* s, size_t n) : s_(s, n) {}
+    String(const std::string& s) : s_(s) {}
+
+    unsigned int length() const { return (unsigned int)s_.size(); }
+    const char*  c_str()  const { return s_.c_str(); }
+
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t p = s_.find(c, from);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+
+    bool startsWith(const char* prefix) const { return s_.compare(0, strlen(prefix), prefix) == 0; }
+
+    String substring(unsigned int from) const {
+        return from >= s_.size() ? String() : String(s_.substr(from));
+    }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) { unsigned int t = from; from = to; to = t; }
+        if (from >= s_.size()) return String();
+        return String(s_.substr(from, to - from));
+    }
+
+    void trim() {
+        size_t b = s_.find_first_not_of(" \t\r\n");
+        if (b == std::string::npos) { s_.clear(); return; }
+        size_t e = s_.find_last_not_of(" \t\r\n");
+        s_ = s_.substr(b, e - b + 1);
+    }
+
+    float toFloat() const { return (float)atof(s_.c_str()); }
+    long  toInt()   const { return atol(s_.c_str()); }
+
+    String& operator+=(const String& o) { s_ += o.s_; return *this; }
+    String& operator+=(const char* o)   { s_ += o;    return *this; }
+    String& operator+=(char c)          { s_ += c;    return *this; }
+    bool operator==(const char* o) const { return s_ == o; }
+    bool operator!=(const char* o) const { return s_ != o; }
+
+private:
+    std::string s_;
+};
+
+// ---------------------------------------------------------------------------
+// IPAddress
+// ---------------------------------------------------------------------------
+
+class IPAddress {
+public:
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : b_{a, b, c, d} {}
+
+    uint8_t operator[](int i) const { return b_[i]; }
+
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", b_[0], b_[1], b_[2], b_[3]);
+        return String(buf);
+    }
+
+private:
+    uint8_t b_[4];
+};
+
+// ---------------------------------------------------------------------------
+// HardwareSerial
+// ---------------------------------------------------------------------------
+
+class HardwareSerial {
+public:
+    explicit HardwareSerial(int uart_num) : uart_num_(uart_num) {}
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1,
+               int8_t rxPin = -1, int8_t txPin = -1);
+
+    size_t write(const uint8_t* buf, size_t len);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t println(const char* s = "") { size_t n = print(s); return n + print("\r\n"); }
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+    void   flush();
+
+    // TX ring model: free bytes given what the 8N1 line has not sent yet.
+    size_t setTxBufferSize(size_t size) { tx_ring_ = size; return size; }
+    int    availableForWrite();
+
+    void          updateBaudRate(unsigned long baud);
+    unsigned long baudRate() const { return baud_; }
+
+private:
+    int           uart_num_;
+    unsigned long baud_    = 0;
+    size_t        tx_ring_ = 0;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+// ---------------------------------------------------------------------------
+// ESP — heap figures
+//
+// The host has no fixed heap; it is modelled as HOST_HEAP_SIZE bytes less
+// what malloc() has handed out, with no fragmentation, and the minimum is
+// the lowest value seen by a call rather than a true low-water mark.
+// ---------------------------------------------------------------------------
+
+#ifndef HOST_HEAP_SIZE
+#define HOST_HEAP_SIZE  (256 * 1024)
+#endif
+
+class EspClass {
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMaxAllocHeap() { return getFreeHeap(); }
+    uint32_t getMinFreeHeap();
+
+private:
+    uint32_t min_free_ = HOST_HEAP_SIZE;
+};
+
+extern EspClass ESP;
+
+// Entry points implemented by the sketch.
+void setup();
+void loop();
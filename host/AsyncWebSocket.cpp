@@ -0,0 +1,264 @@
+/*
+ * AsyncWebSocket.cpp  (host build)
+ *
+ * RFC 6455 framing for the WebSocket shim: handshake key, unmasking of
+ * client frames, ping/pong and close.  Messages may be fragmented; each
+ * frame is passed to the event handler as it completes.
+ */
+
+#include "ESPAsyncWebServer.h"
+
+#include <algorithm>
+#include <unistd.h>
+
+// ---------------------------------------------------------------------------
+// Handshake: base64(SHA-1(key + GUID))
+// ---------------------------------------------------------------------------
+
+static uint32_t rol(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+static void sha1(const std::string& msg, uint8_t out[20]) {
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+    std::string m = msg;
+    uint64_t    bits = (uint64_t)msg.size() * 8;
+    m += (char)0x80;
+    while (m.size() % 64 != 56)
+        m += (char)0;
+    for (int i = 7; i >= 0; i--)
+        m += (char)(bits >> (8 * i));
+
+    for (size_t off = 0; off < m.size(); off += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++)
+            w[i] = (uint32_t)(uint8_t)m[off + 4 * i] << 24 | (uint32_t)(uint8_t)m[off + 4 * i + 1] << 16
+                 | (uint32_t)(uint8_t)m[off + 4 * i + 2] << 8 | (uint8_t)m[off + 4 * i + 3];
+        for (int i = 16; i < 80; i++)
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if      (i < 20) { f = (b & c) | (~b & d);           k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                    k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d);  k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                    k = 0xCA62C1D6; }
+            uint32_t t = rol(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rol(b, 30); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    for (int i = 0; i < 20; i++)
+        out[i] = (uint8_t)(h[i / 4] >> (24 - 8 * (i % 4)));
+}
+
+std::string AsyncWebSocket::accept_key(const std::string& key) {
+    static const char B64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint8_t d[21] = {};
+    sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", d);
+
+    std::string out;
+    for (int i = 0; i < 21; i += 3) {
+        uint32_t v = (uint32_t)d[i] << 16 | (uint32_t)d[i + 1] << 8 | d[i + 2];
+        out += B64[(v >> 18) & 63];
+        out += B64[(v >> 12) & 63];
+        out += i + 1 < 20 ? B64[(v >> 6) & 63] : '=';
+        out += i + 2 < 20 ? B64[v & 63] : '=';
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// Sending
+// ---------------------------------------------------------------------------
+
+void AsyncWebSocket::queue(AsyncWebSocketClient* c, uint8_t opcode, const uint8_t* data,
+                           size_t len) {
+    std::string f;
+    f += (char)(0x80 | opcode);
+    if (len < 126) {
+        f += (char)len;
+    } else if (len < 65536) {
+        f += (char)126;
+        f += (char)(len >> 8);
+        f += (char)len;
+    } else {
+        f += (char)127;
+        for (int i = 7; i >= 0; i--)
+            f += (char)((uint64_t)len >> (8 * i));
+    }
+    if (len)
+        f.append((const char*)data, len);
+    c->out_ += f;
+}
+
+static void wake(int fd) {
+    if (fd >= 0) {
+        char    b = 0;
+        ssize_t n = write(fd, &b, 1);    // a full pipe already holds a wake-up
+        (void)n;
+    }
+}
+
+bool AsyncWebSocketClient::binary(const uint8_t* data, size_t len) {
+    {
+        std::lock_guard<std::mutex> g(server_->lock_);
+        if (closing_)
+            return false;
+        server_->queue(this, WS_BINARY, data, len);
+    }
+    wake(server_->wake_fd_);
+    return true;
+}
+
+bool AsyncWebSocketClient::text(const char* message) {
+    {
+        std::lock_guard<std::mutex> g(server_->lock_);
+        if (closing_)
+            return false;
+        server_->queue(this, WS_TEXT, (const uint8_t*)message, strlen(message));
+    }
+    wake(server_->wake_fd_);
+    return true;
+}
+
+void AsyncWebSocketClient::close() {
+    {
+        std::lock_guard<std::mutex> g(server_->lock_);
+        if (closing_)
+            return;
+        server_->queue(this, WS_DISCONNECT, nullptr, 0);
+        closing_ = true;
+    }
+    wake(server_->wake_fd_);
+}
+
+bool AsyncWebSocket::binaryAll(const uint8_t* data, size_t len) {
+    {
+        std::lock_guard<std::mutex> g(lock_);
+        for (AsyncWebSocketClient* c : clients_)
+            if (!c->closing_)
+                queue(c, WS_BINARY, data, len);
+    }
+    wake(wake_fd_);
+    return true;
+}
+
+void AsyncWebSocket::textAll(const char* message) {
+    {
+        std::lock_guard<std::mutex> g(lock_);
+        for (AsyncWebSocketClient* c : clients_)
+            if (!c->closing_)
+                queue(c, WS_TEXT, (const uint8_t*)message, strlen(message));
+    }
+    wake(wake_fd_);
+}
+
+size_t AsyncWebSocket::count() const {
+    std::lock_guard<std::mutex> g(lock_);
+    return clients_.size();
+}
+
+// ---------------------------------------------------------------------------
+// Connection lifetime (event thread)
+// ---------------------------------------------------------------------------
+
+AsyncWebSocketClient* AsyncWebSocket::attach() {
+    AsyncWebSocketClient* c;
+    {
+        std::lock_guard<std::mutex> g(lock_);
+        c = new AsyncWebSocketClient(this, next_id_++);
+        clients_.push_back(c);
+    }
+    if (handler_)
+        handler_(this, c, WS_EVT_CONNECT, nullptr, nullptr, 0);
+    return c;
+}
+
+void AsyncWebSocket::detach(AsyncWebSocketClient* c) {
+    if (handler_)
+        handler_(this, c, WS_EVT_DISCONNECT, nullptr, nullptr, 0);
+    std::lock_guard<std::mutex> g(lock_);
+    clients_.erase(std::find(clients_.begin(), clients_.end(), c));
+    delete c;
+}
+
+bool AsyncWebSocket::take_output(AsyncWebSocketClient* c, std::string* out) {
+    std::lock_guard<std::mutex> g(lock_);
+    *out += c->out_;
+    c->out_.clear();
+    return c->closing_;
+}
+
+// Parse complete frames from the bytes received so far.  False once the
+// connection should close (peer sent a close frame or a bad one).
+bool AsyncWebSocket::feed(AsyncWebSocketClient* c, const char* data, size_t len) {
+    c->in_.append(data, len);
+
+    for (;;) {
+        const std::string& in = c->in_;
+        if (in.size() < 2)
+            return true;
+        uint8_t  b0     = (uint8_t)in[0];
+        uint8_t  b1     = (uint8_t)in[1];
+        size_t   hdr    = 2;
+        uint64_t plen   = b1 & 0x7F;
+        if (plen == 126) {
+            if (in.size() < 4) return true;
+            plen = (uint64_t)(uint8_t)in[2] << 8 | (uint8_t)in[3];
+            hdr  = 4;
+        } else if (plen == 127) {
+            if (in.size() < 10) return true;
+            plen = 0;
+            for (int i = 0; i < 8; i++)
+                plen = plen << 8 | (uint8_t)in[2 + i];
+            hdr = 10;
+        }
+        bool masked = b1 & 0x80;
+        if (!masked)
+            return false;                      // clients must mask
+        if (in.size() < hdr + 4 + plen)
+            return true;
+
+        AwsFrameInfo info = {};
+        info.final  = b0 >> 7;
+        info.opcode = b0 & 0x0F;
+        info.masked = 1;
+        info.len    = plen;
+        memcpy(info.mask, in.data() + hdr, 4);
+        std::string payload = in.substr(hdr + 4, plen);
+        for (size_t i = 0; i < payload.size(); i++)
+            payload[i] ^= info.mask[i % 4];
+        c->in_.erase(0, hdr + 4 + plen);
+
+        switch (info.opcode) {
+        case WS_DISCONNECT: {
+            std::lock_guard<std::mutex> g(lock_);
+            if (!c->closing_)
+                queue(c, WS_DISCONNECT, nullptr, 0);
+            c->closing_ = true;
+            return true;                       // closed once the reply is sent
+        }
+        case WS_PING: {
+            std::lock_guard<std::mutex> g(lock_);
+            queue(c, WS_PONG, (const uint8_t*)payload.data(), payload.size());
+            break;
+        }
+        case WS_PONG:
+            if (handler_)
+                handler_(this, c, WS_EVT_PONG, nullptr, (uint8_t*)&payload[0], payload.size());
+            break;
+        default:
+            if (info.opcode != WS_CONTINUATION) {
+                c->message_opcode_ = info.opcode;
+                c->message_index_  = 0;
+            }
+            info.message_opcode = c->message_opcode_;
+            info.index          = c->message_index_;
+            c->message_index_  += plen;
+            if (handler_)
+                handler_(this, c, WS_EVT_DATA, &info, (uint8_t*)&payload[0], payload.size());
+            break;
+        }
+    }
+}
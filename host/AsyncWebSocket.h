@@ -0,0 +1,118 @@
+#pragma once
+
+/*
+ * AsyncWebSocket.h  (host build)
+ *
+ * WebSocket endpoint with the subset of the ESPAsyncWebServer API that
+ * main.cpp uses: onEvent() for connect / disconnect / data, binary() and
+ * binaryAll() to send, and count().  Registered with
+ * AsyncWebServer::addHandler(); the server performs the upgrade and then
+ * feeds the connection's bytes through here on its event thread.
+ *
+ * As with the library, binary() and binaryAll() may be called from any
+ * thread: the frame is queued and the event thread is woken to send it.
+ * Events are delivered on the event thread.
+ */
+
+#include "Arduino.h"
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class AsyncWebSocket;
+
+enum AwsEventType {
+    WS_EVT_CONNECT,
+    WS_EVT_DISCONNECT,
+    WS_EVT_PING,
+    WS_EVT_PONG,
+    WS_EVT_ERROR,
+    WS_EVT_DATA,
+};
+
+enum AwsFrameType {
+    WS_CONTINUATION = 0x00,
+    WS_TEXT         = 0x01,
+    WS_BINARY       = 0x02,
+    WS_DISCONNECT   = 0x08,
+    WS_PING         = 0x09,
+    WS_PONG         = 0x0A,
+};
+
+// Passed as `arg` with WS_EVT_DATA: which part of which message `data` is.
+struct AwsFrameInfo {
+    uint8_t  message_opcode;   // WS_TEXT or WS_BINARY for the whole message
+    uint32_t num;
+    uint8_t  final;
+    uint8_t  masked;
+    uint8_t  opcode;
+    uint64_t len;              // length of this frame
+    uint8_t  mask[4];
+    uint64_t index;            // offset of `data` within the message
+};
+
+class AsyncWebSocketClient {
+public:
+    uint32_t        id() const     { return id_; }
+    AsyncWebSocket* server() const { return server_; }
+
+    bool binary(const uint8_t* data, size_t len);
+    bool text(const char* message);
+    void close();
+
+private:
+    friend class AsyncWebSocket;
+
+    AsyncWebSocketClient(AsyncWebSocket* server, uint32_t id) : server_(server), id_(id) {}
+
+    AsyncWebSocket* server_;
+    uint32_t        id_;
+    std::string     in_;              // event thread only
+    uint8_t         message_opcode_ = WS_BINARY;
+    uint64_t        message_index_  = 0;
+    std::string     out_;             // guarded by server_->lock_
+    bool            closing_ = false; // ditto
+};
+
+typedef std::function<void(AsyncWebSocket* server, AsyncWebSocketClient* client,
+                           AwsEventType type, void* arg, uint8_t* data, size_t len)>
+    AwsEventHandler;
+
+class AsyncWebSocket : public AsyncWebHandler {
+public:
+    explicit AsyncWebSocket(const char* url) : url_(url) {}
+
+    const char* url() const { return url_.c_str(); }
+    void        onEvent(AwsEventHandler handler) { handler_ = handler; }
+
+    bool   binaryAll(const uint8_t* data, size_t len);
+    void   textAll(const char* message);
+    size_t count() const;
+
+    // The library frees closed clients here; the host shim does so at once.
+    void cleanupClients() {}
+
+    // --- used by AsyncWebServer ---
+
+    // Sec-WebSocket-Accept value for a Sec-WebSocket-Key.
+    static std::string accept_key(const std::string& key);
+
+    AsyncWebSocketClient* attach();
+    bool                  feed(AsyncWebSocketClient* c, const char* data, size_t len);
+    bool                  take_output(AsyncWebSocketClient* c, std::string* out);
+    void                  detach(AsyncWebSocketClient* c);
+    void                  set_wake_fd(int fd) { wake_fd_ = fd; }
+
+private:
+    friend class AsyncWebSocketClient;
+
+    void queue(AsyncWebSocketClient* c, uint8_t opcode, const uint8_t* data, size_t len);
+
+    std::string                        url_;
+    AwsEventHandler                    handler_;
+    mutable std::mutex                 lock_;
+    std::vector<AsyncWebSocketClient*> clients_;
+    uint32_t                           next_id_ = 1;
+    int                                wake_fd_ = -1;
+};
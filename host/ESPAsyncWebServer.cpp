@@ -0,0 +1,484 @@
+/*
+ * ESPAsyncWebServer.cpp  (host build)
+ *
+ * poll()-driven implementation of the async server shim.  Each connection
+ * is a small state machine (head -> body -> response -> closed, or
+ * head -> 101 -> WebSocket frames) advanced whenever its socket is ready;
+ * nothing blocks on one client while others wait.  Good enough for the pages and the API routes; not a general-
+ * purpose HTTP server.
+ */
+
+#include "ESPAsyncWebServer.h"
+#include "hal_host.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <memory>
+#include <netinet/in.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+// Body bytes are passed on in chunks of at most one TCP segment, like the
+// packets AsyncTCP delivers.
+#define ASYNC_BODY_CHUNK  1436
+
+// Largest request head accepted.
+#define ASYNC_HEAD_MAX    4096
+
+struct AsyncWebServer::Conn {
+    int                   fd;
+    std::string           in;                 // head bytes, then plain-post body
+    bool                  head_done = false;
+    bool                  plain_post = false; // body parsed into post params
+    size_t                content_length = 0;
+    size_t                body_seen = 0;
+    const Route*          route = nullptr;
+    AsyncWebServerRequest req;
+    size_t                out_off = 0;
+
+    // WebSocket: `upgrade` is set when the head asks for it, `ws` once the
+    // 101 response has gone out.
+    AsyncWebSocket*       upgrade = nullptr;
+    AsyncWebSocketClient* ws = nullptr;
+    std::string           ws_out;
+    bool                  ws_closing = false;
+};
+
+static const char* status_text(int code) {
+    switch (code) {
+    case 101: return "Switching Protocols";
+    case 200: return "OK";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 413: return "Payload Too Large";
+    case 503: return "Service Unavailable";
+    default:  return "Error";
+    }
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static String url_decode(const std::string& s) {
+    std::string out;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '+') {
+            out += ' ';
+        } else if (s[i] == '%' && i + 2 < s.size()
+                   && hex_digit(s[i + 1]) >= 0 && hex_digit(s[i + 2]) >= 0) {
+            out += (char)(hex_digit(s[i + 1]) * 16 + hex_digit(s[i + 2]));
+            i += 2;
+        } else {
+            out += s[i];
+        }
+    }
+    return String(out);
+}
+
+// "a=1&b=2" -> parameters.  A post body part without '=' is named "body",
+// as the library does for plain posts.
+static void parse_params(const std::string& s, bool post, std::vector<AsyncWebParameter>& out) {
+    size_t p = 0;
+    while (p < s.size()) {
+        size_t amp = s.find('&', p);
+        if (amp == std::string::npos) amp = s.size();
+        std::string part = s.substr(p, amp - p);
+        size_t      eq   = part.find('=');
+        if (eq != std::string::npos)
+            out.emplace_back(url_decode(part.substr(0, eq)), url_decode(part.substr(eq + 1)), post);
+        else if (post)
+            out.emplace_back(String("body"), String(s), post);
+        else if (!part.empty())
+            out.emplace_back(url_decode(part), String(), post);
+        if (post && eq == std::string::npos)
+            break;
+        p = amp + 1;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Request / response
+// ---------------------------------------------------------------------------
+
+void AsyncWebServerResponse::addHeader(const char* name, const char* value) {
+    headers_ += name;
+    headers_ += ": ";
+    headers_ += value;
+    headers_ += "\r\n";
+}
+
+bool AsyncWebServerRequest::hasParam(const char* name, bool post) const {
+    return getParam(name, post) != nullptr;
+}
+
+const AsyncWebParameter* AsyncWebServerRequest::getParam(const char* name, bool post) const {
+    for (const AsyncWebParameter& p : params_)
+        if (p.isPost() == post && strcmp(p.name().c_str(), name) == 0)
+            return &p;
+    return nullptr;
+}
+
+bool AsyncWebServerRequest::hasHeader(const char* name) const {
+    return getHeader(name) != nullptr;
+}
+
+const AsyncWebHeader* AsyncWebServerRequest::getHeader(const char* name) const {
+    for (const AsyncWebHeader& h : headers_)
+        if (strcasecmp(h.name().c_str(), name) == 0)
+            return &h;
+    return nullptr;
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int code, const char* content_type,
+                                                             const char* content) {
+    return beginResponse(code, content_type, (const uint8_t*)content, strlen(content));
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int code, const char* content_type,
+                                                             const uint8_t* content, size_t len) {
+    AsyncWebServerResponse* r = new AsyncWebServerResponse();
+    r->code_ = code;
+    r->type_ = content_type;
+    r->body_.assign((const char*)content, len);
+    return r;
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginChunkedResponse(const char* content_type,
+                                                                    AwsResponseFiller filler) {
+    AsyncWebServerResponse* r = beginResponse(200, content_type, "");
+    uint8_t                 buf[ASYNC_BODY_CHUNK];
+    size_t                  n;
+    while ((n = filler(buf, sizeof(buf), r->body_.size())) > 0)
+        r->body_.append((const char*)buf, n);
+    return r;
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse* r) {
+    if (!response_.empty()) {            // the library also ignores a second send
+        delete r;
+        return;
+    }
+    char hdr[256];
+    snprintf(hdr, sizeof(hdr), "HTTP/1.1 %d %s\r\n", r->code_, status_text(r->code_));
+    response_ = hdr;
+    if (!r->type_.empty())
+        response_ += "Content-Type: " + r->type_ + "\r\n";
+    snprintf(hdr, sizeof(hdr), "Content-Length: %zu\r\nConnection: close\r\n", r->body_.size());
+    response_ += hdr;
+    response_ += r->headers_;
+    response_ += "\r\n";
+    if (method_ != HTTP_HEAD)
+        response_ += r->body_;
+    delete r;
+}
+
+void AsyncWebServerRequest::send(int code, const char* content_type, const char* content) {
+    send(beginResponse(code, content_type, content));
+}
+
+// ---------------------------------------------------------------------------
+// Server
+// ---------------------------------------------------------------------------
+
+void AsyncWebServer::on(const char* uri, WebRequestMethodComposite method,
+                        ArRequestHandlerFunction fn) {
+    routes_.push_back({uri, method, fn, nullptr});
+}
+
+void AsyncWebServer::on(const char* uri, WebRequestMethodComposite method,
+                        ArRequestHandlerFunction fn, ArUploadHandlerFunction upload,
+                        ArBodyHandlerFunction body) {
+    (void)upload;                        // multipart uploads are not used
+    routes_.push_back({uri, method, fn, body});
+}
+
+AsyncWebHandler& AsyncWebServer::addHandler(AsyncWebHandler* handler) {
+    handlers_.push_back(handler);
+    return *handler;
+}
+
+void AsyncWebServer::begin() {
+    int port = hal_http_port(port_);
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(listen_fd_, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd_, 32) < 0) {
+        perror("[host] AsyncWebServer bind");
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return;
+    }
+    fcntl(listen_fd_, F_SETFL, fcntl(listen_fd_, F_GETFL) | O_NONBLOCK);
+    fprintf(stderr, "[host] HTTP on port %d\n", port);
+
+    // WebSocket sends from other threads wake poll() through this pipe.
+    if (pipe(wake_) == 0) {
+        fcntl(wake_[0], F_SETFL, O_NONBLOCK);
+        fcntl(wake_[1], F_SETFL, O_NONBLOCK);
+    }
+    for (AsyncWebHandler* h : handlers_)
+        if (AsyncWebSocket* ws = dynamic_cast<AsyncWebSocket*>(h))
+            ws->set_wake_fd(wake_[1]);
+
+    std::thread(&AsyncWebServer::run, this).detach();
+}
+
+static WebRequestMethodComposite method_from_name(const std::string& m) {
+    if (m == "GET")     return HTTP_GET;
+    if (m == "POST")    return HTTP_POST;
+    if (m == "DELETE")  return HTTP_DELETE;
+    if (m == "PUT")     return HTTP_PUT;
+    if (m == "PATCH")   return HTTP_PATCH;
+    if (m == "HEAD")    return HTTP_HEAD;
+    if (m == "OPTIONS") return HTTP_OPTIONS;
+    return 0;
+}
+
+// Split a request head into method, path, query parameters and headers.
+// False on a malformed or unknown request line.
+static bool parse_head(const std::string& head, WebRequestMethodComposite* method,
+                       std::string* path, size_t* content_length, std::string* content_type,
+                       std::vector<AsyncWebParameter>& params,
+                       std::vector<AsyncWebHeader>& headers) {
+    // "METHOD /path?query HTTP/1.1"
+    size_t sp1 = head.find(' ');
+    size_t sp2 = head.find(' ', sp1 + 1);
+    if (sp1 == std::string::npos || sp2 == std::string::npos)
+        return false;
+    *method = method_from_name(head.substr(0, sp1));
+    std::string target = head.substr(sp1 + 1, sp2 - sp1 - 1);
+    size_t      q      = target.find('?');
+    *path = target.substr(0, q);
+    if (q != std::string::npos)
+        parse_params(target.substr(q + 1), false, params);
+
+    for (size_t p = head.find("\r\n"); p != std::string::npos; ) {
+        size_t      e    = head.find("\r\n", p + 2);
+        std::string line = head.substr(p + 2, e == std::string::npos ? std::string::npos : e - p - 2);
+        size_t      c    = line.find(':');
+        if (c != std::string::npos) {
+            std::string name = line.substr(0, c);
+            size_t      v    = line.find_first_not_of(' ', c + 1);
+            std::string val  = v == std::string::npos ? "" : line.substr(v);
+            if (strcasecmp(name.c_str(), "Content-Length") == 0)
+                *content_length = strtoul(val.c_str(), nullptr, 10);
+            else if (strcasecmp(name.c_str(), "Content-Type") == 0)
+                *content_type = val;
+            headers.emplace_back(String(name), String(val));
+        }
+        p = e;
+    }
+    return *method != 0;
+}
+
+// Read what is available.  Returns false when the connection is finished
+// with (closed by the peer or unusable).
+bool AsyncWebServer::on_readable(Conn& c) {
+    char    buf[ASYNC_BODY_CHUNK];
+    ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+    if (n <= 0)
+        return false;
+    if (c.ws)
+        return c.upgrade->feed(c.ws, buf, (size_t)n);
+
+    const char* body     = buf;
+    size_t      body_len = (size_t)n;
+
+    if (!c.head_done) {
+        c.in.append(buf, n);
+        size_t end = c.in.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            if (c.in.size() > ASYNC_HEAD_MAX) {
+                c.req.send(413, "text/plain", "Request head too large");
+                c.head_done = true;
+            }
+            return true;
+        }
+
+        WebRequestMethodComposite method = 0;
+        std::string               path, type;
+        if (!parse_head(c.in.substr(0, end), &method, &path, &c.content_length,
+                        &type, c.req.params_, c.req.headers_)) {
+            c.req.send(400, "text/plain", "Bad request");
+            c.head_done = true;
+            return true;
+        }
+        c.req.method_ = method;
+        c.req.url_    = String(path);
+        c.req.content_length_ = c.content_length;
+        c.req.content_type_   = String(type);
+        if (upgrade(c, path))
+            return true;
+        for (const Route& r : routes_)
+            if (r.uri == path && (r.method & method)) {
+                c.route = &r;
+                break;
+            }
+        c.plain_post = type.compare(0, 33, "application/x-www-form-urlencoded") == 0
+                    || !c.route || !c.route->body;
+        c.head_done = true;
+
+        // What followed the head in this read is the start of the body.
+        std::string rest = c.in.substr(end + 4);
+        c.in.clear();
+        if (rest.size() > c.content_length)
+            rest.resize(c.content_length);
+        if (!rest.empty()) {
+            if (c.plain_post) {
+                c.in = rest;
+            } else {
+                c.route->body(&c.req, (uint8_t*)&rest[0], rest.size(), 0, c.content_length);
+            }
+            c.body_seen = rest.size();
+        }
+        body_len = 0;
+    }
+
+    if (body_len && c.body_seen < c.content_length && c.req.response_.empty()) {
+        if (body_len > c.content_length - c.body_seen)
+            body_len = c.content_length - c.body_seen;
+        if (c.plain_post)
+            c.in.append(body, body_len);
+        else
+            c.route->body(&c.req, (uint8_t*)body, body_len, c.body_seen, c.content_length);
+        c.body_seen += body_len;
+    }
+
+    if (c.body_seen >= c.content_length && c.req.response_.empty())
+        dispatch(c);
+    return true;
+}
+
+// A GET with Upgrade: websocket for a registered socket: answer 101 and
+// switch the connection over once that has been sent.
+bool AsyncWebServer::upgrade(Conn& c, const std::string& path) {
+    const AsyncWebHeader* up  = c.req.getHeader("Upgrade");
+    const AsyncWebHeader* key = c.req.getHeader("Sec-WebSocket-Key");
+    if (!up || !key || strcasecmp(up->value().c_str(), "websocket") != 0)
+        return false;
+
+    for (AsyncWebHandler* h : handlers_) {
+        AsyncWebSocket* ws = dynamic_cast<AsyncWebSocket*>(h);
+        if (!ws || path != ws->url())
+            continue;
+        c.upgrade       = ws;
+        c.req.response_ = "HTTP/1.1 101 Switching Protocols\r\n"
+                          "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Accept: "
+                        + AsyncWebSocket::accept_key(key->value().c_str()) + "\r\n\r\n";
+        return true;
+    }
+    return false;
+}
+
+// Send what is queued.  False when the connection is done with.
+bool AsyncWebServer::on_writable(Conn& c) {
+    std::string& out = c.ws ? c.ws_out : c.req.response_;
+    ssize_t      n   = ::send(c.fd, out.data() + c.out_off, out.size() - c.out_off, MSG_NOSIGNAL);
+    if (n < 0)
+        return false;
+    c.out_off += n;
+    if (c.out_off < out.size())
+        return true;
+
+    c.out_off = 0;
+    if (c.ws) {
+        c.ws_out.clear();
+        return !c.ws_closing;
+    }
+    if (!c.upgrade)
+        return false;                    // response sent: close
+    c.ws = c.upgrade->attach();
+    return true;
+}
+
+void AsyncWebServer::dispatch(Conn& c) {
+    if (c.plain_post && !c.in.empty())
+        parse_params(c.in, true, c.req.params_);
+    c.in.clear();
+
+    if (c.route)
+        c.route->fn(&c.req);
+    else if (not_found_)
+        not_found_(&c.req);
+    if (c.req.response_.empty())
+        c.req.send(404, "text/plain", "Not found");
+}
+
+void AsyncWebServer::run() {
+    std::vector<std::unique_ptr<Conn>> conns;
+    std::vector<pollfd>                fds;
+
+    for (;;) {
+        // fds[0] listens, fds[1] is the wake pipe, fds[i + 2] is conns[i].
+        fds.clear();
+        fds.push_back({listen_fd_, POLLIN, 0});
+        fds.push_back({wake_[0], POLLIN, 0});
+        for (auto& c : conns) {
+            short ev;
+            if (c->ws) {
+                c->ws_closing = c->upgrade->take_output(c->ws, &c->ws_out);
+                ev = POLLIN | (c->ws_out.empty() ? 0 : POLLOUT);
+            } else {
+                ev = c->req.response_.empty() ? POLLIN : POLLOUT;
+            }
+            fds.push_back({c->fd, ev, 0});
+        }
+        if (poll(fds.data(), fds.size(), 1000) < 0)
+            continue;
+
+        if (fds[1].revents & POLLIN) {
+            char drain[64];
+            while (read(wake_[0], drain, sizeof(drain)) > 0) {}
+        }
+
+        for (size_t i = 0; i < conns.size(); ) {
+            Conn& c    = *conns[i];
+            short ev   = fds[i + 2].revents;
+            bool  keep = true;
+
+            if (ev & (POLLERR | POLLNVAL))
+                keep = false;
+            if (keep && (ev & POLLOUT))
+                keep = on_writable(c);
+            if (keep && (ev & (POLLIN | POLLHUP)) && (c.ws || c.req.response_.empty()))
+                keep = on_readable(c);
+
+            if (keep) {
+                i++;
+                continue;
+            }
+            close(c.fd);
+            if (c.ws)
+                c.upgrade->detach(c.ws);
+            if (c.req.on_disconnect_)
+                c.req.on_disconnect_();
+            conns.erase(conns.begin() + i);
+            fds.erase(fds.begin() + i + 2);
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(listen_fd_, nullptr, nullptr)) >= 0) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                std::unique_ptr<Conn> c(new Conn());
+                c->fd = fd;
+                conns.push_back(std::move(c));
+            }
+        }
+    }
+}
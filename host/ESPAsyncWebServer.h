@@ -0,0 +1,176 @@
+#pragma once
+
+/*
+ * ESPAsyncWebServer.h  (host build)
+ *
+ * Event-driven HTTP/1.1 server with the subset of the ESPAsyncWebServer
+ * API that main.cpp uses: on() with request and body handlers,
+ * onNotFound(), query/post parameters, request headers, responses with
+ * extra headers, chunked responses, onDisconnect(), and WebSocket
+ * endpoints added with addHandler() (AsyncWebSocket.h).  A chunked
+ * response is filled completely when it is sent and goes out with a
+ * Content-Length.
+ *
+ * Like AsyncTCP on the ESP32, all sockets are serviced by one event thread
+ * (poll()) that runs independently of loop() and of the TX timer.  Any
+ * number of connections progress at once; body bytes are handed to the
+ * body handler as they arrive, in chunks of at most one TCP segment.
+ * Every response closes its connection; an upgraded WebSocket stays
+ * open until either side closes it.
+ *
+ * The port given to the constructor is offset by the host HAL
+ * (--http-port) so that port 80 does not need root.
+ */
+
+#include "Arduino.h"
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum WebRequestMethod : uint8_t {
+    HTTP_GET     = 0b00000001,
+    HTTP_POST    = 0b00000010,
+    HTTP_DELETE  = 0b00000100,
+    HTTP_PUT     = 0b00001000,
+    HTTP_PATCH   = 0b00010000,
+    HTTP_HEAD    = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY     = 0b01111111,
+};
+typedef uint8_t WebRequestMethodComposite;
+
+// Base of the handlers accepted by addHandler().
+class AsyncWebHandler {
+public:
+    virtual ~AsyncWebHandler() {}
+};
+
+class AsyncWebParameter {
+public:
+    AsyncWebParameter(const String& name, const String& value, bool post)
+        : name_(name), value_(value), post_(post) {}
+    const String& name()  const { return name_; }
+    const String& value() const { return value_; }
+    bool          isPost() const { return post_; }
+
+private:
+    String name_;
+    String value_;
+    bool   post_;
+};
+
+class AsyncWebHeader {
+public:
+    AsyncWebHeader(const String& name, const String& value) : name_(name), value_(value) {}
+    const String& name()  const { return name_; }
+    const String& value() const { return value_; }
+
+private:
+    String name_;
+    String value_;
+};
+
+class AsyncWebServerResponse {
+public:
+    void addHeader(const char* name, const char* value);
+
+private:
+    friend class AsyncWebServerRequest;
+    int         code_ = 200;
+    std::string type_;
+    std::string body_;
+    std::string headers_;
+};
+
+// Fills `buffer` with up to `max_len` bytes of a chunked response starting
+// at byte `index`; returns the number written, 0 at the end.
+typedef std::function<size_t(uint8_t* buffer, size_t max_len, size_t index)> AwsResponseFiller;
+
+class AsyncWebServerRequest {
+public:
+    WebRequestMethodComposite method() const { return method_; }
+    const String&             url()    const { return url_; }
+    size_t                    contentLength() const { return content_length_; }
+    const String&             contentType()   const { return content_type_; }
+
+    // Query parameters, or with post=true form-encoded body parameters.
+    bool                     hasParam(const char* name, bool post = false) const;
+    const AsyncWebParameter* getParam(const char* name, bool post = false) const;
+
+    bool                  hasHeader(const char* name) const;
+    const AsyncWebHeader* getHeader(const char* name) const;
+
+    AsyncWebServerResponse* beginResponse(int code, const char* content_type = "",
+                                          const char* content = "");
+    AsyncWebServerResponse* beginResponse(int code, const char* content_type,
+                                          const uint8_t* content, size_t len);
+    AsyncWebServerResponse* beginChunkedResponse(const char* content_type,
+                                                 AwsResponseFiller filler);
+    void send(AsyncWebServerResponse* response);
+    void send(int code, const char* content_type = "", const char* content = "");
+    void send(int code, const char* content_type, const String& content) {
+        send(code, content_type, content.c_str());
+    }
+
+    // Called when the connection closes, after a response or not.
+    void onDisconnect(std::function<void(void)> fn) { on_disconnect_ = fn; }
+
+    void* _tempObject = nullptr;
+
+private:
+    friend class AsyncWebServer;
+
+    WebRequestMethodComposite      method_ = HTTP_GET;
+    String                         url_;
+    size_t                         content_length_ = 0;
+    String                         content_type_;
+    std::vector<AsyncWebParameter> params_;
+    std::vector<AsyncWebHeader>    headers_;
+    std::string                    response_;     // serialised, empty until send()
+    std::function<void(void)>      on_disconnect_;
+};
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, const String& filename, size_t index,
+                           uint8_t* data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, uint8_t* data, size_t len,
+                           size_t index, size_t total)> ArBodyHandlerFunction;
+
+class AsyncWebServer {
+public:
+    explicit AsyncWebServer(uint16_t port) : port_(port) {}
+
+    void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction fn);
+    void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction fn,
+            ArUploadHandlerFunction upload, ArBodyHandlerFunction body);
+    void onNotFound(ArRequestHandlerFunction fn) { not_found_ = fn; }
+    AsyncWebHandler& addHandler(AsyncWebHandler* handler);
+
+    // Bind and start the event thread.
+    void begin();
+
+private:
+    struct Route {
+        std::string               uri;
+        WebRequestMethodComposite method;
+        ArRequestHandlerFunction  fn;
+        ArBodyHandlerFunction     body;
+    };
+    struct Conn;
+
+    void run();
+    bool on_readable(Conn& c);
+    bool on_writable(Conn& c);
+    bool upgrade(Conn& c, const std::string& path);
+    void dispatch(Conn& c);
+
+    uint16_t                      port_;
+    int                           listen_fd_ = -1;
+    int                           wake_[2]   = { -1, -1 };   // pipe: send queued
+    std::vector<Route>            routes_;
+    std::vector<AsyncWebHandler*> handlers_;
+    ArRequestHandlerFunction      not_found_;
+};
+
+#include "AsyncWebSocket.h"
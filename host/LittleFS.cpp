@@ -0,0 +1,299 @@
+/*
+ * LittleFS.cpp  (host build)
+ *
+ * RAM filesystem with optional directory backing — see LittleFS.h.
+ */
+
+#include "LittleFS.h"
+#include "hal_host.h"
+
+#include <dirent.h>
+#include <map>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+
+fs::LittleFSFS LittleFS;
+
+// "spiffs" data partition of the default 4 MB table (1.375 MB); LittleFS
+// keeps a few blocks for itself.
+static const size_t FS_TOTAL = 0x160000;
+static const size_t FS_SPARE = 8 * 4096;
+
+typedef std::shared_ptr<std::string> Content;
+
+static std::mutex                     fs_lock;
+static std::map<std::string, Content> files;     // full path -> bytes
+static bool                           mounted = false;
+
+struct fs::File::Impl {
+    std::string              path;
+    Content                  data;               // nullptr for a directory
+    size_t                   pos      = 0;
+    bool                     writable = false;
+    std::vector<std::string> entries;            // directory: child paths
+    size_t                   next     = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Directory backing (--fs)
+// ---------------------------------------------------------------------------
+
+static void load_dir(const std::string& root, const std::string& rel) {
+    DIR* d = opendir((root + rel).c_str());
+    if (!d)
+        return;
+    while (dirent* e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name == "." || name == "..")
+            continue;
+        std::string path = rel + "/" + name;
+        struct stat st;
+        if (stat((root + path).c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode)) {
+            load_dir(root, path);
+        } else if (FILE* f = fopen((root + path).c_str(), "rb")) {
+            Content c = std::make_shared<std::string>(st.st_size, '\0');
+            size_t  n = fread(&(*c)[0], 1, c->size(), f);
+            c->resize(n);
+            fclose(f);
+            files[path] = c;
+        }
+    }
+    closedir(d);
+}
+
+static void store_file(const std::string& path, const std::string& data) {
+    const char* root = hal_fs_path();
+    if (!root)
+        return;
+    std::string full = root + path;
+    for (size_t p = strlen(root) + 1; (p = full.find('/', p)) != std::string::npos; p++)
+        ::mkdir(full.substr(0, p).c_str(), 0755);
+    if (FILE* f = fopen(full.c_str(), "wb")) {
+        fwrite(data.data(), 1, data.size(), f);
+        fclose(f);
+    }
+}
+
+static void unlink_file(const std::string& path) {
+    if (const char* root = hal_fs_path())
+        ::unlink((root + path).c_str());
+}
+
+static size_t used_locked() {
+    size_t used = FS_SPARE;
+    for (const auto& kv : files)
+        used += (kv.second->size() + 4095) / 4096 * 4096;
+    return used;
+}
+
+// "/a//b/" -> "/a/b"
+static std::string normalise(const char* path) {
+    std::string out;
+    for (const char* p = path; *p; p++)
+        if (*p != '/' || (!out.empty() && out.back() != '/'))
+            out += *p;
+        else if (out.empty())
+            out += '/';
+    if (out.empty() || out[0] != '/')
+        out = "/" + out;
+    if (out.size() > 1 && out.back() == '/')
+        out.pop_back();
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// LittleFSFS
+// ---------------------------------------------------------------------------
+
+namespace fs {
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles,
+                       const char* partitionLabel) {
+    (void)formatOnFail; (void)basePath; (void)maxOpenFiles; (void)partitionLabel;
+    std::lock_guard<std::mutex> g(fs_lock);
+    if (!mounted && hal_fs_path())
+        load_dir(hal_fs_path(), "");
+    mounted = true;
+    return true;
+}
+
+bool LittleFSFS::format() {
+    std::lock_guard<std::mutex> g(fs_lock);
+    for (const auto& kv : files)
+        unlink_file(kv.first);
+    files.clear();
+    return true;
+}
+
+File LittleFSFS::open(const char* path, const char* mode, bool create) {
+    (void)create;
+    std::string p = normalise(path);
+    File        f;
+    std::lock_guard<std::mutex> g(fs_lock);
+    auto it = files.find(p);
+
+    if (mode[0] == 'r') {
+        if (it != files.end()) {
+            f.impl_       = std::make_shared<File::Impl>();
+            f.impl_->path = p;
+            f.impl_->data = it->second;
+            return f;
+        }
+        // A directory if any file lives below it.
+        std::string prefix = p == "/" ? "/" : p + "/";
+        std::vector<std::string> children;
+        for (const auto& kv : files) {
+            if (kv.first.compare(0, prefix.size(), prefix) != 0)
+                continue;
+            size_t      slash = kv.first.find('/', prefix.size());
+            std::string child = kv.first.substr(0, slash);
+            if (children.empty() || children.back() != child)
+                children.push_back(child);
+        }
+        if (children.empty() && p != "/")
+            return f;
+        f.impl_          = std::make_shared<File::Impl>();
+        f.impl_->path    = p;
+        f.impl_->entries = children;
+        return f;
+    }
+
+    // "w" truncates, "a" appends; the new content replaces the old file
+    // (or appears) at once, as it does with LittleFS.
+    Content c = std::make_shared<std::string>();
+    if (mode[0] == 'a' && it != files.end())
+        *c = *it->second;
+    files[p]          = c;
+    f.impl_           = std::make_shared<File::Impl>();
+    f.impl_->path     = p;
+    f.impl_->data     = c;
+    f.impl_->pos      = c->size();
+    f.impl_->writable = true;
+    return f;
+}
+
+bool LittleFSFS::exists(const char* path) {
+    return (bool)open(path, "r");
+}
+
+bool LittleFSFS::remove(const char* path) {
+    std::string p = normalise(path);
+    std::lock_guard<std::mutex> g(fs_lock);
+    if (!files.erase(p))
+        return false;
+    unlink_file(p);
+    return true;
+}
+
+bool LittleFSFS::rename(const char* from, const char* to) {
+    std::string a = normalise(from), b = normalise(to);
+    std::lock_guard<std::mutex> g(fs_lock);
+    auto it = files.find(a);
+    if (it == files.end())
+        return false;
+    Content c = it->second;
+    files.erase(it);
+    files[b] = c;
+    unlink_file(a);
+    store_file(b, *c);
+    return true;
+}
+
+bool LittleFSFS::mkdir(const char* path) {
+    (void)path;                          // implied by the files in it
+    return true;
+}
+
+size_t LittleFSFS::totalBytes() { return FS_TOTAL; }
+
+size_t LittleFSFS::usedBytes() {
+    std::lock_guard<std::mutex> g(fs_lock);
+    return used_locked();
+}
+
+// ---------------------------------------------------------------------------
+// File
+// ---------------------------------------------------------------------------
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    if (!impl_ || !impl_->writable)
+        return 0;
+    std::lock_guard<std::mutex> g(fs_lock);
+    std::string& d = *impl_->data;
+    if (used_locked() + size > FS_TOTAL)
+        return 0;                        // partition full
+    if (impl_->pos + size > d.size())
+        d.resize(impl_->pos + size);
+    memcpy(&d[impl_->pos], buf, size);
+    impl_->pos += size;
+    return size;
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    if (!impl_ || !impl_->data)
+        return 0;
+    const std::string& d = *impl_->data;
+    size_t n = impl_->pos < d.size() ? d.size() - impl_->pos : 0;
+    if (n > size)
+        n = size;
+    memcpy(buf, d.data() + impl_->pos, n);
+    impl_->pos += n;
+    return n;
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::available() {
+    if (!impl_ || !impl_->data)
+        return 0;
+    return (int)(impl_->data->size() - impl_->pos);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!impl_ || !impl_->data)
+        return false;
+    size_t base = mode == SeekSet ? 0 : mode == SeekCur ? impl_->pos : impl_->data->size();
+    if (base + pos > impl_->data->size())
+        return false;
+    impl_->pos = base + pos;
+    return true;
+}
+
+size_t File::position() const { return impl_ ? impl_->pos : 0; }
+
+size_t File::size() const {
+    return impl_ && impl_->data ? impl_->data->size() : 0;
+}
+
+void File::close() {
+    if (impl_ && impl_->writable) {
+        std::lock_guard<std::mutex> g(fs_lock);
+        store_file(impl_->path, *impl_->data);
+    }
+    impl_.reset();
+}
+
+const char* File::path() const { return impl_ ? impl_->path.c_str() : ""; }
+
+const char* File::name() const {
+    if (!impl_)
+        return "";
+    size_t slash = impl_->path.rfind('/');
+    return impl_->path.c_str() + slash + 1;
+}
+
+bool File::isDirectory() const { return impl_ && !impl_->data; }
+
+File File::openNextFile() {
+    if (!impl_ || impl_->data || impl_->next >= impl_->entries.size())
+        return File();
+    return LittleFS.open(impl_->entries[impl_->next++].c_str(), "r");
+}
+
+}  // namespace fs
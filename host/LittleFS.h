@@ -0,0 +1,78 @@
+#pragma once
+
+/*
+ * LittleFS.h  (host build)
+ *
+ * Stand-in for the Arduino-ESP32 LittleFS filesystem with the subset of
+ * the fs::FS / fs::File API the sketch uses: open() with "r", "w" or "a",
+ * exists(), remove(), rename(), mkdir(), directory listing through
+ * openNextFile(), and totalBytes() / usedBytes().
+ *
+ * Files live in RAM and, when the emulator was started with --fs <dir>,
+ * are loaded from that directory at begin() and written back to it on
+ * close() — the equivalent of the flash partition surviving a reboot.
+ * Directories are implied by the paths of the files in them.  The size
+ * of the default 4 MB partition table's data partition is enforced.
+ */
+
+#include "Arduino.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File {
+public:
+    File() {}
+
+    size_t write(const uint8_t* buf, size_t size);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t read(uint8_t* buf, size_t size);
+    int    read();
+    int    available();
+    bool   seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void   flush() {}
+    void   close();
+
+    explicit operator bool() const { return impl_ != nullptr; }
+
+    const char* path() const;
+    const char* name() const;           // last path component
+    bool        isDirectory() const;
+    File        openNextFile();
+
+private:
+    friend class LittleFSFS;
+    struct Impl;
+    std::shared_ptr<Impl> impl_;
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs",
+               uint8_t maxOpenFiles = 10, const char* partitionLabel = "spiffs");
+    bool format();
+
+    File open(const char* path, const char* mode = "r", bool create = false);
+    File open(const String& path, const char* mode = "r", bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* from, const char* to);
+    bool mkdir(const char* path);
+
+    size_t totalBytes();
+    size_t usedBytes();
+};
+
+}  // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+using fs::File;
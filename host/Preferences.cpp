@@ -0,0 +1,114 @@
+/*
+ * Preferences.cpp  (host build)
+ *
+ * RAM key/value store with optional file backing — see Preferences.h.
+ * The file holds one "namespace/key hexbytes" line per value.
+ */
+
+#include "Preferences.h"
+#include "hal_host.h"
+
+#include <map>
+
+static std::map<std::string, std::string> store;
+static bool                               loaded = false;
+
+static void load() {
+    loaded = true;
+    const char* path = hal_nvs_path();
+    FILE*       f    = path ? fopen(path, "r") : nullptr;
+    if (!f)
+        return;
+
+    char key[64], hex[512];
+    while (fscanf(f, "%63s %511s", key, hex) == 2) {
+        std::string v;
+        for (size_t i = 0; hex[i] && hex[i + 1]; i += 2) {
+            char byte[3] = { hex[i], hex[i + 1], 0 };
+            v += (char)strtoul(byte, nullptr, 16);
+        }
+        store[key] = v;
+    }
+    fclose(f);
+}
+
+static void save() {
+    const char* path = hal_nvs_path();
+    FILE*       f    = path ? fopen(path, "w") : nullptr;
+    if (!f)
+        return;
+    for (const auto& kv : store) {
+        fprintf(f, "%s ", kv.first.c_str());
+        for (unsigned char c : kv.second)
+            fprintf(f, "%02x", c);
+        fprintf(f, "\n");
+    }
+    fclose(f);
+}
+
+bool Preferences::begin(const char* name, bool readOnly) {
+    if (!loaded)
+        load();
+    ns_        = name;
+    read_only_ = readOnly;
+    return true;
+}
+
+bool Preferences::isKey(const char* key) {
+    return store.count(ns_ + "/" + key) != 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    if (read_only_)
+        return 0;
+    store[ns_ + "/" + key] = std::string((const char*)value, len);
+    save();
+    return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    auto it = store.find(ns_ + "/" + key);
+    if (it == store.end() || it->second.size() > maxLen)
+        return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+    uint32_t v;
+    return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : defaultValue;
+}
+
+size_t Preferences::putUShort(const char* key, uint16_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+uint16_t Preferences::getUShort(const char* key, uint16_t defaultValue) {
+    uint16_t v;
+    return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : defaultValue;
+}
+
+size_t Preferences::putBool(const char* key, bool value) {
+    uint8_t v = value ? 1 : 0;
+    return putBytes(key, &v, sizeof(v));
+}
+
+bool Preferences::getBool(const char* key, bool defaultValue) {
+    uint8_t v;
+    return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v != 0 : defaultValue;
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+    return putBytes(key, value, strlen(value) + 1);
+}
+
+size_t Preferences::getString(const char* key, char* value, size_t maxLen) {
+    size_t n = getBytes(key, value, maxLen);
+    if (n == 0 || value[n - 1] != '\0')
+        return 0;
+    return n;
+}
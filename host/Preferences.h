@@ -0,0 +1,39 @@
+#pragma once
+
+/*
+ * Preferences.h  (host build)
+ *
+ * Stand-in for the Arduino-ESP32 NVS key/value store.  Values live in RAM
+ * and, when the emulator was started with --nvs <file>, are written back
+ * to that file on every put so a restart sees them — the equivalent of a
+ * reboot on the board.
+ */
+
+#include "Arduino.h"
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false);
+    void end() {}
+
+    bool isKey(const char* key);
+
+    size_t   putUInt(const char* key, uint32_t value);
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+
+    size_t   putUShort(const char* key, uint16_t value);
+    uint16_t getUShort(const char* key, uint16_t defaultValue = 0);
+
+    size_t   putBool(const char* key, bool value);
+    bool     getBool(const char* key, bool defaultValue = false);
+
+    size_t putString(const char* key, const char* value);
+    size_t getString(const char* key, char* value, size_t maxLen);
+
+    size_t putBytes(const char* key, const void* value, size_t len);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+
+private:
+    std::string ns_;
+    bool        read_only_ = false;
+};
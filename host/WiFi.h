@@ -0,0 +1,23 @@
+#pragma once
+
+/*
+ * WiFi.h  (host build)
+ *
+ * Soft-AP stub.  On Linux the emulator simply listens on the host's
+ * interfaces, so softAP() only records the SSID, softAPIP() reports the
+ * loopback address and softAPBroadcastIP() the matching /24 broadcast.
+ */
+
+#include "Arduino.h"
+
+class WiFiClass {
+public:
+    bool softAP(const char* ssid, const char* pass = nullptr) {
+        (void)ssid; (void)pass;
+        return true;
+    }
+    IPAddress softAPIP() const          { return IPAddress(127, 0, 0, 1); }
+    IPAddress softAPBroadcastIP() const { return IPAddress(127, 0, 0, 255); }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,438 @@
+/*
+ * hal_host.cpp
+ *
+ * Linux runtime for the "native" PlatformIO environment.
+ *
+ * Provides main(), the virtual clock behind millis()/delay(), the console
+ * Serial, and the NMEA UARTs Serial1 and Serial2 each backed by a
+ * pseudo-terminal (or a file), then drives the sketch's setup()/loop()
+ * exactly as the Arduino core would.
+ *
+ * Every NMEA UART write is timestamped on the HAL clock and fed through a
+ * simple 8N1 line model, so at exit the runtime can report sentence cadence,
+ * throughput and line utilisation.  In the default virtual-clock mode
+ * delay() returns immediately and only advances the clock, which replays
+ * a 24-hour run in a few seconds.
+ *
+ * Usage:
+ *   .pio/build/native/program [options]
+ *     --duration <s>    stop after <s> seconds of emulator time (0 = forever)
+ *     --realtime        follow the wall clock instead of the virtual clock
+ *     --loop-cost <us>  virtual time charged for each loop() pass (default 200)
+ *     --out <file>      write the NMEA stream to <file> instead of a pty
+ *     --out2 <file>     the same for UART2 (second output channel)
+ *     --http-port <n>   TCP port for the web server (default 8080)
+ *     --nvs <file>      keep Preferences in <file> across runs (default: RAM)
+ *     --fs <dir>        keep LittleFS files in <dir> across runs (default: RAM)
+ */
+
+#include "Arduino.h"
+#include "WiFi.h"
+#include "hal_host.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdarg>
+#include <fcntl.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+// ---------------------------------------------------------------------------
+// Options
+// ---------------------------------------------------------------------------
+
+static bool        opt_realtime    = false;
+#ifndef PIO_UNIT_TESTING
+static double      opt_duration_s  = 0;      // main() only, see below
+static uint32_t    opt_loop_cost   = 200;
+#endif
+static const char* opt_out_path    = nullptr;
+static const char* opt_out2_path   = nullptr;
+static int         opt_http_port   = 8080;
+static const char* opt_nvs_path    = nullptr;
+static const char* opt_fs_path     = nullptr;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+// ---------------------------------------------------------------------------
+// Clock
+// ---------------------------------------------------------------------------
+
+static std::atomic<uint64_t> virtual_us{0};   // read by the HTTP thread too
+static std::chrono::steady_clock::time_point wall_start;
+
+uint64_t hal_now_us() {
+    if (!opt_realtime)
+        return virtual_us;
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - wall_start).count();
+}
+
+bool hal_realtime() { return opt_realtime; }
+
+const char* hal_nvs_path() { return opt_nvs_path; }
+const char* hal_fs_path()  { return opt_fs_path; }
+
+int hal_http_port(int requested) {
+    (void)requested;
+    return opt_http_port;
+}
+
+// ---------------------------------------------------------------------------
+// Deadline timer (stand-in for esp_timer + high-priority task)
+// ---------------------------------------------------------------------------
+
+static uint32_t   (*timer_fn)(uint32_t) = nullptr;
+static uint64_t    timer_due = 0;
+static std::thread timer_thread;
+
+// Run the timer function at `now` and take the deadline it returns.
+static void fire_timer(uint64_t now) {
+    uint32_t next = timer_fn((uint32_t)now);
+    int32_t  wait = (int32_t)(next - (uint32_t)hal_now_us());
+    timer_due = hal_now_us() + (wait > 0 ? wait : 0);
+}
+
+// Virtual clock: move time forward to `target`, firing the timer at each
+// deadline on the way as a pre-empting task would.
+static void advance_to(uint64_t target) {
+    while (timer_fn && timer_due <= target) {
+        if (timer_due > virtual_us)
+            virtual_us = timer_due;
+        fire_timer(virtual_us);
+    }
+    if (target > virtual_us)
+        virtual_us = target;
+}
+
+static void timer_thread_main() {
+    using namespace std::chrono;
+
+    // Like the nmea_tx task, outrank everything else in the process (and
+    // the load generators) when allowed to; needs root or CAP_SYS_NICE.
+    struct sched_param sp = {};
+    sp.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) != 0)
+        fprintf(stderr, "[host] TX thread runs without real-time priority\n");
+
+    while (!stop_requested) {
+        std::this_thread::sleep_until(wall_start + microseconds(timer_due));
+        fire_timer(hal_now_us());
+    }
+}
+
+void hal_start_timer(uint32_t (*fn)(uint32_t now_us)) {
+    timer_fn  = fn;
+    timer_due = hal_now_us();             // first call at once
+    if (opt_realtime)
+        timer_thread = std::thread(timer_thread_main);
+}
+
+uint32_t millis() { return (uint32_t)(hal_now_us() / 1000); }
+uint32_t micros() { return (uint32_t)hal_now_us(); }
+
+void delayMicroseconds(uint32_t us) {
+    if (opt_realtime)
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    else
+        advance_to(virtual_us + us);
+}
+
+void delay(uint32_t ms) { delayMicroseconds(ms * 1000); }
+void yield() {}
+
+// ---------------------------------------------------------------------------
+// GPIO — state only
+// ---------------------------------------------------------------------------
+
+static uint8_t pin_state[64];
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin < sizeof(pin_state)) pin_state[pin] = val;
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < sizeof(pin_state) ? pin_state[pin] : LOW;
+}
+
+// ---------------------------------------------------------------------------
+// UART statistics — one NMEA UART write() is one tick's burst of sentences
+// ---------------------------------------------------------------------------
+
+struct TxStats {
+    uint64_t writes       = 0;     // bursts, one per TX tick
+    uint64_t sentences    = 0;     // '$' seen
+    uint64_t bytes        = 0;
+    uint64_t dropped      = 0;     // bytes the pty reader did not take
+    uint64_t first_us     = 0;
+    uint64_t last_us      = 0;
+    uint64_t min_gap_us   = UINT64_MAX;
+    uint64_t max_gap_us   = 0;
+    uint64_t line_busy_us = 0;     // total time the TX line is driven
+    uint64_t line_free_us = 0;     // when the last queued bit leaves the wire
+};
+
+// UART1 .. SOC_UART_NUM - 1; UART0 is the console.
+struct UartModel {
+    TxStats       tx;
+    int           fd   = -1;
+    unsigned long baud = 0;        // last rate begun or set, for the report
+};
+
+static UartModel uarts[SOC_UART_NUM];
+
+static void open_uart(int num) {
+    UartModel&  u    = uarts[num];
+    const char* path = num == 1 ? opt_out_path : num == 2 ? opt_out2_path : nullptr;
+    char        name[8];
+    snprintf(name, sizeof(name), num == 1 ? "UART" : "UART%d", num);
+
+    if (path) {
+        u.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (u.fd < 0) { perror(path); exit(1); }
+        fprintf(stderr, "[host] NMEA %s -> %s\n", name, path);
+        return;
+    }
+
+    u.fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (u.fd < 0 || grantpt(u.fd) < 0 || unlockpt(u.fd) < 0) {
+        perror("posix_openpt");
+        exit(1);
+    }
+    const char* slave = ptsname(u.fd);
+
+    // Hold the slave open in raw mode so that \r\n reaches readers untouched
+    // and the pty survives readers coming and going.
+    int sfd = open(slave, O_RDWR | O_NOCTTY);
+    if (sfd >= 0) {
+        struct termios t;
+        tcgetattr(sfd, &t);
+        cfmakeraw(&t);
+        tcsetattr(sfd, TCSANOW, &t);
+    }
+    // Never let a missing reader stall the emulator.
+    fcntl(u.fd, F_SETFL, fcntl(u.fd, F_GETFL) | O_NONBLOCK);
+    fprintf(stderr, "[host] NMEA %s on %s\n", name, slave);
+}
+
+// ---------------------------------------------------------------------------
+// HardwareSerial
+// ---------------------------------------------------------------------------
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+WiFiClass      WiFi;
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin) {
+    (void)config; (void)rxPin; (void)txPin;
+    baud_ = baud;
+    if (uart_num_ > 0 && uart_num_ < SOC_UART_NUM) {
+        uarts[uart_num_].baud = baud;
+        if (uarts[uart_num_].fd < 0)
+            open_uart(uart_num_);
+    }
+}
+
+void HardwareSerial::updateBaudRate(unsigned long baud) {
+    baud_ = baud;
+    if (uart_num_ > 0 && uart_num_ < SOC_UART_NUM)
+        uarts[uart_num_].baud = baud;
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t len) {
+    if (uart_num_ <= 0 || uart_num_ >= SOC_UART_NUM) {
+        fwrite(buf, 1, len, stdout);
+        fflush(stdout);
+        return len;
+    }
+
+    UartModel& u   = uarts[uart_num_];
+    TxStats&   tx  = u.tx;
+    uint64_t   now = hal_now_us();
+    if (tx.writes > 0) {
+        uint64_t gap = now - tx.last_us;
+        if (gap < tx.min_gap_us) tx.min_gap_us = gap;
+        if (gap > tx.max_gap_us) tx.max_gap_us = gap;
+    } else {
+        tx.first_us = now;
+    }
+    tx.last_us = now;
+    tx.writes++;
+    tx.bytes += len;
+    for (size_t i = 0; i < len; i++)
+        tx.sentences += buf[i] == '$';
+
+    // 8N1: ten bit times per byte.
+    uint64_t wire_us = baud_ ? (uint64_t)len * 10 * 1000000 / baud_ : 0;
+    uint64_t start   = now > tx.line_free_us ? now : tx.line_free_us;
+    tx.line_free_us  = start + wire_us;
+    tx.line_busy_us += wire_us;
+
+    ssize_t n = u.fd >= 0 ? ::write(u.fd, buf, len) : -1;
+    if (n < (ssize_t)len)
+        tx.dropped += len - (n > 0 ? n : 0);
+    return len;
+}
+
+// Bytes written to `tx` but not yet sent by the line model.
+static uint64_t line_pending(const TxStats& tx, unsigned long baud) {
+    uint64_t now = hal_now_us();
+    if (!baud || tx.line_free_us <= now)
+        return 0;
+    return ((tx.line_free_us - now) * baud + 9999999) / 10000000;
+}
+
+int HardwareSerial::availableForWrite() {
+    if (uart_num_ <= 0 || uart_num_ >= SOC_UART_NUM)
+        return 4096;
+    int64_t room = (int64_t)tx_ring_ + 128                       // + hardware FIFO
+                   - (int64_t)line_pending(uarts[uart_num_].tx, baud_);
+    return room > 0 ? (int)room : 0;
+}
+
+// Wait until the line model has sent everything.
+void HardwareSerial::flush() {
+    if (uart_num_ <= 0 || uart_num_ >= SOC_UART_NUM)
+        return;
+    uint64_t free_us = uarts[uart_num_].tx.line_free_us;
+    if (free_us <= hal_now_us())
+        return;
+    uint64_t wait = free_us - hal_now_us();
+    if (opt_realtime)
+        std::this_thread::sleep_for(std::chrono::microseconds(wait));
+    else
+        virtual_us += wait;       // TX task context: no timer re-entry
+}
+
+size_t HardwareSerial::printf(const char* fmt, ...) {
+    char    buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    return write((const uint8_t*)buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+}
+
+// ---------------------------------------------------------------------------
+// ESP
+// ---------------------------------------------------------------------------
+
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() {
+    size_t   used  = mallinfo2().uordblks;
+    uint32_t free_ = used < HOST_HEAP_SIZE ? (uint32_t)(HOST_HEAP_SIZE - used) : 0;
+    if (free_ < min_free_)
+        min_free_ = free_;
+    return free_;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    getFreeHeap();
+    return min_free_;
+}
+
+// The unit tests in test/ are linked against the same sources with
+// test_build_src and bring their own main(); they never run the sketch.
+#ifndef PIO_UNIT_TESTING
+
+// ---------------------------------------------------------------------------
+// Report
+// ---------------------------------------------------------------------------
+
+static void print_uart(int num) {
+    const TxStats& tx     = uarts[num].tx;
+    double         span_s = (tx.last_us - tx.first_us) / 1e6;
+
+    if (num > 1)
+        fprintf(stderr, "[host] --- UART%d ---\n", num);
+    fprintf(stderr, "[host] ticks / sentences %llu / %llu\n",
+            (unsigned long long)tx.writes, (unsigned long long)tx.sentences);
+    fprintf(stderr, "[host] bytes             %llu", (unsigned long long)tx.bytes);
+    if (tx.dropped)
+        fprintf(stderr, "  (%llu not read from pty)", (unsigned long long)tx.dropped);
+    fprintf(stderr, "\n");
+    if (tx.writes > 1) {
+        fprintf(stderr, "[host] interval min/avg/max  %.3f / %.3f / %.3f ms\n",
+                tx.min_gap_us / 1e3,
+                (tx.last_us - tx.first_us) / 1e3 / (tx.writes - 1),
+                tx.max_gap_us / 1e3);
+        fprintf(stderr, "[host] throughput        %.1f sentences/s, %.1f bytes/s\n",
+                (double)tx.sentences * (tx.writes - 1) / tx.writes / span_s,
+                tx.bytes / span_s);
+        fprintf(stderr, "[host] line utilisation  %.1f %% at %lu baud\n",
+                100.0 * tx.line_busy_us / (span_s * 1e6), uarts[num].baud);
+    }
+}
+
+static void print_report() {
+    fprintf(stderr, "\n[host] --- NMEA output report ---\n");
+    fprintf(stderr, "[host] emulator time     %.3f s (%s clock)\n",
+            hal_now_us() / 1e6, opt_realtime ? "wall" : "virtual");
+    print_uart(1);
+    for (int num = 2; num < SOC_UART_NUM; num++)
+        if (uarts[num].fd >= 0)
+            print_uart(num);
+}
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--duration s] [--realtime] [--loop-cost us]"
+            " [--out file] [--out2 file] [--http-port n] [--nvs file] [--fs dir]\n", argv0);
+    exit(2);
+}
+
+static void on_signal(int) { stop_requested = 1; }
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* a    = argv[i];
+        const char* next = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if      (!strcmp(a, "--realtime"))              opt_realtime  = true;
+        else if (!strcmp(a, "--duration")  && next)   { opt_duration_s = atof(next); i++; }
+        else if (!strcmp(a, "--loop-cost") && next)   { opt_loop_cost  = (uint32_t)atol(next); i++; }
+        else if (!strcmp(a, "--out")       && next)   { opt_out_path   = next; i++; }
+        else if (!strcmp(a, "--out2")      && next)   { opt_out2_path  = next; i++; }
+        else if (!strcmp(a, "--http-port") && next)   { opt_http_port  = atoi(next); i++; }
+        else if (!strcmp(a, "--nvs")       && next)   { opt_nvs_path   = next; i++; }
+        else if (!strcmp(a, "--fs")        && next)   { opt_fs_path    = next; i++; }
+        else usage(argv[0]);
+    }
+
+    signal(SIGINT,  on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+    wall_start = std::chrono::steady_clock::now();
+
+    setup();
+
+    const uint64_t end_us = (uint64_t)(opt_duration_s * 1e6);
+    while (!stop_requested && (end_us == 0 || hal_now_us() < end_us)) {
+        loop();
+        // Charge each pass for the work a real loop() does outside delay().
+        if (!opt_realtime)
+            advance_to(virtual_us + opt_loop_cost);
+    }
+
+    stop_requested = 1;
+    if (timer_thread.joinable())
+        timer_thread.join();
+
+    print_report();
+    return 0;
+}
+
+#endif  // PIO_UNIT_TESTING
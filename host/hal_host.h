@@ -0,0 +1,32 @@
+#pragma once
+
+/*
+ * hal_host.h
+ *
+ * Host-only hooks shared by the Arduino shims in this directory.
+ * Nothing under src/ includes this file.
+ */
+
+#include <cstdint>
+
+// Current time on the HAL clock in microseconds.  Virtual unless the
+// emulator was started with --realtime.
+uint64_t hal_now_us();
+
+// True when millis()/delay() follow the wall clock.
+bool hal_realtime();
+
+// TCP port the host WebServer should bind instead of the requested one.
+int hal_http_port(int requested);
+
+// Call fn at the deadline it returns (micros() clock), standing in for a
+// high-priority FreeRTOS task woken by a one-shot esp_timer.  Virtual
+// clock: fired at its exact deadline from inside delay() and between
+// loop() passes.  Wall clock: own thread.  The first call is due at once.
+void hal_start_timer(uint32_t (*fn)(uint32_t now_us));
+
+// File the Preferences shim persists to (--nvs), or nullptr for RAM only.
+const char* hal_nvs_path();
+
+// Directory the LittleFS shim persists to (--fs), or nullptr for RAM only.
+const char* hal_fs_path();
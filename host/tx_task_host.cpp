@@ -0,0 +1,14 @@
+/*
+ * tx_task_host.cpp
+ *
+ * Host backend for src/tx_task.h: the wake function runs on the HAL's
+ * deadline timer, which pre-empts loop() at its exact deadline on the
+ * virtual clock or runs on its own thread with --realtime.
+ */
+
+#include "tx_task.h"
+#include "hal_host.h"
+
+void tx_task_start(TxWakeFn wake) {
+    hal_start_timer(wake);
+}
@@ -0,0 +1,466 @@
+/*
+ * channels.cpp
+ *
+ * Further NMEA output channels — see channels.h.
+ */
+
+#include "channels.h"
+#include <Preferences.h>
+#include "nmea.h"
+#include "talker.h"
+#include "tx_task.h"
+
+// Talker ID as two bytes in one word, as the TX task compares them.
+#define TALKER_HE  ((uint16_t)('H' | 'E' << 8))
+
+struct Channel {
+    uint8_t         uart_num = 0;
+    int8_t          tx_pin   = -1;
+    UartTx          uart;
+    Talker          talker;
+    SequencePlayer  player;
+
+    // Web task: settings in force and the storage behind `player`
+    ChannelConfig   cfg = {};
+    HeadingTable    table[2];
+    HeadingBuffer   buf[2];
+    HeadingTable    builtin;
+    bool            boot_load = false;      // slot still to be read at boot
+
+    // Web task -> TX task
+    std::atomic<uint32_t> line_req{0};      // baud / 100 << 16 | interval ms; 0 = none
+    std::atomic<uint32_t> tag{0};           // talker ID | offset << 16
+    std::atomic<bool>     enabled{false};
+    std::atomic<bool>     follow{true};     // heading from channel 0, not `player`
+
+    // TX task counters
+    volatile uint32_t bursts = 0;
+    volatile uint32_t shared = 0;
+    volatile uint32_t missed = 0;
+
+    // TX task only
+    TxClock  clock;
+    bool     mirror      = true;            // mode in force
+    bool     running     = false;           // clock started since enabled
+    uint32_t baud        = 0;
+    uint32_t interval_ms = 0;
+    char     burst[TALKER_BURST_MAX];
+};
+
+static Channel    channels[CHANNEL_MAX - 1];     // channels 1 ..
+static uint8_t    count = 1;
+
+static ChannelConfig         main_cfg = {};      // channel 0: talker ID only
+static int8_t                main_pin = -1;
+static std::atomic<uint16_t> main_tag{TALKER_HE};
+static int16_t               main_deci = 0;      // TX task
+static const HeadingTable*   builtin_table = nullptr;
+static LineConfig            default_line = {};
+
+static Channel& channel(uint8_t n) {
+    return channels[n - 1];
+}
+
+static uint16_t id_word(const char* id) {
+    return (uint16_t)((uint8_t)id[0] | (uint8_t)id[1] << 8);
+}
+
+static uint32_t pack_tag(const ChannelConfig& cfg) {
+    return id_word(cfg.talker_id) | (uint32_t)(uint16_t)cfg.offset_deci << 16;
+}
+
+static uint32_t pack_line(const LineConfig& line) {
+    return (line.baud / 100) << 16 | line.interval_ms;
+}
+
+static bool talker_id_ok(const char* id) {
+    return id[0] >= 'A' && id[0] <= 'Z' && id[1] >= 'A' && id[1] <= 'Z' && id[2] == '\0';
+}
+
+// ---------------------------------------------------------------------------
+// Settings
+// ---------------------------------------------------------------------------
+
+static void key_for(uint8_t n, char* key) {
+    snprintf(key, 8, "ch%u", (unsigned)n);
+}
+
+static bool load_config(uint8_t n, ChannelConfig* cfg) {
+    char        key[8];
+    Preferences prefs;
+    key_for(n, key);
+    prefs.begin("nmea", true);
+    bool found = prefs.getBytes(key, cfg, sizeof(*cfg)) == sizeof(*cfg);
+    prefs.end();
+    return found;
+}
+
+static void save_config(uint8_t n, const ChannelConfig& cfg) {
+    char        key[8];
+    Preferences prefs;
+    key_for(n, key);
+    prefs.begin("nmea", false);
+    prefs.putBytes(key, &cfg, sizeof(cfg));
+    prefs.end();
+}
+
+// nullptr if `cfg` is usable on a channel other than 0.
+static const char* check_config(const ChannelConfig& cfg, const LineConfig& main_line,
+                                char* why, size_t why_len) {
+    if (!talker_id_ok(cfg.talker_id))
+        return "talker ID must be two letters A .. Z";
+    if (cfg.offset_deci < -1800 || cfg.offset_deci > 1800)
+        return "offset must be -180 .. 180";
+    if (cfg.source[0] && strcmp(cfg.source, "default") != 0 && !slot_name_ok(cfg.source))
+        return "bad source";
+    if (cfg.line.interval_ms)
+        return line_config_check(cfg.line, why, why_len);
+
+    // A mirror carries channel 0's sentences at channel 0's rate.
+    LineConfig as_main = main_line;
+    as_main.baud       = cfg.line.baud;
+    if (line_config_check(as_main, why, why_len)) {
+        size_t n = strlen(why);
+        snprintf(why + n, why_len - n, " (mirroring channel 0)");
+        return why;
+    }
+    return nullptr;
+}
+
+// Point `c` at the sequence `source` names: "" channel 0's heading,
+// "default" the built-in table, else that slot, read now.
+static const char* set_source(Channel& c, const char* source) {
+    if (!source[0]) {
+        c.follow.store(true, std::memory_order_release);
+        return nullptr;
+    }
+    if (strcmp(source, "default") == 0) {
+        c.player.retract();
+        c.player.publish(&c.builtin);
+        c.follow.store(false, std::memory_order_release);
+        return nullptr;
+    }
+
+    // As for channel 0's uploads: a table still pending is withdrawn, which
+    // frees its bank; otherwise the bank not being played is free.
+    c.player.retract();
+    int        bank = (c.player.active() == &c.table[0]) ? 1 : 0;
+    SlotLoader loader;
+    if (const char* err = loader.begin(source, &c.buf[bank], SEQ_MAX_ENTRIES))
+        return err;
+    HeadingTable& tbl = c.table[bank];
+    tbl         = {};
+    tbl.deci    = c.buf[bank].data;
+    tbl.count   = loader.count();
+    tbl.swap    = SWAP_NOW;
+    c.player.publish(&tbl);
+    c.follow.store(false, std::memory_order_release);
+    return nullptr;
+}
+
+void channels_begin(const HeadingTable* builtin, const LineConfig& main_line,
+                    int8_t main_tx_pin) {
+    builtin_table = builtin;
+    default_line  = main_line;
+    main_pin      = main_tx_pin;
+
+    strcpy(main_cfg.talker_id, "HE");
+    ChannelConfig stored;
+    if (load_config(0, &stored) && talker_id_ok(stored.talker_id))
+        memcpy(main_cfg.talker_id, stored.talker_id, sizeof(main_cfg.talker_id));
+    main_tag.store(id_word(main_cfg.talker_id), std::memory_order_relaxed);
+}
+
+void channel_begin(uint8_t n, HardwareSerial& port, uint8_t uart_num,
+                   int8_t rx_pin, int8_t tx_pin) {
+    Channel& c = channel(n);
+    c.uart_num = uart_num;
+    c.tx_pin   = tx_pin;
+    c.builtin       = *builtin_table;
+    c.builtin.swap  = SWAP_NOW;
+    if (n >= count)
+        count = n + 1;
+
+    // Stored settings, or a disabled mirror at channel 0's baud rate.
+    ChannelConfig cfg = {};
+    cfg.line             = default_line;
+    cfg.line.interval_ms = 0;
+    strcpy(cfg.talker_id, "HE");
+    char why[80];
+    ChannelConfig stored;
+    if (load_config(n, &stored)) {
+        stored.source[SLOT_NAME_MAX] = '\0';
+        if (check_config(stored, default_line, why, sizeof(why)))
+            Serial.printf("Warning: channel %u settings ignored: %s\n", (unsigned)n, why);
+        else
+            cfg = stored;
+    }
+    c.cfg = cfg;
+
+    uint32_t interval = cfg.line.interval_ms ? cfg.line.interval_ms : default_line.interval_ms;
+    c.uart.begin(port, cfg.line.baud, SERIAL_8N1, rx_pin, tx_pin);
+    c.talker.begin(cfg.line.mix, interval, cfg.line.baud);
+    c.player.begin(&c.builtin);
+    c.baud        = cfg.line.baud;
+    c.interval_ms = cfg.line.interval_ms;
+    c.mirror      = cfg.line.interval_ms == 0;
+    c.tag.store(pack_tag(cfg), std::memory_order_relaxed);
+
+    bool slot = cfg.source[0] && strcmp(cfg.source, "default") != 0;
+    if (!slot)
+        set_source(c, cfg.source);
+    c.boot_load = slot;
+    c.enabled.store(cfg.enabled && !slot, std::memory_order_release);
+}
+
+void channels_finish_boot() {
+    for (uint8_t n = 1; n < count; n++) {
+        Channel& c = channel(n);
+        if (!c.boot_load)
+            continue;
+        c.boot_load = false;
+        if (const char* err = set_source(c, c.cfg.source)) {
+            Serial.printf("Warning: channel %u: slot '%s': %s; channel disabled\n",
+                          (unsigned)n, c.cfg.source, err);
+            continue;
+        }
+        c.enabled.store(c.cfg.enabled, std::memory_order_release);
+    }
+}
+
+uint8_t channel_count() {
+    return count;
+}
+
+ChannelConfig channel_config(uint8_t n) {
+    return n == 0 ? main_cfg : channel(n).cfg;
+}
+
+const char* channel_configure(uint8_t n, const ChannelConfig& next,
+                              const LineConfig& main_line, char* why, size_t why_len) {
+    if (n == 0) {
+        if (!talker_id_ok(next.talker_id))
+            return "talker ID must be two letters A .. Z";
+        main_tag.store(id_word(next.talker_id), std::memory_order_relaxed);
+        if (strcmp(next.talker_id, main_cfg.talker_id) != 0) {
+            memcpy(main_cfg.talker_id, next.talker_id, sizeof(main_cfg.talker_id));
+            save_config(0, main_cfg);
+        }
+        return nullptr;
+    }
+
+    Channel& c = channel(n);
+    if (const char* err = check_config(next, main_line, why, why_len))
+        return err;
+    if (strcmp(next.source, c.cfg.source) != 0 || c.boot_load) {
+        if (const char* err = set_source(c, next.source)) {
+            snprintf(why, why_len, "source: %s", err);
+            return why;
+        }
+        c.boot_load = false;
+    }
+
+    if (next.line.baud != c.cfg.line.baud || next.line.interval_ms != c.cfg.line.interval_ms)
+        c.line_req.store(pack_line(next.line), std::memory_order_release);
+    c.talker.set_mix(next.line.mix);
+    c.tag.store(pack_tag(next), std::memory_order_relaxed);
+    c.enabled.store(next.enabled, std::memory_order_release);
+    if (memcmp(&next, &c.cfg, sizeof(next)) != 0)
+        save_config(n, next);
+    c.cfg = next;
+    return nullptr;
+}
+
+ChannelStats channel_stats(uint8_t n) {
+    const Channel& c = channel(n);
+    ChannelStats   s = {};
+    s.uart      = c.uart.stats();
+    s.bursts    = c.bursts;
+    s.shared    = c.shared;
+    s.sentences = c.talker.sent();
+    s.deferred  = c.talker.deferred();
+    s.missed    = c.missed;
+    return s;
+}
+
+size_t channel_describe(uint8_t n, char* out, size_t out_len) {
+    int len;
+    if (n == 0) {
+        len = snprintf(out, out_len, "ch=0 uart=1 tx_pin=%d enabled=1 mode=main talker=%s "
+                       "(rate, baud and mix on /line)\n", main_pin, main_cfg.talker_id);
+        return len > 0 ? (size_t)len : 0;
+    }
+
+    const ChannelConfig& cfg = channel(n).cfg;
+    ChannelStats         st  = channel_stats(n);
+    len = snprintf(out, out_len, "ch=%u uart=%u tx_pin=%d enabled=%d mode=%s baud=%u ",
+                   (unsigned)n, (unsigned)channel(n).uart_num, channel(n).tx_pin,
+                   cfg.enabled ? 1 : 0, cfg.line.interval_ms ? "own" : "mirror",
+                   (unsigned)cfg.line.baud);
+    if (cfg.line.interval_ms && len > 0 && (size_t)len < out_len) {
+        int16_t off = cfg.offset_deci;
+        len += snprintf(out + len, out_len - len,
+                        "rate=%uHz interval=%ums hdt=%u ths=%u rot=%u hdg=%u offset=%s%d.%d "
+                        "source=%s ",
+                        (unsigned)(1000 / cfg.line.interval_ms), (unsigned)cfg.line.interval_ms,
+                        cfg.line.mix.every[SENT_HDT], cfg.line.mix.every[SENT_THS],
+                        cfg.line.mix.every[SENT_ROT], cfg.line.mix.every[SENT_HDG],
+                        off < 0 ? "-" : "", abs(off) / 10, abs(off) % 10,
+                        cfg.source[0] ? cfg.source : "ch0");
+    }
+    if (len > 0 && (size_t)len < out_len)
+        len += snprintf(out + len, out_len - len,
+                        "talker=%s bursts=%u shared=%u sentences=%u deferred=%u "
+                        "bytes=%u dropped=%u missed=%u\n",
+                        cfg.talker_id, (unsigned)st.bursts, (unsigned)st.shared,
+                        (unsigned)st.sentences, (unsigned)st.deferred,
+                        (unsigned)st.uart.bytes_queued, (unsigned)st.uart.dropped,
+                        (unsigned)st.missed);
+    return len > 0 ? ((size_t)len < out_len ? (size_t)len : out_len - 1) : 0;
+}
+
+// ---------------------------------------------------------------------------
+// TX task
+// ---------------------------------------------------------------------------
+
+// Put a pending baud rate / interval change in force once the channel's
+// own line has drained; false while it has not, with the time still to
+// go in `wait`.
+static bool apply_request(Channel& c, uint32_t* wait) {
+    uint32_t req = c.line_req.load(std::memory_order_acquire);
+    if (!req)
+        return true;
+    uint32_t baud     = (req >> 16) * 100;
+    uint32_t interval = req & 0xFFFF;
+    if (baud != c.baud) {
+        *wait = c.uart.set_baud(baud);
+        if (*wait)
+            return false;
+        c.baud = baud;
+    }
+    c.line_req.compare_exchange_strong(req, 0, std::memory_order_acq_rel);
+
+    bool was_own = !c.mirror && c.running;
+    c.mirror     = interval == 0;
+    if (!c.mirror) {
+        c.talker.set_line(interval, baud);
+        if (was_own)
+            c.clock.set_period(interval);       // from this tick on
+        else
+            c.running = false;                  // channels_service() starts the clock
+    }
+    c.interval_ms = interval;
+    return true;
+}
+
+void channels_tag_main(char* burst, size_t len) {
+    uint16_t id = main_tag.load(std::memory_order_relaxed);
+    if (id != TALKER_HE) {
+        char s[2] = { (char)id, (char)(id >> 8) };
+        nmea_set_talker(burst, len, s);
+    }
+}
+
+void channels_mirror(const char* burst, size_t len, bool tagged) {
+    // One retagged copy per talker ID that differs from channel 0's.
+    uint16_t    ids[CHANNEL_MAX];
+    const char* copies[CHANNEL_MAX];
+    uint8_t     ncopies = 0;
+    uint16_t    main_id = main_tag.load(std::memory_order_relaxed);
+
+    for (uint8_t n = 1; n < count; n++) {
+        Channel& c = channel(n);
+        uint32_t wait;
+        if (!c.mirror || !c.enabled.load(std::memory_order_acquire))
+            continue;
+        if (!apply_request(c, &wait) || !c.mirror || !len)
+            continue;
+
+        uint16_t    id  = (uint16_t)c.tag.load(std::memory_order_relaxed);
+        const char* out = burst;
+        if (tagged && id != main_id && len <= sizeof(c.burst)) {
+            out = nullptr;
+            for (uint8_t k = 0; k < ncopies && !out; k++)
+                if (ids[k] == id)
+                    out = copies[k];
+            if (!out) {
+                char s[2] = { (char)id, (char)(id >> 8) };
+                memcpy(c.burst, burst, len);
+                nmea_set_talker(c.burst, len, s);
+                ids[ncopies]    = id;
+                copies[ncopies] = c.burst;
+                ncopies++;
+                out = c.burst;
+            } else {
+                c.shared = c.shared + 1;
+            }
+        } else {
+            c.shared = c.shared + 1;
+        }
+        c.uart.send(out, len);
+        c.bursts = c.bursts + 1;
+    }
+}
+
+void channels_set_heading(int16_t deci) {
+    main_deci = deci;
+}
+
+// One tick of a channel in its own mode.
+static void tick_own(Channel& c, uint32_t missed) {
+    HeadingTick h = {};
+    if (c.follow.load(std::memory_order_acquire))
+        h.deci = main_deci;
+    else
+        c.player.next_heading(&h);
+
+    uint32_t tag    = c.tag.load(std::memory_order_relaxed);
+    int16_t  offset = (int16_t)(tag >> 16);
+    if (offset) {
+        h.deci    = (int16_t)(((h.deci + offset) % 3600 + 3600) % 3600);
+        h.hdt     = nullptr;                  // the preformatted one is for the old value
+        h.hdt_len = 0;
+    }
+
+    size_t len = c.talker.tick(h, c.burst);
+    if ((uint16_t)tag != TALKER_HE) {
+        char s[2] = { (char)tag, (char)(tag >> 8) };
+        nmea_set_talker(c.burst, len, s);
+    }
+    if (len) {
+        c.uart.send(c.burst, len);
+        c.bursts = c.bursts + 1;
+    }
+    if (missed) {
+        c.missed = c.missed + missed;
+        c.uart.missed(missed);
+    }
+}
+
+uint32_t channels_service(uint32_t now_us) {
+    uint32_t next = now_us + 1000000;
+    for (uint8_t n = 1; n < count; n++) {
+        Channel& c = channel(n);
+        if (!c.enabled.load(std::memory_order_acquire)) {
+            c.running = false;
+            continue;
+        }
+        if (c.mirror)
+            continue;                         // sent from channels_mirror()
+        if (!c.running) {
+            c.running = true;
+            c.clock.start(c.interval_ms, now_us);
+        }
+
+        uint32_t missed, wait;
+        if (c.clock.take(now_us, &missed)) {
+            if (!apply_request(c, &wait))
+                c.clock.retry(now_us, wait);
+            else if (!c.mirror)
+                tick_own(c, missed);
+        }
+        if (!c.mirror)
+            next = tx_earliest(next, c.clock.due_us);
+    }
+    return next;
+}
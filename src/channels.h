@@ -0,0 +1,109 @@
+#pragma once
+
+/*
+ * channels.h
+ *
+ * Further NMEA output channels, for rigs that need more than one gyro
+ * feed: a primary and a backup, or several consumers with different
+ * offsets.  Channel 0 is the main output on Serial1 (main.cpp: uploads,
+ * logs, live mode, /line); channels 1 .. channel_count() - 1 each drive a
+ * UART of their own with their own pins, baud rate, talker ID and either
+ * of two modes:
+ *
+ *   mirror   rate=follow: channel 0's sentences at channel 0's ticks.
+ *            Nothing is formatted again: channel 0's burst is written as
+ *            it is when the talker IDs match, and retagged once per
+ *            distinct ID otherwise (nmea_set_talker()), so any number of
+ *            mirrors share one buffer per ID.  A log being played is
+ *            mirrored verbatim.
+ *   own      own rate, sentence mix (a Talker of its own) and sequence:
+ *            channel 0's latest heading, the built-in table or a slot
+ *            (slots.h), plus a fixed offset.
+ *
+ * Every channel is paced by the one TX timer (tx_task.h) with deadlines of
+ * its own, and waits for its own line only (UartTx::set_baud() never
+ * blocks), so no channel's rate, baud rate, load or late tick moves
+ * another's sentences.
+ *
+ * The web task changes settings through atomic words and the sequence
+ * handoff (sequence.h), as for channel 0; the TX task applies them at the
+ * channel's next tick.  Settings are kept in NVS (Preferences namespace
+ * "nmea", key "ch<n>"); for channel 0 only the talker ID is taken from
+ * here.
+ */
+
+#include <Arduino.h>
+#include "line_config.h"
+#include "sequence.h"
+#include "slots.h"
+#include "uart_tx.h"
+
+// Channel 0 and at most two more UARTs.
+#define CHANNEL_MAX  3
+
+struct ChannelConfig {
+    bool       enabled;
+    LineConfig line;                         // interval_ms 0 = mirror
+    char       talker_id[3];                 // e.g. "HE", "HC", "IN"
+    int16_t    offset_deci;                  // added to each heading (own)
+    char       source[SLOT_NAME_MAX + 1];    // own: "" channel 0, "default", or a slot
+};
+
+struct ChannelStats {
+    UartTxStats uart;
+    uint32_t    bursts;        // ticks that queued sentences
+    uint32_t    shared;        // of those, written from another channel's buffer
+    uint32_t    sentences;     // formatted by the channel's own Talker
+    uint32_t    deferred;
+    uint32_t    missed;        // own deadlines missed
+};
+
+// --- setup, before the TX task starts ---
+
+// Channel 0's talker ID from NVS.  `builtin` is the default table,
+// `main_line` channel 0's settings and `main_tx_pin` its TX pin.
+void channels_begin(const HeadingTable* builtin, const LineConfig& main_line,
+                    int8_t main_tx_pin);
+
+// Open channel `n` (1 .. CHANNEL_MAX - 1) on UART `uart_num` through
+// `port`, with its stored settings or, failing that, as a disabled mirror.
+void channel_begin(uint8_t n, HardwareSerial& port, uint8_t uart_num,
+                   int8_t rx_pin, int8_t tx_pin);
+
+// Load the slots channels play and enable them; after the TX task has
+// started, so reading flash does not hold up the first sentence.
+void channels_finish_boot();
+
+// Channels including channel 0.
+uint8_t channel_count();
+
+// --- web task ---
+
+ChannelConfig channel_config(uint8_t n);
+
+// Check `next` for channel `n` and put it in force (`main_line` is channel
+// 0's, which a mirror must be able to carry).  nullptr on success, else
+// why not, written into `why`; nothing changes then.  Stored in NVS.
+const char* channel_configure(uint8_t n, const ChannelConfig& next,
+                              const LineConfig& main_line, char* why, size_t why_len);
+
+// "ch=1 uart=2 tx_pin=17 enabled=1 mode=own ..." and counters, one line.
+size_t channel_describe(uint8_t n, char* out, size_t out_len);
+
+ChannelStats channel_stats(uint8_t n);
+
+// --- TX task ---
+
+// Give channel 0's burst its talker ID (sentences from its Talker only).
+void channels_tag_main(char* burst, size_t len);
+
+// Channel 0 queued `burst`; `tagged` if its Talker formatted it (a log
+// burst is not).  Mirrors send it now.
+void channels_mirror(const char* burst, size_t len, bool tagged);
+
+// Channel 0's heading this tick, for own channels that follow it.
+void channels_set_heading(int16_t deci);
+
+// Serve the own channels due at `now_us`; returns the earliest deadline
+// among them (a second ahead if none is running).
+uint32_t channels_service(uint32_t now_us);
@@ -0,0 +1,112 @@
+#pragma once
+
+/*
+ * default_table.h
+ *
+ * Built-in default heading sequence, generated at compile time.
+ *
+ * The legacy table (input_files/in-o.txt) came from a Scilab script:
+ *
+ *     h(i) = 330 + 2 * sin(0.08 * i - 0.5663),   i = 0 .. 127
+ *
+ * truncated to 0.1°.  Those parameters reproduce all 128 hand-pasted values
+ * exactly.  Here the values are computed with const_sin() (fixmath.h) and
+ * run through the same constexpr makeHDTFixed() the TX path uses, so the
+ * default sentences carry checksums like every uploaded one.
+ *
+ * The truncation is touchy: i = 66 gives 3280.0000172 deci-degrees, only
+ * 1.7e-5 above a step, so the sine must be good to about 1e-6 (const_sin()
+ * is within 1e-14).  LEGACY_DECI keeps the original values and a
+ * static_assert checks every generated one against them.
+ *
+ * The result, DEFAULT_IMAGE, is one contiguous flash-resident byte array of
+ * DEFAULT_COUNT sentences at a fixed DEFAULT_STRIDE, with no pointer table
+ * and nothing to do at boot.  DEFAULT_DECI holds the same headings as
+ * numbers for the sentence types that are not preformatted (talker.h).
+ */
+
+#include "fixmath.h"
+#include "nmea.h"
+
+namespace default_gen {
+
+constexpr size_t COUNT  = 128;
+constexpr double CENTRE = 330.0;
+constexpr double AMP    = 2.0;
+constexpr double OMEGA  = 0.08;       // rad per sentence
+constexpr double PHASE  = -0.5663;    // rad
+
+constexpr int16_t heading_deci(size_t i) {
+    double h = CENTRE + AMP * const_sin(OMEGA * (double)i + PHASE);
+    return (int16_t)(h * 10.0);       // truncation, as the Scilab export did
+}
+
+// Every default heading has three integer digits, hence equal length.
+constexpr size_t STRIDE = 19;         // "$HEHDT,xxx.x,T*CS\r\n"
+
+struct Image {
+    char bytes[COUNT * STRIDE];
+};
+
+struct Deci {
+    int16_t values[COUNT];
+};
+
+constexpr bool fixed_length() {
+    char tmp[NMEA_HDT_MAX] = {};
+    for (size_t i = 0; i < COUNT; i++)
+        if (makeHDTFixed(heading_deci(i), tmp) != STRIDE)
+            return false;
+    return true;
+}
+
+static_assert(fixed_length(), "default headings must all format to STRIDE bytes");
+
+// input_files/in-o.txt, the table the firmware used to carry, in deci-degrees.
+constexpr int16_t LEGACY_DECI[COUNT] = {
+    3289, 3290, 3292, 3293, 3295, 3296, 3298, 3299, 3301, 3303, 3304, 3306,
+    3307, 3309, 3310, 3311, 3313, 3314, 3315, 3316, 3317, 3317, 3318, 3319,
+    3319, 3319, 3319, 3319, 3319, 3319, 3319, 3318, 3318, 3317, 3316, 3315,
+    3314, 3313, 3312, 3311, 3309, 3308, 3306, 3305, 3303, 3302, 3300, 3298,
+    3297, 3295, 3294, 3292, 3291, 3289, 3288, 3287, 3286, 3284, 3283, 3283,
+    3282, 3281, 3281, 3280, 3280, 3280, 3280, 3280, 3280, 3280, 3281, 3281,
+    3282, 3283, 3283, 3284, 3286, 3287, 3288, 3289, 3291, 3292, 3294, 3295,
+    3297, 3299, 3300, 3302, 3303, 3305, 3306, 3308, 3309, 3311, 3312, 3313,
+    3314, 3315, 3316, 3317, 3318, 3318, 3319, 3319, 3319, 3319, 3319, 3319,
+    3319, 3319, 3318, 3317, 3317, 3316, 3315, 3314, 3313, 3311, 3310, 3309,
+    3307, 3306, 3304, 3303, 3301, 3299, 3298, 3296,
+};
+
+constexpr bool matches_legacy() {
+    for (size_t i = 0; i < COUNT; i++)
+        if (heading_deci(i) != LEGACY_DECI[i])
+            return false;
+    return true;
+}
+
+static_assert(matches_legacy(), "default headings must reproduce input_files/in-o.txt");
+
+constexpr Image build() {
+    Image img  = {};
+    char  tmp[NMEA_HDT_MAX] = {};
+    for (size_t i = 0; i < COUNT; i++) {
+        makeHDTFixed(heading_deci(i), tmp);
+        for (size_t j = 0; j < STRIDE; j++)
+            img.bytes[i * STRIDE + j] = tmp[j];
+    }
+    return img;
+}
+
+constexpr Deci build_deci() {
+    Deci d = {};
+    for (size_t i = 0; i < COUNT; i++)
+        d.values[i] = heading_deci(i);
+    return d;
+}
+
+}  // namespace default_gen
+
+static constexpr default_gen::Image DEFAULT_IMAGE  = default_gen::build();
+static constexpr default_gen::Deci  DEFAULT_DECI   = default_gen::build_deci();
+static constexpr size_t             DEFAULT_COUNT  = default_gen::COUNT;
+static constexpr size_t             DEFAULT_STRIDE = default_gen::STRIDE;
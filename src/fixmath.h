@@ -0,0 +1,59 @@
+#pragma once
+
+/*
+ * fixmath.h
+ *
+ * Integer and compile-time maths for the FPU-less ESP32-C3.
+ *
+ *   const_sin()  double sine usable in constant expressions (table generation)
+ *   sin_q15()    run-time sine from a 256-entry quarter-wave table that is
+ *                itself built with const_sin(); phase is a Q32 fraction of a
+ *                turn, result is Q15 (-32767 .. 32767)
+ */
+
+#include <Arduino.h>
+
+constexpr double FIX_PI = 3.14159265358979323846;
+
+// Taylor series after reduction to [-pi, pi]; accurate to ~1e-15 there.
+constexpr double const_sin(double x) {
+    while (x >  FIX_PI) x -= 2 * FIX_PI;
+    while (x < -FIX_PI) x += 2 * FIX_PI;
+    double term = x;
+    double sum  = x;
+    for (int k = 1; k < 20; k++) {
+        term *= -x * x / ((2 * k) * (2 * k + 1));
+        sum  += term;
+    }
+    return sum;
+}
+
+#define SIN_Q15_QUARTER  256
+
+struct SinQuarterTable {
+    int16_t v[SIN_Q15_QUARTER + 1];
+};
+
+constexpr SinQuarterTable build_sin_quarter() {
+    SinQuarterTable t = {};
+    for (int i = 0; i <= SIN_Q15_QUARTER; i++) {
+        double s = const_sin(FIX_PI / 2 * i / SIN_Q15_QUARTER) * 32767.0;
+        t.v[i] = (int16_t)(s + 0.5);
+    }
+    return t;
+}
+
+static constexpr SinQuarterTable SIN_QUARTER = build_sin_quarter();
+
+// sin(2*pi * phase / 2^32) in Q15, linear interpolation between table steps.
+inline int32_t sin_q15(uint32_t phase) {
+    uint32_t quadrant = phase >> 30;
+    uint32_t pos      = (phase >> 14) & 0xFFFF;            // 16-bit position in quadrant
+    if (quadrant & 1) pos = 0x10000 - pos;                 // falling quarter
+    uint32_t idx  = pos >> 8;                              // 0 .. 256
+    uint32_t frac = pos & 0xFF;
+    int32_t  a    = SIN_QUARTER.v[idx];
+    int32_t  b    = SIN_QUARTER.v[idx < SIN_Q15_QUARTER ? idx + 1 : idx];
+    int32_t  s    = a + (((b - a) * (int32_t)frac) >> 8);
+    return (quadrant & 2) ? -s : s;
+}
@@ -11,15 +11,17 @@
  *
  * Controls:
  *   - Centre heading  : editable number field, pre-filled from the URL param
- *   - Waveform        : sine or sawtooth drop-down
- *   - Periods         : 1 – 10 (how many complete cycles across 125 entries)
+ *   - Waveform        : sine, sawtooth, triangle, square or random walk
+ *   - Length          : sentences per cycle (default 125)
+ *   - Periods         : 1 – 10 (how many complete cycles across the length)
  *   - Amplitude       : 0.1 – 5.0 degrees peak deviation from centre
+ *   - Step            : random walk only, 0.1 – 2.0 degrees largest move
  *
  * A small canvas below the controls shows the shape of the selected waveform
  * and updates live as sliders are moved.
  *
- * The Generate button computes 125 heading values and POSTs them to /update
- * in the same format as the main page, then shows a confirmation.
+ * The Generate button POSTs just the parameters to /wave; the ESP32
+ * computes each heading itself at transmit time (waveform.h).
  */
 
 static const char FUNC_PAGE[] = R"html(
@@ -203,7 +205,7 @@ static const char FUNC_PAGE[] = R"html(
 <body>
 
   <h2>Function Generator</h2>
-  <p id="subtitle">125 headings oscillating around a centre course</p>
+  <p id="subtitle">Headings oscillating around a centre course</p>
 
   <!-- ------------------------------------------------------------------ -->
   <!-- Generator form — hidden after a successful POST                     -->
@@ -227,10 +229,24 @@ static const char FUNC_PAGE[] = R"html(
       <select id="func-select" onchange="updatePreview()">
         <option value="sine">Sine</option>
         <option value="sawtooth">Sawtooth</option>
+        <option value="triangle">Triangle</option>
+        <option value="square">Square</option>
+        <option value="random">Random walk</option>
       </select>
     </div>
 
-    <!-- Periods: 1 – 10 complete cycles across the 125 entries -->
+    <!-- Length: sentences per cycle -->
+    <div class="field">
+      <label for="length">Length</label>
+      <div class="field-row">
+        <input type="number" id="length"
+               min="2" max="1000000" step="1" value="125"
+               oninput="updateGenLabel(); updatePreview();">
+        <span class="unit">sentences</span>
+      </div>
+    </div>
+
+    <!-- Periods: 1 – 10 complete cycles across the sequence -->
     <div class="field">
       <div class="slider-header">
         <label for="periods">Periods</label>
@@ -251,6 +267,18 @@ static const char FUNC_PAGE[] = R"html(
              oninput="updateAmpVal(this.value); updatePreview();">
     </div>
 
+    <!-- Step: random walk only, largest move per sentence -->
+    <div class="field" id="step-field" style="display: none;">
+      <div class="slider-header">
+        <label for="step">Step</label>
+        <span id="step-val" class="slider-val">0.2&deg;</span>
+      </div>
+      <input type="range" id="step" min="0.1" max="2.0" step="0.1" value="0.2"
+             oninput="document.getElementById('step-val').textContent =
+                        parseFloat(this.value).toFixed(1) + '\u00b0';
+                      updatePreview();">
+    </div>
+
     <!-- Waveform preview: shows shape only, no axes or labels -->
     <canvas id="preview" width="240" height="80"></canvas>
 
@@ -268,7 +296,7 @@ static const char FUNC_PAGE[] = R"html(
   <div id="done">
     <div class="checkmark">&#10003;</div>
     <div class="done-title">Array updated</div>
-    <div class="done-sub">125 sentences loaded to NMEA emulator</div>
+    <div class="done-sub" id="done-sub">Waveform running on NMEA emulator</div>
     <p class="back-link" style="margin-top: 18px;"><a href="/">&larr; Back to compass</a></p>
   </div>
 
@@ -289,7 +317,18 @@ static const char FUNC_PAGE[] = R"html(
         parseFloat(v).toFixed(1) + '\u00b0';
     }
 
-    // --- Waveform functions (both normalised to -1 .. +1) ---
+    function lengthVal() {
+      const n = parseInt(document.getElementById('length').value);
+      return isNaN(n) || n < 2 ? 2 : n;
+    }
+
+    function updateGenLabel() {
+      document.getElementById('gen-btn').textContent =
+        'Generate ' + lengthVal() + ' sentences';
+    }
+
+    // --- Waveform functions (all normalised to -1 .. +1) ---
+    // Preview only: the ESP32 generates the real headings (waveform.cpp).
     function sineAt(t) {
       return Math.sin(2 * Math.PI * t);
     }
@@ -299,30 +338,35 @@ static const char FUNC_PAGE[] = R"html(
       return 2 * (t - Math.floor(t)) - 1;
     }
 
-    function waveAt(func, t) {
-      return func === 'sine' ? sineAt(t) : sawtoothAt(t);
+    function triangleAt(t) {
+      // 0 -> +1 -> -1 -> 0 per period, in phase with the sine.
+      const p = t - Math.floor(t);
+      if (p < 0.25) return 4 * p;
+      if (p < 0.75) return 2 - 4 * p;
+      return 4 * p - 4;
     }
 
-    // --- Compute 125 heading values ---
-    // t spans [0, periods] across indices 0..124 (inclusive on both ends).
-    function computeValues() {
-      const centre  = parseFloat(document.getElementById('centre').value) || 0;
-      const func    = document.getElementById('func-select').value;
-      const periods = parseInt(document.getElementById('periods').value);
-      const amp     = parseFloat(document.getElementById('amplitude').value);
-      const values  = [];
+    function squareAt(t) {
+      return (t - Math.floor(t)) < 0.5 ? 1 : -1;
+    }
 
-      for (let i = 0; i < 125; i++) {
-        const t = (i / 124) * periods;
-        const f = waveAt(func, t);
+    // Random walk preview: a fixed pseudo-random path, reflected at +/- 1.
+    let walkSeed = 1;
+    function randomAt(prev, stepFrac) {
+      walkSeed = (walkSeed * 1103515245 + 12345) & 0x7fffffff;
+      let f = prev + (2 * (walkSeed / 0x7fffffff) - 1) * stepFrac;
+      if (f >  1) f =  2 - f;
+      if (f < -1) f = -2 - f;
+      return Math.max(-1, Math.min(1, f));
+    }
 
-        // Centre + amplitude * normalised wave, wrapped to [0, 360)
-        let h = centre + amp * f;
-        h = ((h % 360) + 360) % 360;
-        h = Math.round(h * 10) / 10;
-        values.push(h);
+    function waveAt(func, t) {
+      switch (func) {
+        case 'sawtooth': return sawtoothAt(t);
+        case 'triangle': return triangleAt(t);
+        case 'square':   return squareAt(t);
+        default:         return sineAt(t);
       }
-      return values;
     }
 
     // --- Draw waveform preview ---
@@ -335,7 +379,13 @@ static const char FUNC_PAGE[] = R"html(
       const H       = canvas.height;
       const func    = document.getElementById('func-select').value;
       const periods = parseInt(document.getElementById('periods').value);
+      const amp     = parseFloat(document.getElementById('amplitude').value);
+      const step    = parseFloat(document.getElementById('step').value);
       const PAD     = 6;   // vertical padding in pixels
+      const N       = 125; // plotted points, whatever the length
+
+      document.getElementById('step-field').style.display =
+        func === 'random' ? 'block' : 'none';
 
       ctx.clearRect(0, 0, W, H);
       ctx.beginPath();
@@ -343,11 +393,14 @@ static const char FUNC_PAGE[] = R"html(
       ctx.lineWidth   = 2;
       ctx.lineJoin    = 'round';
 
-      for (let i = 0; i < 125; i++) {
-        const t = (i / 124) * periods;
-        const f = waveAt(func, t);   // -1 .. +1
+      walkSeed = 1;
+      let f = 0;
+      for (let i = 0; i < N; i++) {
+        const t = (i / (N - 1)) * periods;
+        f = func === 'random' ? randomAt(f, step / amp)
+                              : waveAt(func, t);   // -1 .. +1
 
-        const x = (i / 124) * (W - 1);
+        const x = (i / (N - 1)) * (W - 1);
         // Map f: +1 → top edge (PAD), -1 → bottom edge (H - PAD)
         const y = PAD + (1 - (f + 1) / 2) * (H - 2 * PAD);
 
@@ -357,33 +410,42 @@ static const char FUNC_PAGE[] = R"html(
       ctx.stroke();
     }
 
-    // --- Generate and POST to /update ---
+    // --- POST the parameters to /wave ---
+    // Only the parameters travel; the ESP32 computes every heading.
     function generate() {
-      const values  = computeValues();
-      const payload = values.map(v => v.toFixed(1)).join(',');
+      const centre  = parseFloat(document.getElementById('centre').value) || 0;
+      const query   = new URLSearchParams({
+        shape:   document.getElementById('func-select').value,
+        centre:  (((centre % 360) + 360) % 360).toFixed(1),
+        amp:     parseFloat(document.getElementById('amplitude').value).toFixed(1),
+        periods: document.getElementById('periods').value,
+        length:  lengthVal(),
+        step:    parseFloat(document.getElementById('step').value).toFixed(1)
+      });
       const btn     = document.getElementById('gen-btn');
 
       btn.disabled    = true;
       btn.textContent = 'Sending\u2026';
 
-      fetch('/update', {
-        method:  'POST',
-        headers: { 'Content-Type': 'text/plain' },
-        body:    payload
-      })
-      .then(response => response.text())
-      .then(() => {
+      fetch('/wave?' + query.toString(), { method: 'POST' })
+      .then(response => {
+        if (!response.ok) return response.text().then(t => { throw new Error(t); });
+        document.getElementById('done-sub').textContent =
+          lengthVal() + '-sentence waveform running on NMEA emulator';
         document.getElementById('generator').style.display = 'none';
         document.getElementById('done').style.display      = 'block';
       })
-      .catch(() => {
-        alert('Failed to send to ESP32. Are you still connected to NMEA-EMU?');
-        btn.disabled    = false;
-        btn.textContent = 'Generate 125 sentences';
+      .catch(err => {
+        alert(err.message && err.message !== 'Failed to fetch'
+              ? 'ESP32 rejected the waveform: ' + err.message
+              : 'Failed to send to ESP32. Are you still connected to NMEA-EMU?');
+        btn.disabled = false;
+        updateGenLabel();
       });
     }
 
     // Draw preview on page load
+    updateGenLabel();
     updatePreview();
   </script>
 
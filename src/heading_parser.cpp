@@ -0,0 +1,409 @@
+/*
+ * heading_parser.cpp
+ *
+ * Streaming /update body readers — see heading_parser.h.
+ */
+
+#include "heading_parser.h"
+#include "nmea.h"
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "binary uploads are copied as-is: little-endian hosts only");
+
+// ---------------------------------------------------------------------------
+// Text
+// ---------------------------------------------------------------------------
+
+// Largest magnitude that fits int16 deci-degrees (3276.7°).
+static const int32_t DECI_LIMIT = 32767;
+
+// Half-width of the band around a tie, in units of fraction digits 2 .. 5
+// (1e-5°).  The float nearest a value below 3276.8° is within 2^-13° of
+// it, 1.2e-4°; outside the band that cannot move it across the tie.
+static const uint16_t TIE_BAND = 20;
+
+// Round |value| * 10 to whole deci-degrees.  `deci` is the value's
+// integer digits and first fraction digit, `rest` the next four digits
+// (0 .. 9999).  Near a tie, the float toFloat() made of `text` decides.
+static int32_t round_deci(int32_t deci, uint16_t rest, const char* text) {
+    if (rest < 5000 - TIE_BAND)
+        return deci;
+    if (rest > 5000 + TIE_BAND)
+        return deci + 1;
+    uint32_t tenths;
+    if (!nmea_tenths((float)atof(text), &tenths))
+        return deci + 1;
+    return (int32_t)tenths;
+}
+
+void HeadingParser::begin(HeadingBuffer* out) {
+    out_      = out;
+    out_->clear();
+    pos_      = 0;
+    error_    = nullptr;
+    error_pos_ = 0;
+    state_    = EXPECT_VALUE;
+    any_      = false;
+}
+
+bool HeadingParser::fail(const char* msg, size_t at) {
+    if (!error_) {
+        error_     = msg;
+        error_pos_ = at;
+    }
+    return false;
+}
+
+bool HeadingParser::commit() {
+    if (!digits_) {
+        return fail("sign without digits", value_pos_);
+    }
+    uint16_t rest = rest_;
+    for (uint8_t n = frac_n_ ? frac_n_ - 1 : 0; n < 4; n++)
+        rest *= 10;
+    text_[text_len_] = '\0';
+    int32_t v = round_deci(deci_, rest, text_);
+    if (v > DECI_LIMIT) {
+        return fail("value out of range", value_pos_);
+    }
+    int16_t d = (int16_t)(neg_ ? -v : v);
+    if (neg_ && v == 0)
+        d = DECI_NEG_ZERO;
+    if (!out_->push(d)) {
+        return fail(out_->count >= SEQ_MAX_ENTRIES ? "too many values" : "out of memory",
+                    value_pos_);
+    }
+    state_ = AFTER_VALUE;
+    return true;
+}
+
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool HeadingParser::feed(const char* data, size_t len) {
+    if (error_) return false;
+
+    for (size_t i = 0; i < len; i++, pos_++) {
+        char c = data[i];
+
+        switch (state_) {
+        case EXPECT_VALUE:
+            if (is_space(c)) break;
+            if (c == ',') return fail("empty value", pos_);
+            value_pos_ = pos_;
+            neg_       = false;
+            digits_    = false;
+            deci_      = 0;
+            frac_n_    = 0;
+            rest_      = 0;
+            text_[0]   = c;
+            text_len_  = 1;
+            any_       = true;
+            if (c == '-' || c == '+') {
+                neg_   = (c == '-');
+                state_ = IN_INT;
+                break;
+            }
+            if (c == '.') { state_ = IN_FRAC; break; }
+            if (c < '0' || c > '9') return fail("unexpected character", pos_);
+            deci_   = (c - '0') * 10;
+            digits_ = true;
+            state_  = IN_INT;
+            break;
+
+        case IN_INT:
+            if (c >= '0' && c <= '9') {
+                deci_   = deci_ * 10 + (c - '0') * 10;
+                digits_ = true;
+                if (deci_ > DECI_LIMIT) return fail("value out of range", value_pos_);
+                if (text_len_ < HEADING_TEXT_MAX) text_[text_len_++] = c;
+            } else if (c == '.') {
+                state_ = IN_FRAC;
+                if (text_len_ < HEADING_TEXT_MAX) text_[text_len_++] = c;
+            } else if (c == ',') {
+                if (!commit()) return false;
+                state_ = EXPECT_VALUE;
+            } else if (is_space(c)) {
+                if (!commit()) return false;
+            } else {
+                return fail("unexpected character", pos_);
+            }
+            break;
+
+        case IN_FRAC:
+            if (c >= '0' && c <= '9') {
+                if (frac_n_ == 0)     deci_ += c - '0';
+                else if (frac_n_ < 5) rest_ = (uint16_t)(rest_ * 10 + (c - '0'));
+                if (frac_n_ < 5) frac_n_++;
+                digits_ = true;
+                if (text_len_ < HEADING_TEXT_MAX) text_[text_len_++] = c;
+            } else if (c == ',') {
+                if (!commit()) return false;
+                state_ = EXPECT_VALUE;
+            } else if (is_space(c)) {
+                if (!commit()) return false;
+            } else {
+                return fail("unexpected character", pos_);
+            }
+            break;
+
+        case AFTER_VALUE:
+            if (is_space(c)) break;
+            if (c != ',') return fail("expected ','", pos_);
+            state_ = EXPECT_VALUE;
+            break;
+        }
+    }
+    return true;
+}
+
+bool HeadingParser::finish() {
+    if (error_) return false;
+    if (state_ == IN_INT || state_ == IN_FRAC) {
+        if (!commit()) return false;
+    }
+    if (!any_) return fail("no values", pos_);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Binary
+// ---------------------------------------------------------------------------
+
+static const size_t  BIN_HEADER_LEN = 8;
+static const int16_t BIN_MARKER     = INT16_MIN;
+
+void HeadingBinReader::begin(HeadingBuffer* out, size_t length) {
+    out_         = out;
+    out_->clear();
+    pos_         = 0;
+    error_       = nullptr;
+    error_pos_   = 0;
+    has_header_  = false;
+    expect_      = 0;
+    interval_ms_ = 0;
+
+    // Room for every value the body can hold (the header, if any, makes
+    // this four entries more than needed).
+    if (length / 2 > SEQ_MAX_ENTRIES + BIN_HEADER_LEN / 2)
+        fail("too many values", 0);
+    else if (!out_->reserve(length / 2 < SEQ_MAX_ENTRIES ? length / 2 : SEQ_MAX_ENTRIES))
+        fail("out of memory", 0);
+}
+
+bool HeadingBinReader::fail(const char* msg, size_t at) {
+    if (!error_) {
+        error_     = msg;
+        error_pos_ = at;
+    }
+    return false;
+}
+
+// Append whole values from `data` (n of them), checking for the marker.
+bool HeadingBinReader::store(const char* data, size_t n) {
+    if (!out_->reserve(out_->count + n))
+        return fail(out_->count + n > SEQ_MAX_ENTRIES ? "too many values" : "out of memory", pos_);
+    size_t         first = out_->count;
+    out_->append(data, n);
+    const int16_t* v     = out_->data + first;
+    for (size_t i = 0; i < n; i++)
+        if (v[i] == BIN_MARKER)
+            return fail("value out of range", pos_ + 2 * i);
+    return true;
+}
+
+bool HeadingBinReader::feed(const char* data, size_t len) {
+    if (error_) return false;
+
+    // The first two bytes tell whether there is a header; collect them,
+    // and the rest of the header if so.
+    while (len && (pos_ < 2 || (has_header_ && pos_ < BIN_HEADER_LEN))) {
+        head_[pos_++] = (uint8_t)*data++;
+        len--;
+        if (pos_ == 2) {
+            if ((int16_t)(head_[0] | head_[1] << 8) == BIN_MARKER) {
+                has_header_ = true;
+            } else {
+                pos_ = 0;                           // not a header: a value
+                if (!store((const char*)head_, 1)) return false;
+                pos_ = 2;
+            }
+        } else if (has_header_ && pos_ == BIN_HEADER_LEN) {
+            interval_ms_ = (uint16_t)(head_[2] | head_[3] << 8);
+            expect_      = (uint32_t)head_[4] | (uint32_t)head_[5] << 8
+                         | (uint32_t)head_[6] << 16 | (uint32_t)head_[7] << 24;
+            if (expect_ > SEQ_MAX_ENTRIES) return fail("too many values", 4);
+        }
+    }
+    if (!len) return true;
+
+    // A value split across chunks: finish it first.
+    if ((pos_ & 1) && len) {
+        char v[2] = { (char)odd_, *data++ };
+        len--;
+        pos_--;
+        if (!store(v, 1)) return false;
+        pos_ += 2;
+    }
+    size_t n = len / 2;
+    if (n) {
+        if (!store(data, n)) return false;
+        pos_ += 2 * n;
+    }
+    if (len & 1) {
+        odd_ = (uint8_t)data[len - 1];
+        pos_++;
+    }
+    return true;
+}
+
+bool HeadingBinReader::finish() {
+    if (error_) return false;
+    if (pos_ & 1) return fail("odd length", pos_);
+    if (has_header_ && pos_ < BIN_HEADER_LEN) return fail("short header", pos_);
+    if (has_header_ && out_->count != expect_) return fail("count does not match header", pos_);
+    if (out_->count == 0) return fail("no values", pos_);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Keyframes
+// ---------------------------------------------------------------------------
+
+// Seconds with up to three decimals ("12", "2.5", "0.125") in ms.
+static bool parse_ms(const char* text, uint32_t* out) {
+    uint32_t ms     = 0;
+    bool     digits = false;
+    int      frac_n = 0;
+
+    for (; *text >= '0' && *text <= '9'; text++) {
+        ms     = ms * 10 + (uint32_t)(*text - '0');
+        digits = true;
+        if (ms > 2000000) return false;              // 23 days
+    }
+    if (*text == '.') {
+        for (text++; *text >= '0' && *text <= '9' && frac_n < 3; text++, frac_n++) {
+            ms     = ms * 10 + (uint32_t)(*text - '0');
+            digits = true;
+        }
+    }
+    if (!digits || *text != '\0') return false;
+    for (; frac_n < 3; frac_n++)
+        ms *= 10;
+    *out = ms;
+    return true;
+}
+
+void KeyframeParser::begin(KeyframeTrack* out) {
+    out_       = out;
+    out_->clear();
+    pos_       = 0;
+    line_pos_  = 0;
+    error_     = nullptr;
+    error_pos_ = 0;
+    len_       = 0;
+    comment_   = false;
+}
+
+bool KeyframeParser::fail(const char* msg, size_t at) {
+    if (!error_) {
+        error_     = msg;
+        error_pos_ = at;
+    }
+    return false;
+}
+
+// Split the collected line into time and heading and add the keyframe.
+bool KeyframeParser::end_line() {
+    static const char SEP[] = " \t,";
+    line_[len_] = '\0';
+    len_        = 0;
+    comment_    = false;
+
+    char* t = line_ + strspn(line_, SEP);
+    if (*t == '\0')
+        return true;                                  // blank line
+    char* h = t + strcspn(t, SEP);
+    if (*h) *h++ = '\0';
+    h += strspn(h, SEP);
+    char* end = h + strcspn(h, SEP);
+    if (*end) *end++ = '\0';
+    if (*h == '\0' || end[strspn(end, SEP)] != '\0')
+        return fail("expected time,heading", line_pos_);
+
+    uint32_t ms;
+    int32_t  deci;
+    if (!parse_ms(t, &ms))
+        return fail("bad time", line_pos_);
+    if (!parse_deci(h, &deci) || deci < 0 || deci > 3600)
+        return fail("bad heading", line_pos_);
+    if (out_->count() && ms <= last_ms_)
+        return fail("times must increase", line_pos_);
+    if (!out_->add(ms, (int16_t)(deci % 3600)))
+        return fail("too many keyframes", line_pos_);
+    last_ms_ = ms;
+    return true;
+}
+
+bool KeyframeParser::feed(const char* data, size_t len) {
+    if (error_) return false;
+
+    for (size_t i = 0; i < len; i++, pos_++) {
+        char c = data[i];
+        if (c == '\n' || c == ';') {
+            if (!end_line()) return false;
+            line_pos_ = pos_ + 1;
+        } else if (comment_ || c == '\r') {
+            continue;
+        } else if (c == '#') {
+            comment_ = true;
+        } else if (len_ < KEY_LINE_MAX) {
+            line_[len_++] = c;
+        } else {
+            return fail("line too long", line_pos_);
+        }
+    }
+    return true;
+}
+
+bool KeyframeParser::finish() {
+    if (error_) return false;
+    if (!end_line()) return false;
+    if (out_->count() < 2) return fail("need at least two keyframes", pos_);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Single values
+// ---------------------------------------------------------------------------
+
+bool parse_deci(const char* text, int32_t* out) {
+    const char* start  = text;
+    bool        neg    = false;
+    bool        digits = false;
+    int32_t     deci   = 0;
+    int         frac_n = 0;
+    uint16_t    rest   = 0;
+
+    if (*text == '-' || *text == '+') neg = (*text++ == '-');
+    for (; *text >= '0' && *text <= '9'; text++) {
+        deci   = deci * 10 + (*text - '0') * 10;
+        digits = true;
+        if (deci > 10000000) return false;
+    }
+    if (*text == '.') {
+        for (text++; *text >= '0' && *text <= '9'; text++, frac_n++) {
+            if (frac_n == 0)     deci += *text - '0';
+            else if (frac_n < 5) rest = (uint16_t)(rest * 10 + (*text - '0'));
+            digits = true;
+        }
+    }
+    if (!digits || *text != '\0') return false;
+
+    for (int n = frac_n ? frac_n - 1 : 0; n < 4; n++)
+        rest *= 10;
+    deci = round_deci(deci, rest, start);
+    *out = neg ? -deci : deci;
+    return true;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+/*
+ * heading_parser.h
+ *
+ * Readers for the two /update body formats and the /keys keyframe list.
+ *
+ * HeadingParser: single-pass, zero-allocation parser for a comma-
+ * separated list of headings in degrees, e.g. "328.9, 329.0,329.2,".
+ *
+ * Input may arrive in chunks of any size (HTTP raw-body callbacks); feed()
+ * keeps just enough state to continue a number split across chunks.  Each
+ * value is rounded to 0.1° and appended as int16 deci-degrees to the
+ * caller's HeadingBuffer; the parser itself never allocates, only the
+ * buffer grows.  Rounding gives what the original toFloat() and "%.1f"
+ * sent: the decimal digits decide in integer arithmetic, except within
+ * 0.0002° of a tie such as 20.25, where the value's float decides
+ * (half to even on its binary value, nmea_tenths()).  A value with a minus
+ * sign that rounds to zero is stored as DECI_NEG_ZERO ("-0.0").  Values
+ * are limited to ±3276.7°, the int16 range; the original also sent larger
+ * ones.
+ *
+ * Accepted per value: optional sign, digits, optional '.' and fraction.
+ * Spaces, tabs and line breaks around values are ignored; one trailing
+ * comma is allowed.  Anything else stops the parse, and error() /
+ * error_offset() say what went wrong and at which byte of the body.
+ */
+
+#include <Arduino.h>
+#include "keyframes.h"
+#include "sequence.h"
+
+#define HEADING_TEXT_MAX  31
+
+class HeadingParser {
+public:
+    // Start a new body; values are appended to `out` after clearing it.
+    void begin(HeadingBuffer* out);
+
+    // Consume the next chunk.  Returns false once an error has occurred.
+    bool feed(const char* data, size_t len);
+
+    // End of body.  Returns false on error or if no value was found.
+    bool finish();
+
+    size_t      count()        const { return out_->count; }
+    bool        failed()       const { return error_ != nullptr; }
+    const char* error()        const { return error_; }
+    size_t      error_offset() const { return error_pos_; }
+
+private:
+    enum State : uint8_t { EXPECT_VALUE, IN_INT, IN_FRAC, AFTER_VALUE };
+
+    bool fail(const char* msg, size_t at);
+    bool commit();
+
+    HeadingBuffer* out_       = nullptr;
+    size_t         pos_       = 0;            // bytes consumed so far
+    size_t         value_pos_ = 0;            // where the current value started
+    const char*    error_     = nullptr;
+    size_t         error_pos_ = 0;
+
+    State          state_     = EXPECT_VALUE;
+    bool           neg_       = false;
+    bool           digits_    = false;        // at least one digit in this value
+    bool           any_       = false;        // at least one value started
+    int32_t        deci_      = 0;            // |value| * 10, before rounding
+    uint8_t        frac_n_    = 0;            // fraction digits seen, up to 5
+    uint16_t       rest_      = 0;            // fraction digits 2 .. 5
+
+    // The value as written, for the float near a tie; fraction digits
+    // that do not fit are dropped.
+    char           text_[HEADING_TEXT_MAX + 1];
+    uint8_t        text_len_  = 0;
+};
+
+// Binary body (Content-Type: application/octet-stream): int16 little-endian
+// deci-degrees, copied into the HeadingBuffer as they arrive with no
+// per-value parsing.  An optional 8-byte header may come first:
+//
+//   int16   -32768      marker; never a heading, so it cannot be mistaken
+//                       for the first value of a headerless body
+//   uint16  interval    TX interval in ms to switch to, 0 = keep
+//   uint32  count       number of values that follow
+//
+// With a header the body must hold exactly `count` values.  The buffer is
+// sized once from the Content-Length.  -32768 is rejected as a value.
+class HeadingBinReader {
+public:
+    // Start a new body of `length` bytes (0 if unknown).
+    void begin(HeadingBuffer* out, size_t length);
+
+    bool feed(const char* data, size_t len);
+    bool finish();
+
+    size_t      count()        const { return out_->count; }
+    uint16_t    interval_ms()  const { return interval_ms_; }
+    bool        failed()       const { return error_ != nullptr; }
+    const char* error()        const { return error_; }
+    size_t      error_offset() const { return error_pos_; }
+
+private:
+    bool fail(const char* msg, size_t at);
+    bool store(const char* data, size_t n);
+
+    HeadingBuffer* out_         = nullptr;
+    size_t         pos_         = 0;          // bytes consumed so far
+    const char*    error_       = nullptr;
+    size_t         error_pos_   = 0;
+
+    uint8_t        head_[8];                  // header, or the first value
+    bool           has_header_  = false;
+    uint32_t       expect_      = 0;          // header count
+    uint16_t       interval_ms_ = 0;
+    uint8_t        odd_         = 0;          // first byte of a split value
+};
+
+// Keyframe body (/keys): one "time,heading" pair per line, or pairs
+// separated by ';' (e.g. a form post), time in seconds with up to ms
+// precision, heading in degrees 0 .. 360.  Time and heading may also be
+// separated by spaces or tabs; '#' starts a comment that runs to the end
+// of the line.  Each line is collected in a small buffer, so a pair may
+// be split across chunks.  Times must increase.
+#define KEY_LINE_MAX  40
+
+class KeyframeParser {
+public:
+    // Start a new body; keyframes are added to `out` after clearing it.
+    void begin(KeyframeTrack* out);
+
+    bool feed(const char* data, size_t len);
+    bool finish();
+
+    size_t      count()        const { return out_->count(); }
+    const char* error()        const { return error_; }
+    size_t      error_offset() const { return error_pos_; }
+
+private:
+    bool fail(const char* msg, size_t at);
+    bool end_line();
+
+    KeyframeTrack* out_       = nullptr;
+    size_t         pos_       = 0;            // bytes consumed so far
+    size_t         line_pos_  = 0;            // where the current line started
+    const char*    error_     = nullptr;
+    size_t         error_pos_ = 0;
+
+    char           line_[KEY_LINE_MAX + 1];
+    size_t         len_       = 0;
+    bool           comment_   = false;
+    uint32_t       last_ms_   = 0;
+};
+
+// Parse one complete decimal value such as "330.5" or "-2" into deci-units
+// with the same rounding as HeadingParser ("-0.0" comes back as 0).  Used
+// for query parameters.
+bool parse_deci(const char* text, int32_t* out);
@@ -0,0 +1,115 @@
+/*
+ * keyframes.cpp
+ *
+ * Keyframe heading track — see keyframes.h.
+ */
+
+#include "keyframes.h"
+
+bool key_interp_from_name(const char* name, KeyInterp* out) {
+    static const char* const NAMES[] = { "linear", "cubic" };
+    for (uint8_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); i++) {
+        if (strcmp(name, NAMES[i]) == 0) {
+            *out = (KeyInterp)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool KeyframeTrack::add(uint32_t t_ms, int16_t deci) {
+    if (n_ >= KEY_MAX)
+        return false;
+    keys_[n_].t_ms = t_ms;
+    keys_[n_].deci = deci;
+    n_++;
+    return true;
+}
+
+const char* KeyframeTrack::configure(KeyInterp interp, bool shortest_arc, uint32_t tick_ms) {
+    if (n_ < 2)
+        return "need at least two keyframes";
+    if (tick_ms == 0)
+        return "bad interval";
+    for (size_t k = 1; k < n_; k++)
+        if (keys_[k].t_ms <= keys_[k - 1].t_ms)
+            return "keyframe times must increase";
+
+    // Times from the first keyframe; headings unwrapped so that each step
+    // is the shorter way round (idempotent, so a second call is harmless).
+    uint32_t t0   = keys_[0].t_ms;
+    int32_t  prev = keys_[0].deci;
+    for (size_t k = 0; k < n_; k++) {
+        keys_[k].t_ms -= t0;
+        if (!shortest_arc || k == 0)
+            continue;
+        int32_t raw   = keys_[k].deci;
+        int32_t delta = ((raw - prev) % 3600 + 3600) % 3600;
+        if (delta > 1800)
+            delta -= 3600;
+        keys_[k].deci = keys_[k - 1].deci + delta;
+        prev          = raw;
+    }
+
+    interp_      = interp;
+    tick_ms_     = tick_ms;
+    duration_ms_ = keys_[n_ - 1].t_ms;
+    t_ms_        = 0;
+    enter(0);
+    return nullptr;
+}
+
+// Set up segment k (keyframe k to k + 1) for u = 0 .. 1.
+void KeyframeTrack::enter(size_t k) {
+    const Keyframe& k0 = keys_[k];
+    const Keyframe& k1 = keys_[k + 1];
+    uint32_t        len = k1.t_ms - k0.t_ms;
+    int64_t         dh  = (int64_t)(k1.deci - k0.deci) * 65536;
+
+    seg_ = k;
+    inv_ = (1ull << 62) / len;
+    a_   = (int64_t)k0.deci * 65536;
+    if (interp_ == KEY_LINEAR) {
+        b_ = dh;
+        c_ = d_ = 0;
+        return;
+    }
+
+    // Slope at keyframe i from its neighbours (one-sided at the ends),
+    // scaled to this segment's length: deci-degrees per unit u, Q16.
+    auto slope = [this, len](size_t i) {
+        size_t  lo = i > 0 ? i - 1 : i;
+        size_t  hi = i + 1 < n_ ? i + 1 : i;
+        int64_t dv = (int64_t)(keys_[hi].deci - keys_[lo].deci) * 65536;
+        return dv * (int64_t)len / (int64_t)(keys_[hi].t_ms - keys_[lo].t_ms);
+    };
+    int64_t m0 = slope(k);
+    int64_t m1 = slope(k + 1);
+
+    // Cubic Hermite: p(0) = h0, p(1) = h1, p'(0) = m0, p'(1) = m1.
+    b_ = m0;
+    c_ = 3 * dh - 2 * m0 - m1;
+    d_ = -2 * dh + m0 + m1;
+}
+
+int16_t KeyframeTrack::next(size_t index) {
+    if (index == 0) {
+        t_ms_ = 0;
+        enter(0);
+    } else {
+        t_ms_ += tick_ms_;
+    }
+    while (seg_ + 2 < n_ && t_ms_ >= keys_[seg_ + 1].t_ms)
+        enter(seg_ + 1);
+
+    // u = position in the segment, Q30; below 2^62 / 2^32 as dt < len.
+    uint32_t dt = t_ms_ - keys_[seg_].t_ms;
+    int64_t  u  = (int64_t)(((uint64_t)dt * inv_) >> 32);
+
+    // Horner; every product stays below 2^63 for headings within 0 .. 3599.
+    int64_t v = (((d_ * u >> 30) + c_) * u >> 30) + b_;
+    v = (v * u >> 30) + a_;
+
+    int32_t deci = (int32_t)((v + 0x8000) >> 16) % 3600;
+    return (int16_t)(deci < 0 ? deci + 3600 : deci);
+}
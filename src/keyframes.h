@@ -0,0 +1,92 @@
+#pragma once
+
+/*
+ * keyframes.h
+ *
+ * Heading track from sparse (time, heading) keyframes, interpolated on
+ * the device at the TX rate.  Like a waveform (waveform.h) the table
+ * holds no headings: the TX task asks for one per tick, so the upload is
+ * the same few keyframes whatever the output rate, and a cycle is as long
+ * as the last keyframe's time.
+ *
+ *   linear   straight lines between keyframes
+ *   cubic    Hermite segments through every keyframe, with each slope
+ *            taken from its two neighbours (Catmull-Rom for uneven
+ *            spacing), so the rate of turn has no steps
+ *
+ * With shortest-arc on (the default) each keyframe is reached from the
+ * one before by the shorter way round, so 350° -> 10° turns 20° through
+ * north instead of 340° back; off, headings are interpolated as plain
+ * numbers.  Headings are unwrapped once at configure(); the output is
+ * wrapped into 0.0 .. 359.9.
+ *
+ * Work per tick is constant: the time advances by one interval, the
+ * segment pointer moves on when a keyframe is passed (its coefficients
+ * are computed then, once per segment), and the segment polynomial is
+ * evaluated in Q16 fixed point with three multiplies.
+ *
+ * The track is resampled to the TX interval given to configure(); after a
+ * rate change it keeps its tick count, so upload it again to keep its
+ * timing.
+ */
+
+#include <Arduino.h>
+
+#ifndef KEY_MAX
+#define KEY_MAX  256
+#endif
+
+enum KeyInterp : uint8_t {
+    KEY_LINEAR = 0,
+    KEY_CUBIC,
+};
+
+struct Keyframe {
+    uint32_t t_ms;
+    int32_t  deci;          // 0 .. 3599 as added, unwrapped by configure()
+};
+
+// Parse "linear", "cubic".
+bool key_interp_from_name(const char* name, KeyInterp* out);
+
+class KeyframeTrack {
+public:
+    // --- web task, while this track is not in use ---
+
+    void clear() { n_ = 0; }
+
+    // Append a keyframe; times must increase.  False when KEY_MAX are held.
+    bool add(uint32_t t_ms, int16_t deci);
+
+    // Prepare for playback at one heading per `tick_ms`.  nullptr on
+    // success, else why not.
+    const char* configure(KeyInterp interp, bool shortest_arc, uint32_t tick_ms);
+
+    size_t   count() const { return n_; }
+    uint32_t duration_ms() const { return duration_ms_; }
+
+    // Ticks per cycle: one per interval from the first keyframe up to,
+    // not including, the last one's time.
+    size_t ticks() const { return (duration_ms_ + tick_ms_ - 1) / tick_ms_; }
+
+    // --- TX task ---
+
+    // Heading for tick `index` of the cycle, deci-degrees 0 .. 3599.
+    // Must be called with consecutive indices, wrapping to 0.
+    int16_t next(size_t index);
+
+private:
+    void enter(size_t k);
+
+    Keyframe  keys_[KEY_MAX];
+    size_t    n_           = 0;
+    KeyInterp interp_      = KEY_LINEAR;
+    uint32_t  tick_ms_     = 100;
+    uint32_t  duration_ms_ = 0;
+
+    // TX task: position and current segment
+    uint32_t  t_ms_ = 0;
+    size_t    seg_  = 0;
+    uint64_t  inv_  = 0;                 // 2^62 / segment length
+    int64_t   a_ = 0, b_ = 0, c_ = 0, d_ = 0;   // a + b u + c u^2 + d u^3, Q16
+};
@@ -0,0 +1,90 @@
+/*
+ * led.cpp
+ *
+ * Timer-driven LED state machine — see led.h.
+ */
+
+#include "led.h"
+#include "trace.h"
+
+struct PatternDef {
+    uint16_t on_ms;
+    uint16_t off_ms;
+    uint8_t  flashes;
+};
+
+// Indexed by LedPattern.
+static const PatternDef PATTERNS[] = {
+    {  0,  0, 0 },   // LED_NONE
+    { 50,  0, 1 },   // LED_WRAP
+    { 30, 70, 3 },   // LED_MISSED
+};
+
+static uint8_t    led_pin       = 0;
+static bool       led_low       = false;
+static bool       led_lit       = false;
+static bool       upload_busy   = false;
+
+static LedPattern current       = LED_NONE;
+static bool       pending_start = false;
+static uint8_t    step          = 0;       // even = on phase, odd = off phase
+static uint32_t   step_end_ms   = 0;
+
+static void drive(bool on) {
+    if (on == led_lit) return;
+    led_lit = on;
+    digitalWrite(led_pin, (on != led_low) ? HIGH : LOW);
+    trace(TRACE_LED, on, 0, 0);
+}
+
+void led_begin(uint8_t pin, bool active_low) {
+    led_pin = pin;
+    led_low = active_low;
+    pinMode(pin, OUTPUT);
+    led_lit = true;          // force the first drive() to write the pin
+    drive(false);
+}
+
+void led_trigger(LedPattern pattern) {
+    if (pattern < current) return;
+    current       = pattern;
+    pending_start = true;
+}
+
+void led_set_upload(bool busy) {
+    upload_busy = busy;
+    drive(busy);
+}
+
+void led_service(uint32_t now_ms) {
+    if (upload_busy) {
+        drive(true);
+        return;
+    }
+    if (current == LED_NONE) {
+        drive(false);
+        return;
+    }
+
+    const PatternDef& p = PATTERNS[current];
+
+    if (pending_start) {
+        pending_start = false;
+        step          = 0;
+        step_end_ms   = now_ms + p.on_ms;
+        drive(true);
+        return;
+    }
+
+    if ((int32_t)(now_ms - step_end_ms) < 0) return;
+
+    step++;
+    if (step >= p.flashes * 2 - 1) {
+        current = LED_NONE;
+        drive(false);
+        return;
+    }
+    bool on = (step % 2) == 0;
+    step_end_ms = now_ms + (on ? p.on_ms : p.off_ms);
+    drive(on);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+/*
+ * led.h
+ *
+ * Non-blocking status LED.
+ *
+ * The LED is a small state machine advanced by led_service() from the loop
+ * task; nothing here ever calls delay(), so the TX path is never held up by
+ * a blink.  All calls come from the loop task: other tasks post their
+ * events in counters or flags that loop() turns into calls here.  Patterns, highest priority first:
+ *
+ *   upload     solid on while an HTTP upload is being applied
+ *   missed     three 30 ms flashes after a TX deadline was overrun
+ *   wrap       one 50 ms pulse when the sequence wraps to entry 0
+ *
+ * A higher-priority pattern pre-empts a lower one; a lower one requested
+ * while a higher one is running is dropped.
+ */
+
+#include <Arduino.h>
+
+enum LedPattern : uint8_t {
+    LED_NONE = 0,
+    LED_WRAP,
+    LED_MISSED,
+};
+
+void led_begin(uint8_t pin, bool active_low);
+
+// Start a one-shot pattern.  Safe to call on every event.
+void led_trigger(LedPattern pattern);
+
+// Hold the LED on while `busy` is true (HTTP upload in progress); loop()
+// passes on the flag the /update and /keys handlers set.
+void led_set_upload(bool busy);
+
+// Advance the state machine; call often (every loop pass).
+void led_service(uint32_t now_ms);
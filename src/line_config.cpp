@@ -0,0 +1,77 @@
+/*
+ * line_config.cpp
+ *
+ * Persistent output settings — see line_config.h.
+ */
+
+#include "line_config.h"
+#include <Preferences.h>
+
+static const uint32_t SUPPORTED_BAUD[] = { 4800, 9600, 19200, 38400, 57600, 115200 };
+
+// Longest sentence of any type for a three-digit heading.
+static const uint8_t LONGEST_BYTES = 21;      // $HEHDG,xxx.x,,,,*CS\r\n
+
+bool line_config_load(LineConfig* cfg) {
+    Preferences prefs;
+    prefs.begin("nmea", true);
+    bool found = prefs.isKey("baud");
+    if (found) {
+        cfg->baud        = prefs.getUInt("baud", cfg->baud);
+        cfg->interval_ms = prefs.getUShort("interval", cfg->interval_ms);
+        prefs.getBytes("mix", &cfg->mix, sizeof(cfg->mix));
+    }
+    prefs.end();
+    return found;
+}
+
+void line_config_save(const LineConfig& cfg) {
+    Preferences prefs;
+    prefs.begin("nmea", false);
+    prefs.putUInt("baud", cfg.baud);
+    prefs.putUShort("interval", cfg.interval_ms);
+    prefs.putBytes("mix", &cfg.mix, sizeof(cfg.mix));
+    prefs.end();
+}
+
+const char* line_config_check(const LineConfig& cfg, char* why, size_t why_len) {
+    bool baud_ok = false;
+    for (uint32_t b : SUPPORTED_BAUD)
+        baud_ok |= (cfg.baud == b);
+    if (!baud_ok) {
+        snprintf(why, why_len, "unsupported baud rate %u", (unsigned)cfg.baud);
+        return why;
+    }
+
+    if (cfg.interval_ms < LINE_MIN_INTERVAL_MS || cfg.interval_ms > LINE_MAX_INTERVAL_MS ||
+        1000 % cfg.interval_ms != 0) {
+        snprintf(why, why_len, "rate must divide 1000 ms, %u .. %u Hz",
+                 (unsigned)(1000 / LINE_MAX_INTERVAL_MS), (unsigned)(1000 / LINE_MIN_INTERVAL_MS));
+        return why;
+    }
+
+    uint32_t per_tick = cfg.baud / 10 * cfg.interval_ms / 1000;
+    if (per_tick < LONGEST_BYTES) {
+        snprintf(why, why_len, "%u bytes per tick at %u baud, a sentence needs %u",
+                 (unsigned)per_tick, (unsigned)cfg.baud, (unsigned)LONGEST_BYTES);
+        return why;
+    }
+
+    uint32_t load = talker_load_permille(cfg.mix, cfg.interval_ms, cfg.baud);
+    if (load > 1000) {
+        snprintf(why, why_len, "mix needs %u.%u %% of the line at %u baud",
+                 (unsigned)(load / 10), (unsigned)(load % 10), (unsigned)cfg.baud);
+        return why;
+    }
+    return nullptr;
+}
+
+void line_config_describe(const LineConfig& cfg, char* out, size_t out_len) {
+    uint32_t load = talker_load_permille(cfg.mix, cfg.interval_ms, cfg.baud);
+    snprintf(out, out_len,
+             "baud=%u rate=%uHz interval=%ums hdt=%u ths=%u rot=%u hdg=%u load=%u.%u%%\n",
+             (unsigned)cfg.baud, (unsigned)(1000 / cfg.interval_ms), (unsigned)cfg.interval_ms,
+             cfg.mix.every[SENT_HDT], cfg.mix.every[SENT_THS],
+             cfg.mix.every[SENT_ROT], cfg.mix.every[SENT_HDG],
+             (unsigned)(load / 10), (unsigned)(load % 10));
+}
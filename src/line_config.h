@@ -0,0 +1,36 @@
+#pragma once
+
+/*
+ * line_config.h
+ *
+ * Runtime output settings — UART baud rate, TX interval and sentence mix —
+ * kept in NVS (Preferences namespace "nmea") so they survive a reboot.
+ *
+ * line_config_check() is the single gate for every combination: supported
+ * baud rate, an interval that gives a whole number of ticks per second,
+ * a tick long enough for the longest enabled sentence, and an average load
+ * that the line can actually carry.  Anything it rejects is never stored
+ * or applied.
+ */
+
+#include <Arduino.h>
+#include "talker.h"
+
+#define LINE_MIN_INTERVAL_MS    20      // 50 Hz, IEC 61162-2 high-speed
+#define LINE_MAX_INTERVAL_MS  1000
+
+struct LineConfig {
+    uint32_t  baud;
+    uint16_t  interval_ms;
+    TalkerMix mix;
+};
+
+// Overwrite the fields found in NVS; false if nothing was stored.
+bool line_config_load(LineConfig* cfg);
+void line_config_save(const LineConfig& cfg);
+
+// nullptr if `cfg` is usable, otherwise why not (written into `why`).
+const char* line_config_check(const LineConfig& cfg, char* why, size_t why_len);
+
+// "baud=38400 rate=50Hz interval=20ms hdt=1 ... load=49.5%"
+void line_config_describe(const LineConfig& cfg, char* out, size_t out_len);
@@ -0,0 +1,66 @@
+/*
+ * live_heading.cpp
+ *
+ * Live-steer register — see live_heading.h.
+ */
+
+#include "live_heading.h"
+
+void LiveHeading::set(int16_t deci, uint16_t seq, uint32_t now_us) {
+    pos_.store(Position{ true, seq, deci, now_us });
+    received_ = received_ + 1;
+}
+
+void LiveHeading::release() {
+    pos_.store(Position{});
+}
+
+bool LiveHeading::take_ack(LiveAck* out) {
+    if (ack_.generation() == ack_gen_)
+        return false;
+    ack_gen_ = ack_.load(out);
+    return true;
+}
+
+LiveStats LiveHeading::stats() const {
+    LiveStats s;
+    s.received     = received_;
+    s.applied      = applied_;
+    s.coalesced    = s.received - s.applied;
+    s.wire_us_last = wire_last_;
+    s.wire_us_avg  = wire_avg_;
+    s.wire_us_max  = wire_max_;
+    return s;
+}
+
+bool LiveHeading::take(int16_t* deci, uint32_t now_us) {
+    Position p;
+    pos_.load(&p);
+    if (!p.active) {
+        have_taken_ = false;
+        return false;
+    }
+
+    *deci = p.deci;
+    if (!have_taken_ || p.seq != taken_seq_) {
+        taken_seq_  = p.seq;
+        have_taken_ = true;
+        take_wait_  = now_us - p.arrival_us;
+        note_due_   = true;
+    }
+    return true;
+}
+
+void LiveHeading::note_sent(uint32_t drain_us) {
+    if (!note_due_)
+        return;
+    note_due_ = false;
+
+    uint32_t wire = take_wait_ + drain_us;
+    applied_   = applied_ + 1;
+    wire_last_ = wire;
+    wire_avg_  = applied_ == 1 ? wire : wire_avg_ - wire_avg_ / 16 + wire / 16;
+    if (wire > wire_max_)
+        wire_max_ = wire;
+    ack_.store(LiveAck{ taken_seq_, wire });
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+/*
+ * live_heading.h
+ *
+ * Live-steer register: while the knob page is in live mode, each drag
+ * position arrives over the /live WebSocket and is stored here, and the
+ * TX task transmits it instead of the sequence (which pauses where it is
+ * and resumes when live mode ends).
+ *
+ * The register holds only the newest position, so updates coalesce to
+ * the TX rate by construction: however fast the page sends, each tick
+ * takes the latest value once and anything overwritten before that is
+ * counted as coalesced.  Position, sequence number and arrival time are
+ * published together through a Latch, so the TX task never sees a torn
+ * update; the same holds for the acks going back.
+ *
+ * Latency: for every position it takes, the TX task records the time from
+ * arrival to the moment its sentence has left the UART (queue time plus
+ * the bytes ahead of it on the wire).  The page adds the network half of a
+ * WebSocket round trip to show drag-to-wire latency.
+ *
+ * Frames, little-endian:
+ *
+ *   page -> device   'H' 0 seq:u16 deci:i16     new position (6 bytes)
+ *                    'R'                        end live mode
+ *                    'P' ...                    ping, echoed unchanged
+ *   device -> page   'A' 0 seq:u16 wire_us:u32  position `seq` is on the wire
+ */
+
+#include <Arduino.h>
+#include <atomic>
+
+#define LIVE_FRAME_HEADING  'H'
+#define LIVE_FRAME_RELEASE  'R'
+#define LIVE_FRAME_PING     'P'
+#define LIVE_FRAME_ACK      'A'
+
+#define LIVE_HEADING_LEN  6
+#define LIVE_ACK_LEN      8
+
+struct LiveStats {
+    uint32_t received;       // positions stored
+    uint32_t applied;        // positions transmitted
+    uint32_t coalesced;      // positions overwritten before a tick took them
+    uint32_t wire_us_last;   // arrival -> on the wire, last applied position
+    uint32_t wire_us_avg;    // moving average over the last ~16
+    uint32_t wire_us_max;
+};
+
+// Position `seq` has left the UART `wire_us` after it arrived.
+struct LiveAck {
+    uint16_t seq;
+    uint32_t wire_us;
+};
+
+// Single-writer register for values wider than 32 bits, which is as wide
+// as atomics are lock-free on the RV32 ESP32-C3.  The writer fills the slot
+// readers are not pointed at and publishes it by bumping the generation; a
+// reader copies the published slot and retries if the generation moved
+// meanwhile.  Neither side ever waits for the other, so the TX task may be
+// on either end.
+template <typename T>
+class Latch {
+public:
+    void store(const T& v) {
+        uint32_t g = gen_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot_[(g + 1) & 1] = v;
+        gen_.store(g + 1, std::memory_order_release);
+    }
+
+    // Copies the latest value; returns its generation.
+    uint32_t load(T* out) const {
+        uint32_t g;
+        do {
+            g    = gen_.load(std::memory_order_acquire);
+            *out = slot_[g & 1];
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while (gen_.load(std::memory_order_relaxed) != g);
+        return g;
+    }
+
+    uint32_t generation() const { return gen_.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<uint32_t> gen_{0};
+    T                     slot_[2] = {};
+};
+
+class LiveHeading {
+public:
+    // --- web task ---
+
+    // Store a new position and enter live mode.
+    void set(int16_t deci, uint16_t seq, uint32_t now_us);
+
+    // Leave live mode; the sequence resumes on the next tick.
+    void release();
+
+    bool active() const {
+        Position p;
+        pos_.load(&p);
+        return p.active;
+    }
+
+    LiveStats stats() const;
+
+    // --- loop() ---
+
+    // The latest position transmitted since the last call, if any.
+    bool take_ack(LiveAck* out);
+
+    // --- TX task ---
+
+    // Heading to send this tick if live mode is on.  `now_us` is the tick
+    // time; note_sent() is then called once the burst is queued.
+    bool take(int16_t* deci, uint32_t now_us);
+
+    // The burst holding the live heading leaves the UART in `drain_us`.
+    void note_sent(uint32_t drain_us);
+
+private:
+    struct Position {
+        bool     active;
+        uint16_t seq;
+        int16_t  deci;
+        uint32_t arrival_us;
+    };
+
+    Latch<Position>   pos_;                 // web task writes
+    Latch<LiveAck>    ack_;                 // TX task writes
+    uint32_t          ack_gen_  = 0;        // loop() only: generation last taken
+    volatile uint32_t received_ = 0;
+
+    // TX task only
+    uint16_t          taken_seq_  = 0;
+    bool              have_taken_ = false;
+    uint32_t          take_wait_  = 0;      // arrival -> tick of the new position
+    bool              note_due_   = false;
+    volatile uint32_t applied_    = 0;
+    volatile uint32_t wire_last_  = 0;
+    volatile uint32_t wire_avg_   = 0;
+    volatile uint32_t wire_max_   = 0;
+};
@@ -0,0 +1,499 @@
+/*
+ * log_player.cpp
+ *
+ * Timed playback of recorded NMEA logs — see log_player.h.
+ */
+
+#include "log_player.h"
+#include "slots.h"
+
+#define LOG_DIR   "/logs"
+#define DAY_MS    86400000ull
+#define NEW_PASS  0x80                      // record length flag: first of a pass
+static_assert(LOG_SENTENCE_MAX < NEW_PASS, "record length flag");
+
+static void log_path(const char* name, const char* ext, char* out, size_t len) {
+    snprintf(out, len, LOG_DIR "/%s%s", name, ext);
+}
+
+bool log_name_ok(const char* name) {
+    return slot_name_ok(name);
+}
+
+size_t log_list(LogInfo* out, size_t max) {
+    File   dir = LittleFS.open(LOG_DIR);
+    size_t n   = 0;
+    if (!dir || !dir.isDirectory())
+        return 0;
+    for (File f = dir.openNextFile(); f && n < max; f = dir.openNextFile()) {
+        const char* name = f.name();
+        size_t      len  = strlen(name);
+        if (len < 5 || len - 4 > LOG_NAME_MAX || strcmp(name + len - 4, ".log") != 0)
+            continue;
+        memcpy(out[n].name, name, len - 4);
+        out[n].name[len - 4] = '\0';
+        out[n].size          = (uint32_t)f.size();
+        n++;
+    }
+    return n;
+}
+
+bool log_remove(const char* name) {
+    char path[48];
+    if (!log_name_ok(name))
+        return false;
+    log_path(name, ".log", path, sizeof(path));
+    return LittleFS.remove(path);
+}
+
+// ---------------------------------------------------------------------------
+// Timestamps
+// ---------------------------------------------------------------------------
+
+enum Stamp { STAMP_NONE, STAMP_SECONDS, STAMP_TIME_OF_DAY, STAMP_BAD };
+
+// Digits at `p` as a number, advancing `p`.  Fractions are truncated to ms.
+static uint64_t take_digits(const char** p, const char* end, int* count) {
+    uint64_t v = 0;
+    *count = 0;
+    while (*p < end && **p >= '0' && **p <= '9') {
+        v = v * 10 + (uint64_t)(**p - '0');
+        (*p)++;
+        (*count)++;
+    }
+    return v;
+}
+
+static uint64_t take_fraction_ms(const char** p, const char* end) {
+    uint64_t ms = 0;
+    int      n  = 0;
+    if (*p < end && **p == '.')
+        for ((*p)++; *p < end && **p >= '0' && **p <= '9'; (*p)++, n++)
+            if (n < 3)
+                ms = ms * 10 + (uint64_t)(**p - '0');
+    for (; n < 3; n++)
+        ms *= 10;
+    return ms;
+}
+
+// The text before a line's sentence, separators trimmed, in ms.
+static Stamp parse_stamp(const char* p, const char* end, uint64_t* ms) {
+    while (p < end && strchr(" \t,;", *p))
+        p++;
+    while (end > p && strchr(" \t,;", end[-1]))
+        end--;
+    if (p == end)
+        return STAMP_NONE;
+
+    int         n;
+    const char* colon = (const char*)memchr(p, ':', end - p);
+    if (!colon) {
+        uint64_t s = take_digits(&p, end, &n);
+        if (n == 0 || n > 12)
+            return STAMP_BAD;
+        *ms = s * 1000 + take_fraction_ms(&p, end);
+        return p == end ? STAMP_SECONDS : STAMP_BAD;
+    }
+
+    // hh:mm:ss[.fff], possibly the end of an ISO date-time ("...T08:15:02.350Z").
+    if (colon == p)
+        return STAMP_BAD;
+    p = colon - p >= 2 && colon[-2] >= '0' && colon[-2] <= '9' ? colon - 2 : colon - 1;
+    if (end > p && end[-1] == 'Z')
+        end--;
+    uint64_t h = take_digits(&p, end, &n);
+    if (n == 0 || p == end || *p++ != ':')
+        return STAMP_BAD;
+    uint64_t m = take_digits(&p, end, &n);
+    if (n != 2 || p == end || *p++ != ':')
+        return STAMP_BAD;
+    uint64_t s = take_digits(&p, end, &n);
+    if (n != 2 || h > 23 || m > 59 || s > 60)
+        return STAMP_BAD;
+    *ms = ((h * 60 + m) * 60 + s) * 1000 + take_fraction_ms(&p, end);
+    return p == end ? STAMP_TIME_OF_DAY : STAMP_BAD;
+}
+
+// ---------------------------------------------------------------------------
+// Upload
+// ---------------------------------------------------------------------------
+
+const char* LogWriter::begin(const char* name) {
+    char path[48], tmp[48];
+    ok_   = false;
+    size_ = 0;
+    if (!log_name_ok(name))
+        return "bad log name";
+    log_path(name, ".log", path, sizeof(path));
+    log_path(name, ".tmp", tmp, sizeof(tmp));
+    LogInfo list[LOG_LIST_MAX];
+    if (!LittleFS.exists(path) && log_list(list, LOG_LIST_MAX) >= LOG_LIST_MAX)
+        return "all log names in use";
+
+    LittleFS.mkdir(LOG_DIR);
+    file_ = LittleFS.open(tmp, "w", true);
+    if (!file_)
+        return "cannot create log file";
+    strcpy(name_, name);
+    ok_ = true;
+    return nullptr;
+}
+
+void LogWriter::write(const uint8_t* data, size_t len) {
+    if (ok_ && file_.write(data, len) != len)
+        ok_ = false;
+    size_ += len;
+}
+
+const char* LogWriter::finish() {
+    char path[48], tmp[48];
+    log_path(name_, ".log", path, sizeof(path));
+    log_path(name_, ".tmp", tmp, sizeof(tmp));
+    file_.close();
+    if (!ok_ || size_ == 0) {
+        LittleFS.remove(tmp);
+        return ok_ ? "empty log" : "filesystem full";
+    }
+    ok_ = false;
+    if (!LittleFS.rename(tmp, path))
+        return "rename failed";
+    return nullptr;
+}
+
+void LogWriter::abort() {
+    char tmp[48];
+    if (!file_)
+        return;
+    file_.close();
+    log_path(name_, ".tmp", tmp, sizeof(tmp));
+    LittleFS.remove(tmp);
+    ok_ = false;
+}
+
+// ---------------------------------------------------------------------------
+// Web task
+// ---------------------------------------------------------------------------
+
+const char* LogPlayer::play(const char* name, bool loop, uint32_t untimed_ms) {
+    char path[48];
+    if (!log_name_ok(name))
+        return "bad log name";
+    log_path(name, ".log", path, sizeof(path));
+    if (!LittleFS.exists(path))
+        return "no such log";
+    if (cmd_.load(std::memory_order_acquire) != CMD_NONE)
+        return "busy: the previous request is still being carried out";
+    strcpy(cmd_name_, name);
+    cmd_loop_       = loop;
+    cmd_untimed_ms_ = untimed_ms;
+    cmd_.store(CMD_PLAY, std::memory_order_release);
+    return nullptr;
+}
+
+const char* LogPlayer::stop() {
+    if (cmd_.load(std::memory_order_acquire) != CMD_NONE)
+        return "busy: the previous request is still being carried out";
+    cmd_.store(CMD_STOP, std::memory_order_release);
+    return nullptr;
+}
+
+LogStats LogPlayer::stats() const {
+    LogStats st;
+    st.playing     = active_.load(std::memory_order_acquire)
+                  && !finished_.load(std::memory_order_acquire);
+    memcpy(st.name, name_, sizeof(st.name));
+    st.name[LOG_NAME_MAX] = '\0';
+    st.sent        = sent_;
+    st.sent_total  = sent_total_;
+    st.cycles      = cycles_;
+    st.skipped     = skipped_;
+    st.underruns   = underruns_;
+    st.late_max_ms = late_max_ms_;
+    st.late_avg_us = st.sent ? (uint32_t)((uint64_t)late_sum_ms_ * 1000 / st.sent) : 0;
+    st.file_pos    = file_pos_;
+    st.file_size   = file_size_;
+    return st;
+}
+
+// ---------------------------------------------------------------------------
+// Loop task
+// ---------------------------------------------------------------------------
+
+void LogPlayer::service() {
+    uint8_t cmd = cmd_.load(std::memory_order_acquire);
+
+    // Stop: the TX task acknowledges at its next tick, after which it no
+    // longer reads the buffers.
+    if (state_ == PLAYING && (cmd != CMD_NONE || finished_.load(std::memory_order_acquire))) {
+        active_.store(false, std::memory_order_release);
+        stop_seq_.fetch_add(1, std::memory_order_release);
+        state_ = STOPPING;
+    }
+    if (state_ == STOPPING) {
+        if (ack_seq_.load(std::memory_order_acquire) != stop_seq_.load(std::memory_order_relaxed))
+            return;
+        file_.close();
+        state_ = IDLE;
+    }
+
+    if (cmd != CMD_NONE) {
+        if (cmd == CMD_PLAY) {
+            memcpy(name_, cmd_name_, sizeof(name_));
+            loop_       = cmd_loop_;
+            untimed_ms_ = cmd_untimed_ms_;
+            open();
+        }
+        cmd_.store(CMD_NONE, std::memory_order_release);
+    }
+
+    if (state_ == PLAYING && !eof_ && !buf_[fill_].full.load(std::memory_order_acquire))
+        fill(buf_[fill_]);
+}
+
+void LogPlayer::open() {
+    char path[48];
+    log_path(name_, ".log", path, sizeof(path));
+    file_ = LittleFS.open(path, "r");
+    if (!file_) {
+        Serial.printf("Warning: log '%s' cannot be opened\n", name_);
+        return;
+    }
+
+    // The TX task is idle, so its counters can be reset from here.
+    sent_        = 0;
+    cycles_      = 0;
+    skipped_     = 0;
+    underruns_   = 0;
+    late_max_ms_ = 0;
+    late_sum_ms_ = 0;
+    file_size_ = (uint32_t)file_.size();
+    file_pos_  = 0;
+    chunk_len_ = chunk_pos_ = 0;
+    have_rec_  = eof_ = have_base_ = lines_ = new_pass_ = false;
+    first_pass_   = true;
+    pass_records_ = 0;
+    day_ms_    = 0;
+    prev_rel_  = gap_ms_ = offset_ms_ = 0;
+
+    buf_[0].full.store(0, std::memory_order_relaxed);
+    buf_[1].full.store(0, std::memory_order_relaxed);
+    fill_ = 0;
+    fill(buf_[0]);
+    if (!eof_)
+        fill(buf_[1]);
+
+    finished_.store(false, std::memory_order_relaxed);
+    active_.store(true, std::memory_order_release);
+    state_ = PLAYING;
+    Serial.printf("Playing log '%s' (%u bytes)%s\n", name_, (unsigned)file_size_,
+                  loop_ ? ", repeating" : "");
+}
+
+// Fill `b` with whole records and hand it to the TX task.
+void LogPlayer::fill(Buffer& b) {
+    size_t n = 0;
+    for (;;) {
+        if (!have_rec_) {
+            if (!next_record()) {
+                // End of the file: start the next pass the last gap later,
+                // unless there was nothing to play in this one.
+                if (loop_ && pass_records_) {
+                    offset_ms_   += prev_rel_ + (gap_ms_ ? gap_ms_ : untimed_ms_);
+                    prev_rel_     = gap_ms_ = 0;
+                    have_base_    = lines_ = false;
+                    day_ms_       = 0;
+                    pass_records_ = 0;
+                    chunk_len_    = chunk_pos_ = 0;
+                    file_pos_     = 0;
+                    first_pass_   = false;
+                    new_pass_     = true;
+                    file_.seek(0);
+                    continue;
+                }
+                eof_ = true;
+                break;
+            }
+            have_rec_ = true;
+        }
+        size_t need = 5 + rec_len_;
+        if (n + need > LOG_BUF_SIZE)
+            break;
+        memcpy(b.data + n, &rec_t_, 4);
+        b.data[n + 4] = rec_len_ | (new_pass_ ? NEW_PASS : 0);
+        new_pass_     = false;
+        memcpy(b.data + n + 5, rec_, rec_len_);
+        n        += need;
+        have_rec_ = false;
+    }
+    b.len  = n;
+    b.last = eof_;
+    b.full.store(1, std::memory_order_release);
+    fill_ ^= 1;
+}
+
+// Count an unusable line, once however often the log repeats.
+void LogPlayer::skip() {
+    if (first_pass_)
+        skipped_ = skipped_ + 1;
+}
+
+// Next line of the file into line_, without its line end.
+bool LogPlayer::read_line() {
+    size_t n        = 0;
+    bool   too_long = false;
+    for (;;) {
+        if (chunk_pos_ == chunk_len_) {
+            chunk_len_ = file_.read(chunk_, sizeof(chunk_));
+            chunk_pos_ = 0;
+            file_pos_  = file_pos_ + chunk_len_;
+            if (chunk_len_ == 0) {
+                if (too_long)
+                    skip();
+                if (too_long || n == 0)
+                    return false;
+                break;
+            }
+        }
+        char c = (char)chunk_[chunk_pos_++];
+        if (c == '\n') {
+            if (!too_long)
+                break;
+            skip();
+            too_long = false;
+            n        = 0;
+        } else if (c == '\r') {
+            continue;
+        } else if (n < LOG_LINE_MAX) {
+            line_[n++] = c;
+        } else {
+            too_long = true;
+        }
+    }
+    line_[n] = '\0';
+    return true;
+}
+
+// Parse lines until one holds a sentence: rec_ and its due time rec_t_.
+bool LogPlayer::next_record() {
+    while (read_line()) {
+        char* s = strpbrk(line_, "$!");
+        if (!s) {
+            char c = line_[strspn(line_, " \t")];
+            if (c && c != '#')
+                skip();
+            continue;
+        }
+        size_t len = strlen(s);
+        while (len && (s[len - 1] == ' ' || s[len - 1] == '\t'))
+            len--;
+        uint64_t ms;
+        Stamp    stamp = parse_stamp(line_, s, &ms);
+        if (len + 2 > LOG_SENTENCE_MAX || stamp == STAMP_BAD) {
+            skip();
+            continue;
+        }
+
+        uint32_t rel;
+        if (stamp == STAMP_NONE) {
+            rel = lines_ ? prev_rel_ + untimed_ms_ : 0;
+        } else {
+            if (stamp == STAMP_TIME_OF_DAY) {
+                ms += day_ms_;
+                if (have_base_ && ms < prev_abs_) {
+                    day_ms_ += DAY_MS;
+                    ms      += DAY_MS;
+                }
+            }
+            if (!have_base_) {
+                base_ms_   = ms - prev_rel_;     // untimed lines before it keep their gaps
+                have_base_ = true;
+            }
+            prev_abs_ = ms;
+            rel       = ms > base_ms_ ? (uint32_t)(ms - base_ms_) : 0;
+            if (rel < prev_rel_)
+                rel = prev_rel_;                 // stepped back: send at once
+        }
+        if (lines_)
+            gap_ms_ = rel - prev_rel_;
+        lines_    = true;
+        prev_rel_ = rel;
+        pass_records_++;
+
+        memcpy(rec_, s, len);
+        rec_[len]     = '\r';
+        rec_[len + 1] = '\n';
+        rec_len_      = (uint8_t)(len + 2);
+        rec_t_        = offset_ms_ + rel;
+        return true;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// TX task
+// ---------------------------------------------------------------------------
+
+bool LogPlayer::tick(uint32_t now_ms, char* out, size_t cap, size_t* len) {
+    *len = 0;
+    if (!active_.load(std::memory_order_acquire)) {
+        started_ = false;
+        ack_seq_.store(stop_seq_.load(std::memory_order_acquire), std::memory_order_release);
+        return false;
+    }
+    if (finished_.load(std::memory_order_relaxed))
+        return false;
+    if (!started_) {
+        started_ = true;
+        t0_ms_    = now_ms;
+        cur_      = 0;
+        pos_      = 0;
+        starving_ = false;
+    }
+
+    size_t n = 0;
+    for (;;) {
+        Buffer& b = buf_[cur_];
+        // The reader is behind.  Which sentences were due is only known
+        // once they are read, so note the time and count them then; a
+        // TX tick that came late (timer periods missed) is covered too.
+        if (!b.full.load(std::memory_order_acquire)) {
+            starving_  = true;
+            starve_ms_ = now_ms;
+            break;
+        }
+        if (pos_ >= b.len) {
+            if (b.last) {
+                finished_.store(true, std::memory_order_release);
+                break;
+            }
+            b.full.store(0, std::memory_order_release);
+            cur_ ^= 1;
+            pos_  = 0;
+            continue;
+        }
+        uint32_t t;
+        memcpy(&t, b.data + pos_, 4);
+        uint8_t  l    = b.data[pos_ + 4] & ~NEW_PASS;
+        uint32_t due  = t0_ms_ + t;
+        uint32_t late = now_ms - due;
+        if (starving_ && (int32_t)(starve_ms_ - due) < 0)
+            starving_ = false;           // the reader had caught up by this one
+        if ((int32_t)late < 0 || n + l > cap)
+            break;
+        if (starving_)
+            underruns_ = underruns_ + 1;
+        if (b.data[pos_ + 4] & NEW_PASS)
+            cycles_ = cycles_ + 1;
+        memcpy(out + n, b.data + pos_ + 5, l);
+        n    += l;
+        pos_ += 5 + (size_t)l;
+
+        sent_        = sent_ + 1;
+        sent_total_  = sent_total_ + 1;
+        late_sum_ms_ = late_sum_ms_ + late;
+        if (late > late_max_ms_)
+            late_max_ms_ = late;
+    }
+    *len = n;
+    return true;
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+/*
+ * log_player.h
+ *
+ * Timed playback of recorded NMEA logs from LittleFS.  A log is replayed
+ * sentence for sentence with the gaps it was recorded with, in constant
+ * RAM however long the file is, in place of the heading sequence.
+ *
+ * Logs are text files /logs/<name>.log, one sentence per line, each
+ * preceded by the time it was received:
+ *
+ *   12.350 $HEHDT,328.9,T*1C         seconds (any epoch, any fraction)
+ *   08:15:02.350,$HEHDT,328.9,T*1C   time of day, hh:mm:ss[.fff]
+ *   $HEHDT,328.9,T*1C                untimed: the TX interval after the last
+ *
+ * Whatever precedes the '$' or '!' of a line is its timestamp (separators
+ * are spaces, tabs, commas or semicolons); times are relative to the first
+ * line, a time of day that steps back has passed midnight, and any other
+ * step back is sent at once.  Lines with no sentence are skipped; '#'
+ * starts a comment line.
+ * Sentences are sent exactly as recorded, checksum included, with CR LF.
+ *
+ * Reading and timing are split between two tasks through two buffers of
+ * LOG_BUF_SIZE bytes each:
+ *
+ *   loop task  reads the file, parses each line into a record
+ *              { u32 due ms, u8 length, sentence } and fills whichever
+ *              buffer is empty with whole records
+ *   TX task    runs every LOG_TICK_MS while playing and sends the records
+ *              that are due, handing a buffer back once it has read it
+ *
+ * The TX task never touches the file, so a slow flash read cannot delay a
+ * sentence; a buffer lasts well over 100 ms even at 115200 baud, far
+ * longer than a loop pass.  Should the reader fall behind, the sentences
+ * go out late rather than being lost, and each sentence that fell due
+ * while it was behind is counted as an underrun.
+ * Timing is reproduced to within LOG_TICK_MS; late_max_ms in the stats
+ * shows how closely it was.
+ *
+ * Starting and stopping are requests from the web task that the loop task
+ * carries out: a stop waits for the TX task to acknowledge it before the
+ * buffers are reused.
+ */
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <atomic>
+
+#define LOG_NAME_MAX      15        // [A-Za-z0-9_-], as slot names
+#define LOG_LIST_MAX      16
+#define LOG_BUF_SIZE      2048      // each of the two record buffers
+#define LOG_LINE_MAX      160       // longer lines are skipped
+#define LOG_SENTENCE_MAX  96        // sentence with CR LF; NMEA allows 82
+#define LOG_TICK_MS       5         // TX period while playing
+#define LOG_BURST_MAX     512       // most bytes queued in one tick
+
+struct LogInfo {
+    char     name[LOG_NAME_MAX + 1];
+    uint32_t size;
+};
+
+struct LogStats {
+    bool     playing;
+    char     name[LOG_NAME_MAX + 1];  // last log started
+    uint32_t sent;                    // sentences sent
+    uint32_t sent_total;              // ... by every log since boot
+    uint32_t cycles;                  // completed passes with loop on
+    uint32_t skipped;                 // lines without a usable sentence ('#': comment)
+    uint32_t underruns;               // sentences due before they were read
+    uint32_t late_max_ms;             // most a sentence went out after its time
+    uint32_t late_avg_us;
+    uint32_t file_pos;                // bytes read in the current pass
+    uint32_t file_size;
+};
+
+bool   log_name_ok(const char* name);
+size_t log_list(LogInfo* out, size_t max);
+bool   log_remove(const char* name);
+
+// Store an uploaded log chunk by chunk: written to a temporary file and
+// renamed on finish(), like a slot.
+class LogWriter {
+public:
+    const char* begin(const char* name);   // nullptr on success, else why not
+    void        write(const uint8_t* data, size_t len);
+    const char* finish();                  // nullptr on success
+    void        abort();
+
+private:
+    File     file_;
+    char     name_[LOG_NAME_MAX + 1];
+    uint32_t size_ = 0;
+    bool     ok_   = false;
+};
+
+class LogPlayer {
+public:
+    // --- web task ---
+
+    // Start `name` (replacing any log being played), repeating it if
+    // `loop`; untimed lines are `untimed_ms` apart.  nullptr on success.
+    const char* play(const char* name, bool loop, uint32_t untimed_ms);
+    const char* stop();
+
+    LogStats stats() const;
+
+    // Sentences sent from the current log (any task).
+    uint32_t sent() const { return sent_; }
+
+    // --- loop task ---
+
+    // Carry out a pending start or stop and refill the empty buffer.
+    void service();
+
+    // --- TX task ---
+
+    // Queue into `out` (at most `cap` bytes) the sentences due at `now_ms`.
+    // True while a log is playing; the caller sends nothing else then.
+    bool tick(uint32_t now_ms, char* out, size_t cap, size_t* len);
+
+private:
+    enum Cmd : uint8_t { CMD_NONE = 0, CMD_PLAY, CMD_STOP };
+    enum State : uint8_t { IDLE, PLAYING, STOPPING };
+
+    struct Buffer {
+        uint8_t              data[LOG_BUF_SIZE];
+        size_t               len;
+        bool                 last;          // the log ends with this buffer
+        std::atomic<uint8_t> full{0};       // filled by the loop task, 0 once read
+    };
+
+    void open();
+    void fill(Buffer& b);
+    bool next_record();                     // parse the next line into rec_
+    bool read_line();
+    void skip();
+
+    Buffer buf_[2];
+
+    // web -> loop
+    std::atomic<uint8_t> cmd_{CMD_NONE};
+    char                 cmd_name_[LOG_NAME_MAX + 1] = "";
+    bool                 cmd_loop_       = true;
+    uint32_t             cmd_untimed_ms_ = 100;
+
+    // loop <-> TX
+    std::atomic<bool>     active_{false};
+    std::atomic<bool>     finished_{false};  // TX task reached the end
+    std::atomic<uint32_t> stop_seq_{0};
+    std::atomic<uint32_t> ack_seq_{0};
+
+    // loop task only
+    State    state_      = IDLE;
+    File     file_;
+    int      fill_       = 0;
+    bool     loop_       = true;
+    uint32_t untimed_ms_ = 100;
+    uint8_t  chunk_[256];
+    size_t   chunk_len_  = 0;
+    size_t   chunk_pos_  = 0;
+    char     line_[LOG_LINE_MAX + 1];
+    bool     have_rec_   = false;           // rec_ did not fit the last buffer
+    bool     eof_        = false;
+    uint32_t rec_t_      = 0;
+    uint8_t  rec_len_    = 0;
+    char     rec_[LOG_SENTENCE_MAX];
+    bool     lines_      = false;           // a sentence was read in this pass
+    bool     first_pass_ = true;
+    bool     new_pass_   = false;           // next record starts a pass
+    uint32_t pass_records_ = 0;
+    bool     have_base_  = false;
+    uint64_t base_ms_    = 0;               // timestamp of the first line
+    uint64_t prev_abs_   = 0;
+    uint64_t day_ms_     = 0;               // midnights passed
+    uint32_t prev_rel_   = 0;
+    uint32_t gap_ms_     = 0;               // last gap, used to close a pass
+    uint32_t offset_ms_  = 0;               // start of the current pass
+
+    // TX task only
+    bool     started_   = false;
+    uint32_t t0_ms_     = 0;
+    int      cur_       = 0;
+    size_t   pos_       = 0;
+    bool     starving_  = false;            // a tick found no buffer ready
+    uint32_t starve_ms_ = 0;                // time of the last such tick
+
+    // stats
+    char              name_[LOG_NAME_MAX + 1] = "";
+    volatile uint32_t sent_        = 0;
+    volatile uint32_t sent_total_  = 0;
+    volatile uint32_t cycles_      = 0;
+    volatile uint32_t skipped_     = 0;
+    volatile uint32_t underruns_   = 0;
+    volatile uint32_t late_max_ms_ = 0;
+    volatile uint32_t late_sum_ms_ = 0;
+    volatile uint32_t file_pos_    = 0;
+    volatile uint32_t file_size_   = 0;
+};
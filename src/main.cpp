@@ -6,21 +6,63 @@
  * Replays $HEHDT true heading sentences over UART1 at 9600 baud, 8N1,
  * no parity — matching the original RS-422 gyrocompass interface parameters.
  *
- * Defaults to the hardcoded table below (input_files/in-o.txt).
+ * Defaults to the compile-time generated table in default_table.h
+ * (input_files/in-o.txt, now with checksums).
  * A Wi-Fi access point (SSID: NMEA-EMU  pass: nmea1234) is always active.
  * Connect any browser to http://192.168.4.1 to build a custom 125-sentence
- * sequence interactively; the ESP32 switches to it immediately on receipt.
+ * sequence interactively; it replaces the running sequence when that
+ * wraps to its first entry, or at once or at a chosen entry with
+ * swap=now | <index> (sequence.h).
+ * Sparse keyframes posted to /keys are interpolated at the TX rate
+ * (keyframes.h).
+ * In live mode the page steers the output heading directly over a
+ * WebSocket (live_heading.h).  The same NMEA stream is served on TCP
+ * port 10110 and optionally as UDP broadcast (net_stream.h).  Uploaded
+ * sequences can be kept in named slots on flash, one of which may be
+ * chosen to start from at boot (slots.h).  A recorded log stored on flash
+ * can be replayed with its original timing instead (log_player.h).
+ * Counters for monitoring are served on /metrics (metrics.h), and the
+ * last events on /trace (trace.h).  Further UARTs can carry the same
+ * stream or one of their own, with its own rate and talker ID
+ * (channels.h, /channel).
+ *
+ * Tasks:
+ *   nmea_tx    high priority, woken by one timer at each channel's deadline
+ *   async_tcp  HTTP requests, handled as their packets arrive
+ *   nmea_net   NMEA to TCP/UDP clients, fed from a ring the TX task fills
+ *   loopTask   Arduino loop(): LED, warnings and log reading, priority 1
+ * The web handlers share nothing with nmea_tx but the lock-free table
+ * handoff (sequence.h), the live-heading register, the log player's
+ * buffers, the line_request word and a few counters.
  *
  * Wiring:
  *   NMEA_UART_TX_PIN -> RS-232/RS-422 level converter TX input
+ *   NMEA_CH1_TX_PIN  -> second converter, if NMEA_CHANNELS > 1
  *   GND              -> level converter GND
  */
 
 #include <Arduino.h>
 #include <WiFi.h>
-#include <WebServer.h>
-#include "web_page.h"
-#include "func_page.h"
+#include <ESPAsyncWebServer.h>
+#include "web_assets.h"
+#include "heading_parser.h"
+#include "channels.h"
+#include "default_table.h"
+#include "led.h"
+#include "line_config.h"
+#include "live_heading.h"
+#include "log_player.h"
+#include "metrics.h"
+#include "nmea.h"
+#include "nmea_bench.h"
+#include "net_stream.h"
+#include "sequence.h"
+#include "slots.h"
+#include "talker.h"
+#include "trace.h"
+#include "tx_task.h"
+#include "uart_tx.h"
+#include "waveform.h"
 
 // ---------------------------------------------------------------------------
 // Configuration
@@ -29,9 +71,33 @@
 // platformio.ini build_flags for other boards (see env: sections there).
 // ---------------------------------------------------------------------------
 
+// Output settings used until /line stores others (line_config.h).
+
 // Transmission interval — matches sleep(0.1) in db9.py.
 const uint32_t TX_INTERVAL_MS = 100;
 
+// NMEA UART baud rate (8N1).
+const uint32_t NMEA_BAUD = 9600;
+
+// Sentence mix: ticks between sentences of each type, 0 = off (talker.h).
+// The default is $HEHDT alone at 10 Hz, as db9.py sent.
+#ifndef TALKER_HDT_EVERY
+#define TALKER_HDT_EVERY  1
+#endif
+#ifndef TALKER_THS_EVERY
+#define TALKER_THS_EVERY  0
+#endif
+#ifndef TALKER_ROT_EVERY
+#define TALKER_ROT_EVERY  0
+#endif
+#ifndef TALKER_HDG_EVERY
+#define TALKER_HDG_EVERY  0
+#endif
+
+// Sleep between passes of the LED loop.  Transmission runs in its own task
+// (tx_task.h) and HTTP in the async_tcp task; neither depends on this.
+const uint32_t LOOP_SLICE_MS = 5;
+
 // UART1 pin assignment.  RX is defined but not wired — output is TX-only.
 #ifndef NMEA_UART_TX_PIN
 #define NMEA_UART_TX_PIN  4
@@ -40,6 +106,34 @@ const uint32_t TX_INTERVAL_MS = 100;
 #define NMEA_UART_RX_PIN  5
 #endif
 
+// Output channels in all, UART1 included (channels.h).  Channel 1 uses
+// UART2 where the SoC has one; on the ESP32-C3 that leaves UART0 only,
+// which is free when the console is on USB CDC (ARDUINO_USB_CDC_ON_BOOT).
+#ifndef NMEA_CHANNELS
+#define NMEA_CHANNELS  1
+#endif
+#if NMEA_CHANNELS < 1 || NMEA_CHANNELS > CHANNEL_MAX
+#error "NMEA_CHANNELS must be 1 .. CHANNEL_MAX"
+#endif
+#ifndef NMEA_CH1_UART
+#define NMEA_CH1_UART  (SOC_UART_NUM > 2 ? 2 : 0)
+#endif
+#ifndef NMEA_CH1_TX_PIN
+#define NMEA_CH1_TX_PIN  17
+#endif
+#ifndef NMEA_CH1_RX_PIN
+#define NMEA_CH1_RX_PIN  16
+#endif
+#ifndef NMEA_CH2_UART
+#define NMEA_CH2_UART  0
+#endif
+#ifndef NMEA_CH2_TX_PIN
+#define NMEA_CH2_TX_PIN  1
+#endif
+#ifndef NMEA_CH2_RX_PIN
+#define NMEA_CH2_RX_PIN  3
+#endif
+
 // Onboard LED pin and polarity.
 // LED_PIN defaults to LED_BUILTIN from the board's pins_arduino.h.
 // Set LED_ACTIVE_LOW=1 for boards whose LED lights on LOW (e.g. Super Mini).
@@ -50,249 +144,1122 @@ const uint32_t TX_INTERVAL_MS = 100;
 #define LED_ACTIVE_LOW  0
 #endif
 
-#define LED_ON   (LED_ACTIVE_LOW ? LOW : HIGH)
-#define LED_OFF  (LED_ACTIVE_LOW ? HIGH : LOW)
+// Cache-Control for the pages.  They live at fixed URLs, so a cached copy
+// is used for a day without asking and revalidated by ETag after that; a
+// reflashed page is therefore picked up within a day (or on reload).
+#ifndef WEB_CACHE_CONTROL
+#define WEB_CACHE_CONTROL  "public, max-age=86400"
+#endif
 
 // Wi-Fi access point credentials.
 #define AP_SSID  "NMEA-EMU"
 #define AP_PASS  "nmea1234"
 
 // ---------------------------------------------------------------------------
-// Default sentence table  (input_files/in-o.txt, 128 entries)
-// Stored in flash; active until the user uploads a custom sequence.
+// Heading tables
+//
+// default_table points at the compile-time DEFAULT_IMAGE; uploads are kept
+// as deci-degrees in whichever of the three upload banks is neither active
+// nor pending (see sequence.h), so a table waiting for its swap point is
+// left alone until the next one has been accepted.  A /wave scenario or
+// /keys track uses the same bank scheme but stores only generator
+// parameters or keyframes.
 // ---------------------------------------------------------------------------
 
-static const char* const nmea_default[] = {
-    "$HEHDT,328.9,T\r\n",
-    "$HEHDT,329.0,T\r\n",
-    "$HEHDT,329.2,T\r\n",
-    "$HEHDT,329.3,T\r\n",
-    "$HEHDT,329.5,T\r\n",
-    "$HEHDT,329.6,T\r\n",
-    "$HEHDT,329.8,T\r\n",
-    "$HEHDT,329.9,T\r\n",
-    "$HEHDT,330.1,T\r\n",
-    "$HEHDT,330.3,T\r\n",
-    "$HEHDT,330.4,T\r\n",
-    "$HEHDT,330.6,T\r\n",
-    "$HEHDT,330.7,T\r\n",
-    "$HEHDT,330.9,T\r\n",
-    "$HEHDT,331.0,T\r\n",
-    "$HEHDT,331.1,T\r\n",
-    "$HEHDT,331.3,T\r\n",
-    "$HEHDT,331.4,T\r\n",
-    "$HEHDT,331.5,T\r\n",
-    "$HEHDT,331.6,T\r\n",
-    "$HEHDT,331.7,T\r\n",
-    "$HEHDT,331.7,T\r\n",
-    "$HEHDT,331.8,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.8,T\r\n",
-    "$HEHDT,331.8,T\r\n",
-    "$HEHDT,331.7,T\r\n",
-    "$HEHDT,331.6,T\r\n",
-    "$HEHDT,331.5,T\r\n",
-    "$HEHDT,331.4,T\r\n",
-    "$HEHDT,331.3,T\r\n",
-    "$HEHDT,331.2,T\r\n",
-    "$HEHDT,331.1,T\r\n",
-    "$HEHDT,330.9,T\r\n",
-    "$HEHDT,330.8,T\r\n",
-    "$HEHDT,330.6,T\r\n",
-    "$HEHDT,330.5,T\r\n",
-    "$HEHDT,330.3,T\r\n",
-    "$HEHDT,330.2,T\r\n",
-    "$HEHDT,330.0,T\r\n",
-    "$HEHDT,329.8,T\r\n",
-    "$HEHDT,329.7,T\r\n",
-    "$HEHDT,329.5,T\r\n",
-    "$HEHDT,329.4,T\r\n",
-    "$HEHDT,329.2,T\r\n",
-    "$HEHDT,329.1,T\r\n",
-    "$HEHDT,328.9,T\r\n",
-    "$HEHDT,328.8,T\r\n",
-    "$HEHDT,328.7,T\r\n",
-    "$HEHDT,328.6,T\r\n",
-    "$HEHDT,328.4,T\r\n",
-    "$HEHDT,328.3,T\r\n",
-    "$HEHDT,328.3,T\r\n",
-    "$HEHDT,328.2,T\r\n",
-    "$HEHDT,328.1,T\r\n",
-    "$HEHDT,328.1,T\r\n",
-    "$HEHDT,328.0,T\r\n",
-    "$HEHDT,328.0,T\r\n",
-    "$HEHDT,328.0,T\r\n",
-    "$HEHDT,328.0,T\r\n",
-    "$HEHDT,328.0,T\r\n",
-    "$HEHDT,328.0,T\r\n",
-    "$HEHDT,328.0,T\r\n",
-    "$HEHDT,328.1,T\r\n",
-    "$HEHDT,328.1,T\r\n",
-    "$HEHDT,328.2,T\r\n",
-    "$HEHDT,328.3,T\r\n",
-    "$HEHDT,328.3,T\r\n",
-    "$HEHDT,328.4,T\r\n",
-    "$HEHDT,328.6,T\r\n",
-    "$HEHDT,328.7,T\r\n",
-    "$HEHDT,328.8,T\r\n",
-    "$HEHDT,328.9,T\r\n",
-    "$HEHDT,329.1,T\r\n",
-    "$HEHDT,329.2,T\r\n",
-    "$HEHDT,329.4,T\r\n",
-    "$HEHDT,329.5,T\r\n",
-    "$HEHDT,329.7,T\r\n",
-    "$HEHDT,329.9,T\r\n",
-    "$HEHDT,330.0,T\r\n",
-    "$HEHDT,330.2,T\r\n",
-    "$HEHDT,330.3,T\r\n",
-    "$HEHDT,330.5,T\r\n",
-    "$HEHDT,330.6,T\r\n",
-    "$HEHDT,330.8,T\r\n",
-    "$HEHDT,330.9,T\r\n",
-    "$HEHDT,331.1,T\r\n",
-    "$HEHDT,331.2,T\r\n",
-    "$HEHDT,331.3,T\r\n",
-    "$HEHDT,331.4,T\r\n",
-    "$HEHDT,331.5,T\r\n",
-    "$HEHDT,331.6,T\r\n",
-    "$HEHDT,331.7,T\r\n",
-    "$HEHDT,331.8,T\r\n",
-    "$HEHDT,331.8,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.9,T\r\n",
-    "$HEHDT,331.8,T\r\n",
-    "$HEHDT,331.7,T\r\n",
-    "$HEHDT,331.7,T\r\n",
-    "$HEHDT,331.6,T\r\n",
-    "$HEHDT,331.5,T\r\n",
-    "$HEHDT,331.4,T\r\n",
-    "$HEHDT,331.3,T\r\n",
-    "$HEHDT,331.1,T\r\n",
-    "$HEHDT,331.0,T\r\n",
-    "$HEHDT,330.9,T\r\n",
-    "$HEHDT,330.7,T\r\n",
-    "$HEHDT,330.6,T\r\n",
-    "$HEHDT,330.4,T\r\n",
-    "$HEHDT,330.3,T\r\n",
-    "$HEHDT,330.1,T\r\n",
-    "$HEHDT,329.9,T\r\n",
-    "$HEHDT,329.8,T\r\n",
-    "$HEHDT,329.6,T\r\n",
-};
-static const size_t DEFAULT_COUNT = sizeof(nmea_default) / sizeof(nmea_default[0]);
+// Active, pending and the one being filled.
+#define UPLOAD_BANKS  3
+
+static HeadingTable   default_table;
+static HeadingTable   upload_table[UPLOAD_BANKS];
+static HeadingBuffer  upload_buf[UPLOAD_BANKS];   // storage behind upload_table[]
+static WaveGenerator  wave_gen[UPLOAD_BANKS];     // generator behind upload_table[] for /wave
+static KeyframeTrack  key_track[UPLOAD_BANKS];    // keyframes behind upload_table[] for /keys
+static SequencePlayer player;
+static LiveHeading    live;              // knob position in live mode
+static LogPlayer      logs;              // recorded log, played instead of either
+static Talker         talker;
+static LineConfig     line;              // settings in force (web task copy)
+
+#if NMEA_CHANNELS > 1
+static HardwareSerial ch1_port(NMEA_CH1_UART);
+#endif
+#if NMEA_CHANNELS > 2
+static HardwareSerial ch2_port(NMEA_CH2_UART);
+#endif
+
+// Baud rate / interval change for the TX task to apply at its next tick:
+// baud / 100 in the high half, interval in ms in the low half; 0 = none.
+static std::atomic<uint32_t> line_request{0};
+
+// TX task counters, read by the web task
+static volatile uint32_t tx_wraps  = 0;   // sequence wraps since boot
+static volatile uint32_t tx_missed = 0;   // timer periods skipped since boot
+
+// Boot timing, reported once by loop() and at GET /slots.
+static volatile bool     first_sent    = false;   // set by the TX task
+static volatile uint32_t first_sent_us = 0;       // micros() at the first sentence
+static uint32_t          boot_read_us  = 0;       // slot read before the TX task started
+static uint32_t          boot_rest_us  = 0;       // slot read after it had started
+static char              boot_slot[SLOT_NAME_MAX + 1];   // "" = default table
+
+static void init_default(SwapPolicy swap) {
+    default_table.image  = DEFAULT_IMAGE.bytes;
+    default_table.stride = DEFAULT_STRIDE;
+    default_table.deci   = DEFAULT_DECI.values;
+    default_table.wave   = nullptr;
+    default_table.keys   = nullptr;
+    default_table.count  = DEFAULT_COUNT;
+    default_table.swap   = swap;
+}
+
+static void activate_default() {
+    init_default(SWAP_WRAP);
+    player.begin(&default_table);
+}
+
+// Start from the boot slot if one is set and opens, else from the default
+// table.  Only the slot's first SLOT_BOOT_ENTRIES values are read here;
+// finish_boot_sequence() reads the rest once the TX task is running.
+static bool begin_boot_sequence(SlotLoader* loader) {
+    slot_get_boot(boot_slot);
+    if (!boot_slot[0]) {
+        activate_default();
+        return false;
+    }
+
+    uint32_t    t0  = micros();
+    const char* err = loader->begin(boot_slot, &upload_buf[0], SLOT_BOOT_ENTRIES);
+    boot_read_us    = micros() - t0;
+    if (err) {
+        Serial.printf("Warning: boot slot '%s': %s; using the default table\n", boot_slot, err);
+        boot_slot[0] = '\0';
+        activate_default();
+        return false;
+    }
+
+    // The table already has its full length: the TX task is far slower
+    // than the rest of the read, so it never reaches an entry not yet read.
+    HeadingTable& tbl = upload_table[0];
+    tbl.deci    = upload_buf[0].data;
+    tbl.image   = nullptr;
+    tbl.wave    = nullptr;
+    tbl.keys    = nullptr;
+    tbl.count   = loader->count();
+    tbl.swap    = SWAP_WRAP;
+    tbl.swap_at = 0;
+    player.begin(&tbl);
+    return true;
+}
+
+static void finish_boot_sequence(SlotLoader* loader) {
+    uint32_t    t0  = micros();
+    const char* err = loader->finish();
+    boot_rest_us    = micros() - t0;
+    if (err) {
+        // Only the entries read so far are valid: leave them at once.
+        Serial.printf("Warning: boot slot '%s': %s; switching to the default table\n",
+                      boot_slot, err);
+        boot_slot[0] = '\0';
+        init_default(SWAP_NOW);
+        player.publish(&default_table);
+        return;
+    }
+    Serial.printf("Boot slot '%s': %u sentences\n", boot_slot, (unsigned)loader->count());
+}
+
+// Choose the bank the next upload is written into (web task): one that is
+// neither transmitted nor waiting for its swap point.  Pending is read
+// first: if the TX task adopts it in between, it is then the active one.
+static int free_upload_bank() {
+    const HeadingTable* pending = player.queued();
+    const HeadingTable* active  = player.active();
+    for (int bank = 0; bank < UPLOAD_BANKS; bank++)
+        if (&upload_table[bank] != pending && &upload_table[bank] != active)
+            return bank;
+    return 0;                             // not reached: three banks, two in use
+}
+
+// Hand upload_table[bank] to the TX task in place of any table still
+// waiting, whose headings are then given back to the heap.
+static void publish_upload(int bank) {
+    const HeadingTable* dropped = player.retract();
+    player.publish(&upload_table[bank]);
+    for (int i = 0; i < UPLOAD_BANKS; i++)
+        if (dropped == &upload_table[i])
+            upload_buf[i].release();
+}
+
+// Hand the headings read into `bank` to the TX task, to be swapped in
+// according to `swap` / `swap_at`.  `start_us` is when reading began.
+static void apply_uploaded_sequence(int bank, SwapPolicy swap, size_t swap_at,
+                                    uint32_t start_us) {
+    HeadingBuffer& buf = upload_buf[bank];
+    HeadingTable&  tbl = upload_table[bank];
+
+    buf.shrink();
+    tbl.deci    = buf.data;
+    tbl.image   = nullptr;
+    tbl.wave    = nullptr;
+    tbl.keys    = nullptr;
+    tbl.count   = buf.count;
+    tbl.swap    = swap;
+    tbl.swap_at = swap_at;
+    publish_upload(bank);
+    Serial.printf("Loaded %u custom sentences (%u bytes) in %u us\n",
+                  (unsigned)buf.count, (unsigned)(buf.count * sizeof(int16_t)),
+                  (unsigned)(micros() - start_us));
+}
+
+// Same as above for a generated scenario: the table holds no headings, the
+// TX task asks wave_gen[bank] for each one.
+static void apply_waveform(int bank, const WaveParams& p, SwapPolicy swap, size_t swap_at) {
+    HeadingTable& tbl = upload_table[bank];
+
+    upload_buf[bank].clear();
+    wave_gen[bank].configure(p);
+    tbl.deci    = nullptr;
+    tbl.image   = nullptr;
+    tbl.wave    = &wave_gen[bank];
+    tbl.keys    = nullptr;
+    tbl.count   = p.length;
+    tbl.swap    = swap;
+    tbl.swap_at = swap_at;
+    publish_upload(bank);
+    Serial.printf("Generating %u-sentence waveform (shape %u, %u periods)\n",
+                  (unsigned)p.length, (unsigned)p.shape, (unsigned)p.periods);
+}
+
+// And for keyframes: the TX task interpolates key_track[bank], which has
+// been configured for the current interval.
+static void apply_keyframes(int bank, SwapPolicy swap, size_t swap_at) {
+    HeadingTable&  tbl   = upload_table[bank];
+    KeyframeTrack& track = key_track[bank];
+
+    upload_buf[bank].clear();
+    tbl.deci    = nullptr;
+    tbl.image   = nullptr;
+    tbl.wave    = nullptr;
+    tbl.keys    = &track;
+    tbl.count   = track.ticks();
+    tbl.swap    = swap;
+    tbl.swap_at = swap_at;
+    publish_upload(bank);
+    Serial.printf("Interpolating %u keyframes over %u.%03u s (%u sentences)\n",
+                  (unsigned)track.count(), (unsigned)(track.duration_ms() / 1000),
+                  (unsigned)(track.duration_ms() % 1000), (unsigned)track.ticks());
+}
 
 // ---------------------------------------------------------------------------
-// Active transmission set
-// Pointers into nmea_default[] by default; switched to dyn_buf[] after a
-// custom sequence is received from the web page.
+// Transmitter — runs in the nmea_tx task once per TX interval
 // ---------------------------------------------------------------------------
 
-static char        dyn_buf[128][20];   // storage for web-uploaded sentences
-static const char* active[128];        // currently transmitting pointers
-static size_t      active_count  = 0;
-static size_t      sentence_index = 0;
+// TX interval and baud rate in force (the interval when no log is
+// playing), and whether the task is running at LOG_TICK_MS for one that is.
+static uint32_t tx_interval_ms = 0;
+static uint32_t tx_baud        = 0;
+static bool     tx_log_tick    = false;
 
-static void activate_default() {
-    for (size_t i = 0; i < DEFAULT_COUNT; i++)
-        active[i] = nmea_default[i];
-    active_count   = DEFAULT_COUNT;
-    sentence_index = 0;
-}
-// heading → "$HEHDT,xxx.x,T*CS\r\n"
-void makeHDT(float heading, char *out)
-{
-    // 1. Build the body without '$' and without checksum
-    //    Example: "HEHDT,331.9,T"
-    char body[32];
-    snprintf(body, sizeof(body), "HEHDT,%.1f,T", heading);
-
-    // 2. Compute XOR checksum
-    uint8_t cs = 0;
-    for (int i = 0; body[i] != 0; i++)
-        cs ^= body[i];
-
-    // 3. Convert checksum to two hex chars
-    char hex[3];
-    snprintf(hex, sizeof(hex), "%02X", cs);
-
-    // 4. Build final NMEA sentence
-    //    "$" + body + "*" + hex + "\r\n"
-    snprintf(out, 20, "$%s*%s\r\n", body, hex);
-}
-
-// Parse a comma-separated list of heading values from the POST body and
-// populate dyn_buf[], then make it the active table.
-static void apply_uploaded_sequence(const String& body) {
-    size_t count = 0;
-    int    start = 0;
-
-    while (count < 128) {
-        int    sep = body.indexOf(',', start);
-        String tok = (sep < 0) ? body.substring(start)
-                                : body.substring(start, sep);
-        tok.trim();
-        if (tok.length() == 0) break;
-
-        float h = tok.toFloat();
-        //snprintf(dyn_buf[count], sizeof(dyn_buf[count]), "$HEHDT,%.1f,T\r\n", h);
-        makeHDT(h, dyn_buf[count]);
-        active[count] = dyn_buf[count];
-        count++;
-
-        if (sep < 0) break;
-        start = sep + 1;
-    }
-
-    if (count > 0) {
-        active_count   = count;
-        sentence_index = 0;
-        Serial.printf("Loaded %u custom sentences from web page\n", (unsigned)count);
-    } else {
-        Serial.println("Warning: received empty sequence, keeping current table");
+static UartTx  uart;                     // Serial1
+static TxClock tx_clock;
+
+// Switch baud rate and interval between two ticks, so no sentence is split
+// across rates and the new interval starts from this tick.  A new baud
+// rate goes in only once the last burst has left at the old one; until
+// then the tick is retried, and returns false.  A change of interval
+// alone takes effect at once.
+static bool apply_line_request(uint32_t now_us) {
+    uint32_t req = line_request.load(std::memory_order_acquire);
+    if (!req)
+        return true;
+    uint32_t baud     = (req >> 16) * 100;
+    uint32_t interval = req & 0xFFFF;
+
+    if (baud != tx_baud) {
+        if (uint32_t wait = uart.set_baud(baud)) {
+            tx_clock.retry(now_us, wait);
+            return false;
+        }
+        tx_baud = baud;
+    }
+    line_request.compare_exchange_strong(req, 0, std::memory_order_acq_rel);
+    talker.set_line(interval, baud);
+    tx_interval_ms = interval;
+    if (!tx_log_tick)
+        tx_clock.set_period(interval);
+    return true;
+}
+
+static void tx_tick(uint32_t now_us, uint32_t missed) {
+    if (!apply_line_request(now_us))
+        return;
+
+    // A log being played replaces everything else; it is given room only
+    // while the line is nearly idle, so a log denser than the line runs
+    // late rather than overflowing the UART ring.
+    static char burst[LOG_BURST_MAX];
+    static_assert(LOG_BURST_MAX >= TALKER_BURST_MAX, "burst buffer too small");
+    size_t cap = uart.drain_us() <= LOG_TICK_MS * 1000 ? sizeof(burst) : 0;
+    size_t len;
+    bool   from_log = logs.tick(millis(), burst, cap, &len);
+    if (from_log != tx_log_tick) {
+        tx_log_tick = from_log;
+        tx_clock.set_period(from_log ? LOG_TICK_MS : tx_interval_ms);
+    }
+    metrics_tx_tick(now_us, from_log ? 0 : tx_interval_ms * 1000);
+
+    // In live mode the knob position replaces the sequence, which pauses.
+    HeadingTick h      = {};
+    TraceSource source = TRACE_FROM_LOG;
+    if (!from_log) {
+        source = TRACE_FROM_LIVE;
+        if (!live.take(&h.deci, micros())) {
+            player.next_heading(&h);
+            source = TRACE_FROM_SEQUENCE;
+        }
+        len = talker.tick(h, burst);
+        channels_tag_main(burst, len);
+        channels_set_heading(h.deci);
+    }
+    if (h.swapped)
+        trace(TRACE_SWAP, 0, 0, (uint32_t)player.active()->count);
+    if (len || !from_log)
+        uart.send(burst, len);
+    channels_mirror(burst, len, !from_log);
+    if (len)
+        trace(TRACE_SENT, source, (uint16_t)len,
+              from_log ? logs.sent() : (uint32_t)h.index);
+    if (!first_sent) {
+        first_sent_us = micros();
+        first_sent    = true;
+    }
+    live.note_sent(uart.drain_us());
+
+    if (h.wrapped)
+        tx_wraps = tx_wraps + 1;
+    if (missed) {
+        tx_missed = tx_missed + missed;
+        uart.missed(missed);
+        trace(TRACE_MISSED, 0, 0, missed);
     }
 }
 
+// TX task wake-up: channel 0, then the channels with deadlines of their own.
+static uint32_t tx_wake(uint32_t now_us) {
+    uint32_t missed;
+    if (tx_clock.take(now_us, &missed))
+        tx_tick(now_us, missed);
+    return tx_earliest(tx_clock.due_us, channels_service(now_us));
+}
+
 // ---------------------------------------------------------------------------
 // Web server
 // ---------------------------------------------------------------------------
 
-static WebServer server(80);
+// Handlers run in the async_tcp task (AsyncTCP), one event at a time, as
+// each packet arrives — several connections may be open at once, but no two
+// handlers run concurrently.  async_tcp sits below nmea_tx, so a request
+// can never hold up a sentence.
+static AsyncWebServer server(80);
+
+// /update body is read straight from the body chunks — no String copy —
+// as CSV text, or as int16 deci-degrees with Content-Type
+// application/octet-stream (heading_parser.h); a /keys body as keyframes.
+// There is one reader of each, so one upload at a time: the request that
+// owns them until its connection closes; others are answered 503.
+static HeadingParser          upload_parser;
+static HeadingBinReader       upload_bin;
+static KeyframeParser         key_parser;
+static bool                   upload_binary   = false;
+static uint32_t               upload_start_us = 0;
+static int                    upload_bank     = 0;
+static uint32_t               upload_parse_us = 0;       // handler time in the readers
+static AsyncWebServerRequest* upload_owner    = nullptr;
+
+// Upload in progress, for the LED: set here, shown by loop().
+static std::atomic<bool>      upload_led{false};
+
+static void release_upload(AsyncWebServerRequest* req) {
+    if (upload_owner != req)
+        return;
+    upload_owner = nullptr;
+    upload_led.store(false, std::memory_order_relaxed);
+}
+
+// Take the upload readers and a bank for `req`.
+static void claim_upload(AsyncWebServerRequest* req) {
+    upload_owner    = req;
+    upload_start_us = micros();
+    upload_parse_us = 0;
+    req->onDisconnect([req]() { release_upload(req); });
+    upload_bank = free_upload_bank();
+}
+
+// Start on an /update body in the format its Content-Type names.
+static void begin_update(AsyncWebServerRequest* req) {
+    upload_binary = req->contentType().startsWith("application/octet-stream");
+    if (upload_binary)
+        upload_bin.begin(&upload_buf[upload_bank], req->contentLength());
+    else
+        upload_parser.begin(&upload_buf[upload_bank]);
+}
+
+static void on_update_body(AsyncWebServerRequest* req, uint8_t* data, size_t len,
+                           size_t index, size_t total) {
+    (void)total;
+    if (index == 0) {
+        if (upload_owner)
+            return;                       // busy; answered in the request handler
+        claim_upload(req);
+        begin_update(req);
+        upload_led.store(true, std::memory_order_relaxed);
+    }
+    if (upload_owner != req)
+        return;
+    uint32_t t0 = micros();
+    if (upload_binary)
+        upload_bin.feed((const char*)data, len);
+    else
+        upload_parser.feed((const char*)data, len);
+    upload_parse_us += micros() - t0;
+}
+
+static void on_keys_body(AsyncWebServerRequest* req, uint8_t* data, size_t len,
+                         size_t index, size_t total) {
+    (void)total;
+    if (index == 0) {
+        if (upload_owner)
+            return;
+        claim_upload(req);
+        key_parser.begin(&key_track[upload_bank]);
+        upload_led.store(true, std::memory_order_relaxed);
+    }
+    if (upload_owner == req) {
+        uint32_t t0 = micros();
+        key_parser.feed((const char*)data, len);
+        upload_parse_us += micros() - t0;
+    }
+}
+
+// Query parameter `name`, empty if absent.
+static String arg(AsyncWebServerRequest* req, const char* name) {
+    const AsyncWebParameter* p = req->getParam(name);
+    return p ? p->value() : String();
+}
+
+// ?swap=now | wrap | <index>, default wrap; the index is an entry of the
+// table being transmitted.  Returns an error message or nullptr.
+static const char* parse_swap_arg(AsyncWebServerRequest* req, SwapPolicy* swap,
+                                  size_t* swap_at) {
+    String mode = arg(req, "swap");
+    *swap    = SWAP_WRAP;
+    *swap_at = 0;
+    if (mode.length() == 0 || mode == "wrap")
+        return nullptr;
+    if (mode == "now") {
+        *swap = SWAP_NOW;
+        return nullptr;
+    }
+
+    size_t index = 0;
+    for (const char* c = mode.c_str(); *c; c++) {
+        if (*c < '0' || *c > '9' || index > SEQ_MAX_ENTRIES)
+            return "swap must be now, wrap or an entry index";
+        index = index * 10 + (size_t)(*c - '0');
+    }
+    if (index >= player.active()->count)
+        return "swap index past the end of the current table";
+    *swap    = SWAP_AT;
+    *swap_at = index;
+    return nullptr;
+}
+
+// Decimal degrees argument in [lo, hi] deci-degrees; `def` if absent.
+static bool deci_arg(AsyncWebServerRequest* req, const char* name,
+                     int32_t lo, int32_t hi, int32_t def, int32_t* out) {
+    if (!req->hasParam(name)) {
+        *out = def;
+        return true;
+    }
+    return parse_deci(arg(req, name).c_str(), out) && *out >= lo && *out <= hi;
+}
+
+// Fill `p` from the /wave query string.  Returns an error message or nullptr.
+static const char* parse_wave_args(AsyncWebServerRequest* req, WaveParams* p) {
+    if (!wave_shape_from_name(arg(req, "shape").c_str(), &p->shape))
+        return "bad shape";
+
+    int32_t centre, amp, step;
+    if (!deci_arg(req, "centre", 0, 3599, 0, &centre)) return "bad centre";
+    if (!deci_arg(req, "amp", 0, 1800, 10, &amp))      return "bad amp";
+    if (!deci_arg(req, "step", 0, 1800, 2, &step))     return "bad step";
+
+    long periods = req->hasParam("periods") ? arg(req, "periods").toInt() : 1;
+    long length  = req->hasParam("length")  ? arg(req, "length").toInt()  : 125;
+    if (periods < 1 || periods > 1000)   return "bad periods";
+    if (length < 2 || length > 1000000L) return "bad length";
+
+    p->centre_deci = (int16_t)centre;
+    p->amp_deci    = (uint16_t)amp;
+    p->step_deci   = (uint16_t)step;
+    p->periods     = (uint16_t)periods;
+    p->length      = (uint32_t)length;
+    return nullptr;
+}
+
+// Put checked settings in force: the TX task switches baud rate and
+// interval at its next tick; the mix applies at once.  Stored in NVS.
+static void apply_line(const LineConfig& next) {
+    if (next.baud != line.baud || next.interval_ms != line.interval_ms)
+        line_request.store((next.baud / 100) << 16 | next.interval_ms,
+                           std::memory_order_release);
+    talker.set_mix(next.mix);
+    if (memcmp(&next, &line, sizeof(line)) != 0)
+        line_config_save(next);
+    line = next;
+}
+
+// /line and /talker: baud=, rate= (Hz) and hdt= ths= rot= hdg= (ticks
+// between sentences, 0 = off).  Omitted settings are kept.  A combination
+// that line_config_check() rejects is answered with 400 and changes
+// nothing; an accepted one is applied at the next tick and stored in NVS.
+static void handle_line(AsyncWebServerRequest* req) {
+    LineConfig next = line;
+    char       why[80];
+
+    if (req->hasParam("baud"))
+        next.baud = (uint32_t)arg(req, "baud").toInt();
+    if (req->hasParam("rate")) {
+        long hz = arg(req, "rate").toInt();
+        // 0 (no whole-ms interval) is rejected by line_config_check()
+        next.interval_ms = (hz > 0 && 1000 % hz == 0) ? (uint16_t)(1000 / hz) : 0;
+    }
+    for (int i = 0; i < SENT_COUNT; i++) {
+        const char* name = sentence_name((SentenceType)i);
+        if (!req->hasParam(name))
+            continue;
+        long every = arg(req, name).toInt();
+        if (every < 0 || every > 255) {
+            req->send(400, "text/plain", "every must be 0 .. 255 ticks");
+            return;
+        }
+        next.mix.every[i] = (uint8_t)every;
+    }
+
+    if (line_config_check(next, why, sizeof(why))) {
+        Serial.printf("Warning: /line rejected: %s\n", why);
+        req->send(400, "text/plain", why);
+        return;
+    }
+    apply_line(next);
+
+    char msg[128];
+    line_config_describe(line, msg, sizeof(msg));
+    req->send(200, "text/plain", msg);
+}
+
+// /channel: list the output channels; with ch=<n> change one of them:
+//   enable=0|1, baud=, rate=<Hz> | follow (mirror channel 0),
+//   hdt= ths= rot= hdg= as for /line, talker=<two letters>,
+//   offset=<degrees> and seq=follow | default | <slot>.
+// Channel 0 takes talker= only; its other settings are on /line.
+// Omitted settings are kept; a rejected change changes nothing.
+static void handle_channel(AsyncWebServerRequest* req) {
+    char msg[CHANNEL_MAX * 320];
+    char why[80];
+
+    if (req->hasParam("ch")) {
+        long n = arg(req, "ch").toInt();
+        if (n < 0 || n >= channel_count()) {
+            req->send(400, "text/plain", "no such channel");
+            return;
+        }
+        ChannelConfig next = channel_config((uint8_t)n);
+        const char*   err  = nullptr;
+
+        if (req->hasParam("talker")) {
+            String id = arg(req, "talker");
+            if (id.length() != 2)
+                err = "talker ID must be two letters A .. Z";
+            else
+                memcpy(next.talker_id, id.c_str(), 3);
+        }
+        if (n == 0) {
+            static const char* const others[] = {
+                "enable", "baud", "rate", "hdt", "ths", "rot", "hdg", "offset", "seq" };
+            for (const char* name : others)
+                if (req->hasParam(name))
+                    err = "channel 0 takes talker= only; see /line";
+        }
+        if (req->hasParam("enable"))
+            next.enabled = arg(req, "enable").toInt() != 0;
+        if (req->hasParam("baud"))
+            next.line.baud = (uint32_t)arg(req, "baud").toInt();
+        if (req->hasParam("rate")) {
+            String rate = arg(req, "rate");
+            long   hz   = rate.toInt();
+            if (rate == "follow")
+                next.line.interval_ms = 0;
+            else if (hz > 0 && 1000 % hz == 0)
+                next.line.interval_ms = (uint16_t)(1000 / hz);
+            else
+                err = "rate must divide 1000 Hz, or be follow";
+        }
+        for (int i = 0; i < SENT_COUNT; i++) {
+            const char* name = sentence_name((SentenceType)i);
+            if (!req->hasParam(name))
+                continue;
+            long every = arg(req, name).toInt();
+            if (every < 0 || every > 255)
+                err = "every must be 0 .. 255 ticks";
+            else
+                next.line.mix.every[i] = (uint8_t)every;
+        }
+        int32_t offset;
+        if (!deci_arg(req, "offset", -1800, 1800, next.offset_deci, &offset))
+            err = "offset must be -180 .. 180";
+        next.offset_deci = (int16_t)offset;
+        if (req->hasParam("seq")) {
+            String seq = arg(req, "seq");
+            if (seq == "follow")
+                seq = "";
+            if (seq.length() > SLOT_NAME_MAX)
+                err = "bad slot name";
+            else
+                strcpy(next.source, seq.c_str());
+        }
+
+        if (!err)
+            err = channel_configure((uint8_t)n, next, line, why, sizeof(why));
+        if (err) {
+            Serial.printf("Warning: /channel rejected: %s\n", err);
+            req->send(400, "text/plain", err);
+            return;
+        }
+    }
+
+    size_t len = 0;
+    for (uint8_t n = 0; n < channel_count(); n++)
+        len += channel_describe(n, msg + len, sizeof(msg) - len);
+    req->send(200, "text/plain", msg);
+}
+
+// /slots: list the stored sequences and the boot timing; with
+//   save=<name>    store the sequence being transmitted
+//   load=<name>    switch to a stored sequence (swap= as for /update)
+//   boot=<name>    start from it after a reset ("default": built-in table)
+//   delete=<name>  remove it
+static void handle_slots(AsyncWebServerRequest* req) {
+    char        msg[512];
+    const char* err = nullptr;
+
+    if (req->hasParam("save")) {
+        const HeadingTable* t = player.active();
+        err = t->deci ? slot_save(arg(req, "save").c_str(), t->deci, t->count)
+                      : "a waveform or keyframe track has no stored headings";
+    } else if (req->hasParam("load")) {
+        if (upload_owner) {
+            req->send(503, "text/plain", "busy: an upload is in progress");
+            return;
+        }
+        uint32_t   t0   = micros();
+        int        bank = free_upload_bank();
+        SwapPolicy swap;
+        size_t     swap_at;
+        SlotLoader loader;
+        err = parse_swap_arg(req, &swap, &swap_at);
+        if (!err)
+            err = loader.begin(arg(req, "load").c_str(), &upload_buf[bank], SEQ_MAX_ENTRIES);
+        if (!err)
+            apply_uploaded_sequence(bank, swap, swap_at, t0);
+    } else if (req->hasParam("boot")) {
+        String name = arg(req, "boot");
+        if (name == "default") {
+            slot_set_boot("");
+        } else if (!slot_name_ok(name.c_str())) {
+            err = "bad slot name";
+        } else {
+            SlotInfo list[SLOT_MAX];
+            size_t   n     = slot_list(list, SLOT_MAX);
+            bool     found = false;
+            for (size_t i = 0; i < n; i++)
+                found |= strcmp(list[i].name, name.c_str()) == 0;
+            if (found)
+                slot_set_boot(name.c_str());
+            else
+                err = "no such slot";
+        }
+    } else if (req->hasParam("delete")) {
+        String name = arg(req, "delete");
+        char   boot[SLOT_NAME_MAX + 1];
+        if (!slot_remove(name.c_str())) {
+            err = "no such slot";
+        } else {
+            slot_get_boot(boot);
+            if (strcmp(boot, name.c_str()) == 0)
+                slot_set_boot("");
+        }
+    }
+    if (err) {
+        Serial.printf("Warning: /slots %s\n", err);
+        req->send(400, "text/plain", err);
+        return;
+    }
+
+    char boot[SLOT_NAME_MAX + 1];
+    slot_get_boot(boot);
+    int len = snprintf(msg, sizeof(msg),
+                       "boot=%s first_sentence_us=%u boot_read_us=%u boot_rest_us=%u "
+                       "fs_used=%u fs_total=%u\n",
+                       boot[0] ? boot : "default", first_sent ? (unsigned)first_sent_us : 0,
+                       (unsigned)boot_read_us, (unsigned)boot_rest_us,
+                       (unsigned)LittleFS.usedBytes(), (unsigned)LittleFS.totalBytes());
+    SlotInfo list[SLOT_MAX];
+    size_t   n = slot_list(list, SLOT_MAX);
+    for (size_t i = 0; i < n && len < (int)sizeof(msg); i++)
+        len += snprintf(msg + len, sizeof(msg) - len, "%s %u\n",
+                        list[i].name, (unsigned)list[i].count);
+    req->send(200, "text/plain", msg);
+}
+
+// /logs body: written to flash as it arrives (log_player.h), so a log of
+// any length needs no more RAM than a chunk.  One upload at a time.
+static LogWriter              log_writer;
+static const char*            log_upload_err = nullptr;
+static uint32_t               log_upload_len = 0;
+static AsyncWebServerRequest* log_owner      = nullptr;
+
+static void release_log_upload(AsyncWebServerRequest* req) {
+    if (log_owner != req)
+        return;
+    log_writer.abort();                  // no-op once finished
+    log_owner = nullptr;
+}
+
+static void on_logs_body(AsyncWebServerRequest* req, uint8_t* data, size_t len,
+                         size_t index, size_t total) {
+    if (index == 0) {
+        if (log_owner || !req->hasParam("name"))
+            return;                       // answered in the request handler
+        log_owner      = req;
+        log_upload_len = (uint32_t)total;
+        req->onDisconnect([req]() { release_log_upload(req); });
+        log_upload_err = log_writer.begin(arg(req, "name").c_str());
+    }
+    if (log_owner == req && !log_upload_err)
+        log_writer.write(data, len);
+}
+
+// /logs: list the stored logs and the playback counters; with
+//   name=<name>    store the request body as that log
+//   play=<name>    replay it in place of the sequence (loop=0: only once)
+//   stop=1         back to the sequence
+//   delete=<name>  remove it
+static void handle_logs(AsyncWebServerRequest* req) {
+    char        msg[640];
+    const char* err = nullptr;
+    LogStats    st  = logs.stats();
+
+    if (req->hasParam("name")) {
+        if (log_owner != req) {
+            req->send(log_owner ? 503 : 400, "text/plain",
+                      log_owner ? "busy: another log upload is in progress"
+                                : "no log in the body (post it as text/plain)");
+            return;
+        }
+        err = log_upload_err ? log_upload_err : log_writer.finish();
+        release_log_upload(req);
+        if (!err)
+            Serial.printf("Stored log '%s' (%u bytes)\n", arg(req, "name").c_str(),
+                          (unsigned)log_upload_len);
+    } else if (req->hasParam("play")) {
+        err = logs.play(arg(req, "play").c_str(), arg(req, "loop") != "0", line.interval_ms);
+    } else if (req->hasParam("stop")) {
+        err = logs.stop();
+    } else if (req->hasParam("delete")) {
+        String name = arg(req, "delete");
+        if (st.playing && name == st.name)
+            err = "log is playing";
+        else if (!log_remove(name.c_str()))
+            err = "no such log";
+    }
+    if (err) {
+        Serial.printf("Warning: /logs %s\n", err);
+        req->send(400, "text/plain", err);
+        return;
+    }
+
+    int len = snprintf(msg, sizeof(msg),
+                       "playing=%s sent=%u cycles=%u skipped=%u underruns=%u "
+                       "late_max_ms=%u late_avg_us=%u file_pos=%u file_size=%u\n",
+                       st.playing ? st.name : "-", (unsigned)st.sent, (unsigned)st.cycles,
+                       (unsigned)st.skipped, (unsigned)st.underruns, (unsigned)st.late_max_ms,
+                       (unsigned)st.late_avg_us, (unsigned)st.file_pos, (unsigned)st.file_size);
+    LogInfo list[LOG_LIST_MAX];
+    size_t  n = log_list(list, LOG_LIST_MAX);
+    for (size_t i = 0; i < n && len < (int)sizeof(msg); i++)
+        len += snprintf(msg + len, sizeof(msg) - len, "%s %u\n",
+                        list[i].name, (unsigned)list[i].size);
+    req->send(200, "text/plain", msg);
+}
+
+// /live WebSocket: knob positions in, "on the wire" acks out (frame
+// formats in live_heading.h).  The client that sent the last position
+// steers; live mode ends when it sends 'R' or disconnects.
+static AsyncWebSocket live_ws("/live");
+static uint32_t       live_client = 0;       // id of the steering client, 0 = none
+
+static void on_live_event(AsyncWebSocket* ws, AsyncWebSocketClient* client, AwsEventType type,
+                          void* arg, uint8_t* data, size_t len) {
+    (void)ws;
+    if (type == WS_EVT_DISCONNECT && client->id() == live_client) {
+        live_client = 0;
+        live.release();
+        return;
+    }
+    if (type != WS_EVT_DATA)
+        return;
+
+    // Frames are a few bytes: always a single, complete binary frame.
+    AwsFrameInfo* info = (AwsFrameInfo*)arg;
+    if (info->opcode != WS_BINARY || !info->final || info->index != 0 || len < 1)
+        return;
+
+    switch (data[0]) {
+    case LIVE_FRAME_HEADING: {
+        if (len < LIVE_HEADING_LEN)
+            return;
+        uint16_t seq  = (uint16_t)(data[2] | data[3] << 8);
+        int16_t  deci = (int16_t)(data[4] | data[5] << 8);
+        if (deci < 0 || deci > 3599)
+            return;
+        live_client = client->id();
+        live.set(deci, seq, micros());
+        break;
+    }
+    case LIVE_FRAME_RELEASE:
+        if (client->id() == live_client) {
+            live_client = 0;
+            live.release();
+        }
+        break;
+    case LIVE_FRAME_PING:
+        client->binary(data, len);
+        break;
+    }
+}
+
+// Pages are stored gzipped (web_assets.h, generated from web_page.h and
+// func_page.h).  A browser that already has the current version gets 304.
+static void send_page(AsyncWebServerRequest* req, const uint8_t* gz, size_t len,
+                      const char* etag) {
+    const AsyncWebHeader*   inm = req->getHeader("If-None-Match");
+    AsyncWebServerResponse* res;
+    if (inm && strstr(inm->value().c_str(), etag)) {
+        res = req->beginResponse(304);
+    } else {
+        res = req->beginResponse(200, "text/html", gz, len);
+        res->addHeader("Content-Encoding", "gzip");
+    }
+    res->addHeader("ETag", etag);
+    res->addHeader("Cache-Control", WEB_CACHE_CONTROL);
+    req->send(res);
+}
+
+// Every route is registered through route(), so /metrics sees the time
+// spent in each handler and body chunk, and /trace each request.
+static ArRequestHandlerFunction timed_request(ArRequestHandlerFunction fn, uint8_t id) {
+    return [fn, id](AsyncWebServerRequest* req) {
+        trace(TRACE_HTTP_BEGIN, id, 0, (uint32_t)req->contentLength());
+        uint32_t t0 = micros();
+        fn(req);
+        uint32_t us = micros() - t0;
+        metrics_http(us, true);
+        trace(TRACE_HTTP_END, id, 0, us);
+    };
+}
+
+static ArBodyHandlerFunction timed_body(ArBodyHandlerFunction fn) {
+    return [fn](AsyncWebServerRequest* req, uint8_t* data, size_t len,
+                size_t index, size_t total) {
+        uint32_t t0 = micros();
+        fn(req, data, len, index, total);
+        metrics_http(micros() - t0, false);
+    };
+}
+
+static void route(const char* uri, WebRequestMethodComposite method,
+                  ArRequestHandlerFunction fn, ArBodyHandlerFunction body = nullptr) {
+    uint8_t id = trace_route(uri);
+    if (body)
+        server.on(uri, method, timed_request(fn, id), nullptr, timed_body(body));
+    else
+        server.on(uri, method, timed_request(fn, id));
+}
+
+// /metrics text; handlers run one at a time, so one buffer will do.
+static char metrics_text[5120];
+
+// Gather the counters kept by the other modules and format them all.
+static size_t format_metrics(bool json, char* out, size_t cap) {
+    UartTxStats st = uart.stats();
+    Metrics     m  = {};
+    m.uptime_ms = millis();
+    m.sentences = talker.sent() + logs.stats().sent_total;
+    m.bytes     = st.bytes_queued;
+    m.dropped   = st.dropped;
+    m.deferred  = talker.deferred();
+    m.missed    = tx_missed;
+    m.wraps     = tx_wraps;
+    metrics_read(&m);
+    return json ? metrics_json(m, out, cap) : metrics_prometheus(m, out, cap);
+}
 
 static void setup_server() {
+    // Live steering (before the routes, so /live upgrades are not taken
+    // for plain requests).
+    live_ws.onEvent(on_live_event);
+    server.addHandler(&live_ws);
+
     // Serve the knob page
-    server.on("/", HTTP_GET, []() {
-        server.send(200, "text/html", WEB_PAGE);
+    route("/", HTTP_GET, [](AsyncWebServerRequest* req) {
+        send_page(req, WEB_PAGE_GZ, WEB_PAGE_GZ_LEN, WEB_PAGE_ETAG);
     });
 
     // Serve the function-generator page
-    server.on("/addfunction", HTTP_GET, []() {
-        server.send(200, "text/html", FUNC_PAGE);
+    route("/addfunction", HTTP_GET, [](AsyncWebServerRequest* req) {
+        send_page(req, FUNC_PAGE_GZ, FUNC_PAGE_GZ_LEN, FUNC_PAGE_ETAG);
     });
 
-    // Receive the completed 125-heading sequence
-    server.on("/update", HTTP_POST, []() {
-        String body = server.arg("plain");
-        if (body.length() == 0) {
-            server.send(400, "text/plain", "empty body");
+    // Receive the completed 125-heading sequence: CSV degrees, or int16
+    // deci-degrees as application/octet-stream (heading_parser.h).
+    // Optional ?swap=now | wrap | <index> picks when it replaces the current
+    // one (default: wrap, so the running cycle always completes);
+    // ?save=<name> also stores it in that slot.
+    route("/update", HTTP_POST, [](AsyncWebServerRequest* req) {
+        // Form-encoded posts (e.g. plain `curl -d`) bypass the body
+        // callback; parse the buffered copy in one chunk instead.
+        uint32_t                 t0   = micros();
+        const AsyncWebParameter* form = req->getParam("body", true);
+        if (!upload_owner && (form || req->contentLength() == 0)) {
+            claim_upload(req);
+            begin_update(req);
+            if (form)
+                upload_parser.feed(form->value().c_str(), form->value().length());
+        }
+        if (upload_owner != req) {
+            req->send(503, "text/plain", "busy: another upload is in progress");
+            return;
+        }
+        bool        ok  = upload_binary ? upload_bin.finish() : upload_parser.finish();
+        metrics_parse(upload_parse_us + (micros() - t0));
+        const char* err = upload_binary ? upload_bin.error()  : upload_parser.error();
+        size_t      at  = upload_binary ? upload_bin.error_offset() : upload_parser.error_offset();
+        release_upload(req);
+
+        char msg[112];
+        if (!ok) {
+            snprintf(msg, sizeof(msg), "parse error at byte %u: %s", (unsigned)at, err);
+            Serial.printf("Warning: /update %s\n", msg);
+            req->send(400, "text/plain", msg);
             return;
         }
-        apply_uploaded_sequence(body);
-        server.send(200, "text/plain", "ok");
+        String save = arg(req, "save");
+        if (save.length() && !slot_name_ok(save.c_str())) {
+            req->send(400, "text/plain", "bad slot name");
+            return;
+        }
+        SwapPolicy swap;
+        size_t     swap_at;
+        if (const char* why = parse_swap_arg(req, &swap, &swap_at)) {
+            req->send(400, "text/plain", why);
+            return;
+        }
+
+        // A binary header may also set the TX interval; checked like /line.
+        if (upload_binary && upload_bin.interval_ms()) {
+            LineConfig next  = line;
+            next.interval_ms = upload_bin.interval_ms();
+            char why[80];
+            if (line_config_check(next, why, sizeof(why))) {
+                snprintf(msg, sizeof(msg), "interval rejected: %s", why);
+                Serial.printf("Warning: /update %s\n", msg);
+                req->send(400, "text/plain", msg);
+                return;
+            }
+            apply_line(next);
+        }
+
+        apply_uploaded_sequence(upload_bank, swap, swap_at, upload_start_us);
+
+        if (save.length()) {
+            const HeadingBuffer& buf = upload_buf[upload_bank];
+            if (const char* why = slot_save(save.c_str(), buf.data, buf.count)) {
+                snprintf(msg, sizeof(msg), "loaded, but not saved: %s", why);
+                Serial.printf("Warning: /update %s\n", msg);
+                req->send(500, "text/plain", msg);
+                return;
+            }
+        }
+        req->send(200, "text/plain", "ok");
+    }, on_update_body);
+
+    // Start a generated scenario; everything is in the query string, e.g.
+    //   /wave?shape=sine&centre=330.0&amp=2.0&periods=1&length=125
+    // shape: sine | sawtooth | triangle | square | random (step= per tick).
+    // swap= works as for /update.
+    route("/wave", HTTP_POST, [](AsyncWebServerRequest* req) {
+        WaveParams  p = {};
+        SwapPolicy  swap;
+        size_t      swap_at;
+        const char* err = parse_wave_args(req, &p);
+        if (!err)
+            err = parse_swap_arg(req, &swap, &swap_at);
+        if (err) {
+            Serial.printf("Warning: /wave %s\n", err);
+            req->send(400, "text/plain", err);
+            return;
+        }
+        // The bank an upload is being parsed into must not be reused.
+        if (upload_owner) {
+            req->send(503, "text/plain", "busy: an upload is in progress");
+            return;
+        }
+
+        apply_waveform(free_upload_bank(), p, swap, swap_at);
+        req->send(200, "text/plain", "ok");
+    });
+
+    // Keyframes interpolated at the TX rate (keyframes.h), one
+    // "time,heading" pair per line, e.g. "0,330\n5,340\n12.5,355".
+    // ?interp=linear | cubic (default linear), ?arc=short | direct
+    // (default short: the shorter way round); swap= works as for /update.
+    route("/keys", HTTP_POST, [](AsyncWebServerRequest* req) {
+        uint32_t                 t0   = micros();
+        const AsyncWebParameter* form = req->getParam("body", true);
+        if (!upload_owner && (form || req->contentLength() == 0)) {
+            claim_upload(req);
+            key_parser.begin(&key_track[upload_bank]);
+            if (form)
+                key_parser.feed(form->value().c_str(), form->value().length());
+        }
+        if (upload_owner != req) {
+            req->send(503, "text/plain", "busy: another upload is in progress");
+            return;
+        }
+        bool ok = key_parser.finish();
+        metrics_parse(upload_parse_us + (micros() - t0));
+        release_upload(req);
+
+        char        msg[112];
+        const char* err = nullptr;
+        KeyInterp   interp = KEY_LINEAR;
+        String      arc    = arg(req, "arc");
+        SwapPolicy  swap;
+        size_t      swap_at;
+        if (!ok) {
+            snprintf(msg, sizeof(msg), "parse error at byte %u: %s",
+                     (unsigned)key_parser.error_offset(), key_parser.error());
+            err = msg;
+        } else if (req->hasParam("interp")
+                   && !key_interp_from_name(arg(req, "interp").c_str(), &interp)) {
+            err = "bad interp";
+        } else if (arc.length() && arc != "short" && arc != "direct") {
+            err = "bad arc";
+        } else if (!(err = parse_swap_arg(req, &swap, &swap_at))) {
+            err = key_track[upload_bank].configure(interp, arc != "direct", line.interval_ms);
+        }
+        if (err) {
+            Serial.printf("Warning: /keys %s\n", err);
+            req->send(400, "text/plain", err);
+            return;
+        }
+
+        apply_keyframes(upload_bank, swap, swap_at);
+        req->send(200, "text/plain", "ok");
+    }, on_keys_body);
+
+    // Stored sequences (slots.h).
+    route("/slots", HTTP_ANY, handle_slots);
+
+    // Recorded logs and their playback (log_player.h).
+    route("/logs", HTTP_ANY, handle_logs, on_logs_body);
+
+    // Output settings; without arguments they are just reported.
+    route("/line",   HTTP_ANY, handle_line);
+    route("/talker", HTTP_ANY, handle_line);
+
+    // Further output channels (channels.h).
+    route("/channel", HTTP_ANY, handle_channel);
+
+    // UART output counters (uart_tx.h).
+    route("/uart", HTTP_GET, [](AsyncWebServerRequest* req) {
+        UartTxStats st = uart.stats();
+        char        msg[160];
+        snprintf(msg, sizeof(msg),
+                 "bytes_queued=%u dropped=%u backlog=%u underruns=%u "
+                 "blocked_us=%u blocked_max_us=%u\n",
+                 (unsigned)st.bytes_queued, (unsigned)st.dropped, (unsigned)st.backlog,
+                 (unsigned)st.underruns, (unsigned)st.blocked_us, (unsigned)st.blocked_max_us);
+        req->send(200, "text/plain", msg);
     });
 
+    // Live-steer counters and latency (live_heading.h).
+    route("/live/stats", HTTP_GET, [](AsyncWebServerRequest* req) {
+        LiveStats st = live.stats();
+        char      msg[192];
+        snprintf(msg, sizeof(msg),
+                 "live=%d received=%u applied=%u coalesced=%u "
+                 "wire_us_last=%u wire_us_avg=%u wire_us_max=%u\n",
+                 live.active() ? 1 : 0, (unsigned)st.received, (unsigned)st.applied,
+                 (unsigned)st.coalesced, (unsigned)st.wire_us_last,
+                 (unsigned)st.wire_us_avg, (unsigned)st.wire_us_max);
+        req->send(200, "text/plain", msg);
+    });
+
+    // NMEA-over-Wi-Fi counters; ?udp=1 / ?udp=0 switches UDP broadcast.
+    route("/net", HTTP_ANY, [](AsyncWebServerRequest* req) {
+        if (req->hasParam("udp"))
+            net_stream_set_udp(arg(req, "udp").toInt() != 0);
+        NetStreamStats st = net_stream_stats();
+        char           msg[200];
+        snprintf(msg, sizeof(msg),
+                 "tcp_port=%d clients=%u accepted=%u refused=%u dropped_slow=%u "
+                 "bytes_sent=%u udp=%d udp_datagrams=%u udp_errors=%u\n",
+                 NET_TCP_PORT, (unsigned)st.clients, (unsigned)st.accepted,
+                 (unsigned)st.refused, (unsigned)st.dropped_slow, (unsigned)st.bytes_sent,
+                 st.udp ? 1 : 0, (unsigned)st.udp_datagrams, (unsigned)st.udp_errors);
+        req->send(200, "text/plain", msg);
+    });
+
+    // Counters for monitoring (metrics.h): Prometheus text, or JSON with
+    // ?format=json.
+    route("/metrics", HTTP_GET, [](AsyncWebServerRequest* req) {
+        bool json = arg(req, "format") == "json";
+        if (!format_metrics(json, metrics_text, sizeof(metrics_text))) {
+            req->send(500, "text/plain", "metrics buffer too small");
+            return;
+        }
+        req->send(200, json ? "application/json" : "text/plain; version=0.0.4", metrics_text);
+    });
+
+    // The last TRACE_EVENTS events (trace.h): binary, or Chrome trace JSON
+    // with ?format=json.  Formatted as the response is sent, from the ring
+    // itself.
+    route("/trace", HTTP_GET, [](AsyncWebServerRequest* req) {
+        bool      json = arg(req, "format") == "json";
+        TraceDump dump(json);
+        req->send(req->beginChunkedResponse(
+            json ? "application/json" : "application/octet-stream",
+            [dump](uint8_t* buf, size_t max_len, size_t index) mutable {
+                (void)index;
+                return dump.read(buf, max_len);
+            }));
+    });
+
+    server.onNotFound(timed_request([](AsyncWebServerRequest* req) {
+        req->send(404, "text/plain", "Not found");
+    }, 0));
+
     server.begin();
 }
 
@@ -303,39 +1270,137 @@ static void setup_server() {
 void setup() {
     Serial.begin(115200);
 
-    // UART1 for NMEA output
-    Serial1.begin(9600, SERIAL_8N1, NMEA_UART_RX_PIN, NMEA_UART_TX_PIN);
+#ifdef NMEA_BENCH
+    nmea_bench_run();
+#endif
+
+    // Output settings: built-in defaults, overridden by what /line stored.
+    line.baud        = NMEA_BAUD;
+    line.interval_ms = TX_INTERVAL_MS;
+    line.mix         = {{ TALKER_HDT_EVERY, TALKER_THS_EVERY,
+                          TALKER_ROT_EVERY, TALKER_HDG_EVERY }};
+    LineConfig defaults = line;
+    char       why[80];
+    if (line_config_load(&line) && line_config_check(line, why, sizeof(why))) {
+        Serial.printf("Warning: stored output settings ignored: %s\n", why);
+        line = defaults;
+    }
+    if (line_config_check(line, why, sizeof(why)))
+        Serial.printf("Warning: %s; sentences will be deferred\n", why);
+
+    // UART1 for NMEA output, and the further channels (channels.h)
+    uart.begin(Serial1, line.baud, SERIAL_8N1, NMEA_UART_RX_PIN, NMEA_UART_TX_PIN);
+    init_default(SWAP_WRAP);             // also what the channels copy
+    channels_begin(&default_table, line, NMEA_UART_TX_PIN);
 
     // Onboard LED
-    pinMode(LED_PIN, OUTPUT);
-    digitalWrite(LED_PIN, LED_OFF);
+    led_begin(LED_PIN, LED_ACTIVE_LOW);
 
-    activate_default();
+    // Sequence: the boot slot's first entries, or the default table.
+    slots_begin();
+    SlotLoader boot_loader;
+    bool       from_slot = begin_boot_sequence(&boot_loader);
+    talker.begin(line.mix, line.interval_ms, line.baud);
+
+    // NMEA to Wi-Fi clients get everything queued for the UART once
+    // net_stream_begin() below has run.
+    uart.set_tap(net_stream_write);
+
+#if NMEA_CHANNELS > 1
+    channel_begin(1, ch1_port, NMEA_CH1_UART, NMEA_CH1_RX_PIN, NMEA_CH1_TX_PIN);
+#endif
+#if NMEA_CHANNELS > 2
+    channel_begin(2, ch2_port, NMEA_CH2_UART, NMEA_CH2_RX_PIN, NMEA_CH2_TX_PIN);
+#endif
+
+    // Sentences start now, before Wi-Fi, which takes longest to come up.
+    tx_interval_ms = line.interval_ms;
+    tx_baud        = line.baud;
+    tx_clock.start(line.interval_ms, micros());
+    tx_task_start(tx_wake);
+    if (from_slot)
+        finish_boot_sequence(&boot_loader);
+    channels_finish_boot();
 
     // Start Wi-Fi access point
     WiFi.softAP(AP_SSID, AP_PASS);
     Serial.printf("AP started — SSID: %s  IP: %s\n",
                   AP_SSID, WiFi.softAPIP().toString().c_str());
 
+    net_stream_begin(WiFi.softAPBroadcastIP());
     setup_server();
 
-    Serial.printf("NMEA emulator ready: %u sentences, %u ms interval, TX GPIO%d\n",
-                  (unsigned)active_count, (unsigned)TX_INTERVAL_MS, NMEA_UART_TX_PIN);
+    Serial.printf("NMEA emulator ready: %u sentences, %u ms interval, %u baud, TX GPIO%d\n",
+                  (unsigned)player.active()->count, (unsigned)line.interval_ms,
+                  (unsigned)line.baud, NMEA_UART_TX_PIN);
 }
 
+// Loop task: LED, warnings, live-steer acks and reading the log being
+// played; HTTP is served by the async_tcp task.  Nothing here can delay a
+// sentence.
 void loop() {
-    // Service any pending HTTP request before transmitting.
-    server.handleClient();
+    static uint32_t wraps_seen  = 0;
+    static uint32_t missed_seen = 0;
+    static uint32_t missed_shown = 0;
+    static uint32_t deferred_shown = 0;
+    static uint32_t dropped_shown  = 0;
+    static bool     boot_shown     = false;
+    static bool     upload_shown   = false;
+
+    if (first_sent && !boot_shown) {
+        boot_shown = true;
+        Serial.printf("First sentence %u.%03u ms after start (%s, %u us of it reading the slot)\n",
+                      (unsigned)(first_sent_us / 1000), (unsigned)(first_sent_us % 1000),
+                      boot_slot[0] ? boot_slot : "default table", (unsigned)boot_read_us);
+    }
 
-    Serial1.print(active[sentence_index]);
-    sentence_index = (sentence_index + 1) % active_count;
+    // Tell the page when its latest position reached the wire.
+    LiveAck ack;
+    if (live.take_ack(&ack)) {
+        uint8_t f[LIVE_ACK_LEN] = {
+            LIVE_FRAME_ACK, 0, (uint8_t)ack.seq, (uint8_t)(ack.seq >> 8),
+            (uint8_t)ack.wire_us, (uint8_t)(ack.wire_us >> 8),
+            (uint8_t)(ack.wire_us >> 16), (uint8_t)(ack.wire_us >> 24),
+        };
+        live_ws.binaryAll(f, sizeof(f));
+    }
+    live_ws.cleanupClients();
 
-    // Brief LED blink when the sequence wraps around to entry 0.
-    if (sentence_index == 0) {
-        digitalWrite(LED_PIN, LED_ON);
-        delay(50);
-        digitalWrite(LED_PIN, LED_OFF);
+    uint32_t wraps  = tx_wraps;
+    uint32_t missed = tx_missed;
+
+    bool uploading = upload_led.load(std::memory_order_relaxed);
+    if (uploading != upload_shown) {
+        upload_shown = uploading;
+        led_set_upload(uploading);
+    }
+    if (missed != missed_seen) {
+        missed_seen = missed;
+        led_trigger(LED_MISSED);
+    }
+    if (wraps != wraps_seen) {
+        wraps_seen = wraps;
+        led_trigger(LED_WRAP);
+
+        if (missed != missed_shown) {
+            Serial.printf("Warning: %u TX deadlines missed since boot\n", (unsigned)missed);
+            missed_shown = missed;
+        }
+        uint32_t deferred = talker.deferred();
+        if (deferred != deferred_shown) {
+            Serial.printf("Warning: %u sentences deferred (line full) since boot\n",
+                          (unsigned)deferred);
+            deferred_shown = deferred;
+        }
+        uint32_t dropped = uart.stats().dropped;
+        if (dropped != dropped_shown) {
+            Serial.printf("Warning: %u sentences dropped (UART ring full) since boot\n",
+                          (unsigned)dropped);
+            dropped_shown = dropped;
+        }
     }
 
-    delay(TX_INTERVAL_MS);
+    logs.service();
+    led_service(millis());
+    delay(LOOP_SLICE_MS);
 }
@@ -0,0 +1,264 @@
+/*
+ * metrics.cpp
+ *
+ * Run-time counters for /metrics — see metrics.h.
+ */
+
+#include "metrics.h"
+#include <atomic>
+#include <cstdarg>
+
+static const int32_t SPACING_BOUNDS[] = { METRICS_SPACING_BOUNDS };
+static const size_t  SPACING_BOUND_COUNT = sizeof(SPACING_BOUNDS) / sizeof(SPACING_BOUNDS[0]);
+static_assert(SPACING_BOUND_COUNT + 1 == METRICS_SPACING_BUCKETS, "one bucket per bound, plus +Inf");
+
+// TX task: odd `spacing_seq` while the histogram is being updated.
+static std::atomic<uint32_t> spacing_seq{0};
+static uint32_t              spacing_bucket[METRICS_SPACING_BUCKETS];
+static uint32_t              spacing_count  = 0;
+static int64_t               spacing_sum_us = 0;
+static uint32_t              spacing_max_us = 0;
+static uint32_t              last_tick_us   = 0;
+static bool                  have_last      = false;
+
+// web task
+static volatile uint32_t http_requests = 0;
+static volatile uint32_t http_us       = 0;
+static volatile uint32_t http_max_us   = 0;
+static volatile uint32_t uploads       = 0;
+static volatile uint32_t parse_us      = 0;
+static volatile uint32_t parse_last_us = 0;
+static volatile uint32_t parse_max_us  = 0;
+
+// ---------------------------------------------------------------------------
+// Recording
+// ---------------------------------------------------------------------------
+
+void metrics_tx_tick(uint32_t now_us, uint32_t interval_us) {
+    if (!interval_us || !have_last) {
+        have_last    = interval_us != 0;
+        last_tick_us = now_us;
+        return;
+    }
+    uint32_t spacing = now_us - last_tick_us;
+    int32_t  error   = (int32_t)(spacing - interval_us);
+    last_tick_us = now_us;
+
+    size_t lo = 0, hi = SPACING_BOUND_COUNT;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (error <= SPACING_BOUNDS[mid])
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    // Single writer: plain stores, no read-modify-write on the sequence.
+    uint32_t seq = spacing_seq.load(std::memory_order_relaxed);
+    spacing_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    spacing_bucket[lo]++;
+    spacing_count++;
+    spacing_sum_us += error;
+    if (spacing > spacing_max_us)
+        spacing_max_us = spacing;
+    spacing_seq.store(seq + 2, std::memory_order_release);
+}
+
+void metrics_tx_reset() {
+    spacing_seq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memset(spacing_bucket, 0, sizeof(spacing_bucket));
+    spacing_count  = 0;
+    spacing_sum_us = 0;
+    spacing_max_us = 0;
+    have_last      = false;
+    spacing_seq.fetch_add(1, std::memory_order_release);
+}
+
+void metrics_http(uint32_t us, bool request) {
+    if (request)
+        http_requests = http_requests + 1;
+    http_us = http_us + us;
+    if (us > http_max_us)
+        http_max_us = us;
+}
+
+void metrics_parse(uint32_t us) {
+    uploads       = uploads + 1;
+    parse_us      = parse_us + us;
+    parse_last_us = us;
+    if (us > parse_max_us)
+        parse_max_us = us;
+}
+
+void metrics_read(Metrics* m) {
+    uint32_t seq;
+    do {
+        while ((seq = spacing_seq.load(std::memory_order_acquire)) & 1)
+            yield();
+        memcpy(m->spacing_bucket, spacing_bucket, sizeof(spacing_bucket));
+        m->spacing_count  = spacing_count;
+        m->spacing_sum_us = spacing_sum_us;
+        m->spacing_max_us = spacing_max_us;
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while (spacing_seq.load(std::memory_order_relaxed) != seq);
+
+    m->http_requests = http_requests;
+    m->http_us       = http_us;
+    m->http_max_us   = http_max_us;
+    m->uploads       = uploads;
+    m->parse_us      = parse_us;
+    m->parse_last_us = parse_last_us;
+    m->parse_max_us  = parse_max_us;
+
+    m->heap_free    = ESP.getFreeHeap();
+    m->heap_min     = ESP.getMinFreeHeap();
+    m->heap_largest = ESP.getMaxAllocHeap();
+}
+
+// ---------------------------------------------------------------------------
+// Formatting
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// snprintf into a fixed buffer, remembering whether anything was cut off.
+struct Out {
+    char*  p;
+    size_t cap;
+    size_t len;
+    bool   full;
+
+    void add(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        if (full)
+            return;
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(p + len, cap - len, fmt, ap);
+        va_end(ap);
+        if (n < 0 || (size_t)n >= cap - len)
+            full = true;
+        else
+            len += (size_t)n;
+    }
+
+    // Microseconds as seconds, without floating point.
+    void seconds(int64_t us) {
+        uint64_t mag = (uint64_t)(us < 0 ? -us : us);
+        add("%s%llu.%06llu", us < 0 ? "-" : "",
+            (unsigned long long)(mag / 1000000), (unsigned long long)(mag % 1000000));
+    }
+
+    void metric(const char* name, const char* type, const char* help) {
+        add("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    }
+
+    void counter(const char* name, const char* help, uint32_t v) {
+        metric(name, "counter", help);
+        add("%s %u\n", name, (unsigned)v);
+    }
+
+    void gauge(const char* name, const char* help, uint32_t v) {
+        metric(name, "gauge", help);
+        add("%s %u\n", name, (unsigned)v);
+    }
+
+    void gauge_s(const char* name, const char* help, int64_t us) {
+        metric(name, "gauge", help);
+        add("%s ", name);
+        seconds(us);
+        add("\n");
+    }
+
+    void counter_s(const char* name, const char* help, int64_t us) {
+        metric(name, "counter", help);
+        add("%s ", name);
+        seconds(us);
+        add("\n");
+    }
+
+    size_t done() { return full ? 0 : len; }
+};
+
+}  // namespace
+
+size_t metrics_prometheus(const Metrics& m, char* out, size_t cap) {
+    Out o = { out, cap, 0, cap == 0 };
+    if (cap)
+        out[0] = 0;
+
+    o.gauge_s("nmea_uptime_seconds", "Time since boot.", (int64_t)m.uptime_ms * 1000);
+    o.counter("nmea_sentences_total", "Sentences queued for the UART.", m.sentences);
+    o.counter("nmea_bytes_total", "Bytes queued for the UART.", m.bytes);
+    o.counter("nmea_dropped_total", "Sentences dropped because the UART ring was full.",
+              m.dropped);
+    o.counter("nmea_deferred_total", "Sentences sent a tick late because the line was full.",
+              m.deferred);
+    o.counter("nmea_missed_ticks_total", "TX timer periods the TX task missed.", m.missed);
+    o.counter("nmea_sequence_wraps_total", "Times the heading sequence wrapped.", m.wraps);
+
+    const char* h = "nmea_tx_spacing_error_seconds";
+    o.metric(h, "histogram", "Time between sentence ticks minus the TX interval.");
+    uint32_t cumulative = 0;
+    for (size_t i = 0; i < SPACING_BOUND_COUNT; i++) {
+        cumulative += m.spacing_bucket[i];
+        o.add("%s_bucket{le=\"", h);
+        o.seconds(SPACING_BOUNDS[i]);
+        o.add("\"} %u\n", (unsigned)cumulative);
+    }
+    o.add("%s_bucket{le=\"+Inf\"} %u\n", h, (unsigned)m.spacing_count);
+    o.add("%s_sum ", h);
+    o.seconds(m.spacing_sum_us);
+    o.add("\n%s_count %u\n", h, (unsigned)m.spacing_count);
+    o.gauge_s("nmea_tx_spacing_max_seconds", "Longest time between two sentence ticks.",
+              m.spacing_max_us);
+
+    o.counter("nmea_http_requests_total", "HTTP requests handled.", m.http_requests);
+    o.counter_s("nmea_http_handler_seconds_total",
+                "Time spent in HTTP request and body handlers.", m.http_us);
+    o.gauge_s("nmea_http_handler_max_seconds", "Longest single HTTP handler call.",
+              m.http_max_us);
+
+    o.counter("nmea_uploads_total", "Uploads parsed, accepted or not.", m.uploads);
+    o.counter_s("nmea_upload_parse_seconds_total", "Time spent parsing uploads.", m.parse_us);
+    o.gauge_s("nmea_upload_parse_last_seconds", "Parse time of the last upload.",
+              m.parse_last_us);
+    o.gauge_s("nmea_upload_parse_max_seconds", "Longest upload parse.", m.parse_max_us);
+
+    o.gauge("nmea_heap_free_bytes", "Free heap.", m.heap_free);
+    o.gauge("nmea_heap_min_free_bytes", "Least free heap since boot.", m.heap_min);
+    o.gauge("nmea_heap_largest_free_block_bytes", "Largest block that can be allocated.",
+            m.heap_largest);
+    return o.done();
+}
+
+size_t metrics_json(const Metrics& m, char* out, size_t cap) {
+    Out o = { out, cap, 0, cap == 0 };
+    if (cap)
+        out[0] = 0;
+
+    o.add("{\"uptime_ms\":%u,\"sentences\":%u,\"bytes\":%u,\"dropped\":%u,"
+          "\"deferred\":%u,\"missed_ticks\":%u,\"wraps\":%u,",
+          (unsigned)m.uptime_ms, (unsigned)m.sentences, (unsigned)m.bytes,
+          (unsigned)m.dropped, (unsigned)m.deferred, (unsigned)m.missed, (unsigned)m.wraps);
+
+    o.add("\"tx_spacing\":{\"bounds_us\":[");
+    for (size_t i = 0; i < SPACING_BOUND_COUNT; i++)
+        o.add("%s%d", i ? "," : "", (int)SPACING_BOUNDS[i]);
+    o.add("],\"buckets\":[");
+    for (size_t i = 0; i < METRICS_SPACING_BUCKETS; i++)
+        o.add("%s%u", i ? "," : "", (unsigned)m.spacing_bucket[i]);
+    o.add("],\"count\":%u,\"sum_us\":%lld,\"max_us\":%u},",
+          (unsigned)m.spacing_count, (long long)m.spacing_sum_us, (unsigned)m.spacing_max_us);
+
+    o.add("\"http\":{\"requests\":%u,\"handler_us\":%u,\"handler_max_us\":%u},",
+          (unsigned)m.http_requests, (unsigned)m.http_us, (unsigned)m.http_max_us);
+    o.add("\"upload\":{\"parsed\":%u,\"parse_us\":%u,\"parse_last_us\":%u,"
+          "\"parse_max_us\":%u},",
+          (unsigned)m.uploads, (unsigned)m.parse_us, (unsigned)m.parse_last_us,
+          (unsigned)m.parse_max_us);
+    o.add("\"heap\":{\"free\":%u,\"min_free\":%u,\"largest_block\":%u}}\n",
+          (unsigned)m.heap_free, (unsigned)m.heap_min, (unsigned)m.heap_largest);
+    return o.done();
+}
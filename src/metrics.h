@@ -0,0 +1,89 @@
+#pragma once
+
+/*
+ * metrics.h
+ *
+ * Run-time counters for /metrics, in Prometheus text format or JSON.
+ *
+ * Most of what is reported is already counted where it happens (uart_tx.h,
+ * talker.h, log_player.h) and only gathered here when /metrics is read.
+ * This module adds what nothing else measures:
+ *
+ *   TX spacing   histogram of the time between two sentence ticks minus
+ *                the TX interval, in microseconds: one micros() and a
+ *                binary search over METRICS_SPACING_BOUNDS per tick
+ *   HTTP         time spent in request and body handlers (the async_tcp
+ *                task), total and longest
+ *   parse        time spent parsing each upload (/update, /keys), summed
+ *                over its body chunks, so network waits are not included
+ *   heap         free heap, its low-water mark and the largest free block,
+ *                read when /metrics is
+ *
+ * Each counter has one writer.  The spacing histogram is written by the TX
+ * task and copied by metrics_read() while its count stays the same, so a
+ * snapshot is never torn by a tick.
+ */
+
+#include <Arduino.h>
+
+// Upper bounds of the spacing histogram buckets, microseconds from the TX
+// interval (negative: early).  A further bucket takes everything later.
+#define METRICS_SPACING_BOUNDS \
+    -10000, -5000, -2000, -1000, -500, -200, -100, -50, \
+        50, 100, 200, 500, 1000, 2000, 5000, 10000
+#define METRICS_SPACING_BUCKETS  17
+
+struct Metrics {
+    // filled by the caller from the other modules
+    uint32_t uptime_ms;
+    uint32_t sentences;           // sentences queued for the UART
+    uint32_t bytes;               // bytes queued for the UART
+    uint32_t dropped;             // UART ring full
+    uint32_t deferred;            // line budget full, sent a tick later
+    uint32_t missed;              // TX timer periods missed
+    uint32_t wraps;               // sequence wraps
+
+    // filled by metrics_read()
+    uint32_t spacing_bucket[METRICS_SPACING_BUCKETS];   // not cumulative
+    uint32_t spacing_count;
+    int64_t  spacing_sum_us;
+    uint32_t spacing_max_us;      // longest spacing itself
+    uint32_t http_requests;
+    uint32_t http_us;             // handlers and body chunks
+    uint32_t http_max_us;         // longest single call
+    uint32_t uploads;             // uploads parsed, accepted or not
+    uint32_t parse_us;
+    uint32_t parse_last_us;
+    uint32_t parse_max_us;
+    uint32_t heap_free;
+    uint32_t heap_min;
+    uint32_t heap_largest;
+};
+
+// --- TX task ---
+
+// A sentence tick at `now_us`, due `interval_us` after the previous one.
+// `interval_us` = 0 (while a log plays) starts over, so the next tick is
+// not measured.
+void metrics_tx_tick(uint32_t now_us, uint32_t interval_us);
+
+// Empty the histogram (nmea_bench.h measures metrics_tx_tick()).
+void metrics_tx_reset();
+
+// --- web task ---
+
+// A request or body handler took `us`; `request` false for a body chunk.
+void metrics_http(uint32_t us, bool request);
+
+// An upload was parsed in `us` of handler time.
+void metrics_parse(uint32_t us);
+
+// --- any task ---
+
+// Add this module's figures and the heap to `m`.
+void metrics_read(Metrics* m);
+
+// Format `m` into `out` (at most `cap` bytes, NUL-terminated).  Returns
+// the length, or 0 if it did not fit.
+size_t metrics_prometheus(const Metrics& m, char* out, size_t cap);
+size_t metrics_json(const Metrics& m, char* out, size_t cap);
@@ -0,0 +1,320 @@
+/*
+ * net_stream.cpp
+ *
+ * NMEA over Wi-Fi — see net_stream.h.
+ *
+ * The socket code is plain BSD sockets, which lwIP provides on the ESP32,
+ * so the same code runs in the host build.  Only the task and its wake-up
+ * differ: a FreeRTOS task notified by the TX task on the ESP32, a thread
+ * and a condition variable on the host.
+ */
+
+#include "net_stream.h"
+#include <Preferences.h>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <lwip/sockets.h>
+#else
+#include <arpa/inet.h>
+#include <condition_variable>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#endif
+
+// Below async_tcp (3): serving NMEA clients is the least urgent network work.
+#ifndef NET_TASK_PRIORITY
+#define NET_TASK_PRIORITY  2
+#endif
+#define NET_TASK_STACK     3072
+
+// Longest UDP datagram; a larger backlog is skipped rather than split.
+#define NET_UDP_MAX        1472
+
+static_assert((NET_RING & (NET_RING - 1)) == 0, "NET_RING must be a power of two");
+
+// Written by the TX task: claim_, then the bytes, then head_ (release).
+// claim_ runs ahead of head_ while a burst is being copied in, so a reader
+// that checks it after taking bytes out knows whether they were intact.
+static char                  ring[NET_RING];
+static std::atomic<uint32_t> head_{0};
+static std::atomic<uint32_t> claim_{0};
+static std::atomic<bool>     running{false};
+
+// nmea_net task only
+struct Client {
+    int      fd;
+    uint32_t pos;            // next ring position to send
+};
+static Client      clients[NET_MAX_CLIENTS];
+static int         client_count = 0;
+static int         listen_fd    = -1;
+static int         udp_fd       = -1;
+static uint32_t    udp_pos      = 0;
+static sockaddr_in udp_to       = {};
+static char        udp_buf[NET_UDP_MAX];
+
+static std::atomic<bool> udp_on{false};
+static volatile NetStreamStats stats = {};
+
+// ---------------------------------------------------------------------------
+// Task and wake-up
+// ---------------------------------------------------------------------------
+
+#ifdef ARDUINO_ARCH_ESP32
+
+static TaskHandle_t net_handle = nullptr;
+
+static void wake() {
+    if (net_handle)
+        xTaskNotifyGive(net_handle);
+}
+
+static void wait_for_data(uint32_t ms) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms));
+}
+
+#else
+
+// The TX thread never takes wake_lock; a notify that slips in between the
+// flag test and the wait is caught by the timeout.
+static std::mutex              wake_lock;
+static std::condition_variable wake_cv;
+static std::atomic<bool>       wake_flag{false};
+
+static void wake() {
+    wake_flag.store(true, std::memory_order_release);
+    wake_cv.notify_one();
+}
+
+static void wait_for_data(uint32_t ms) {
+    std::unique_lock<std::mutex> g(wake_lock);
+    wake_cv.wait_for(g, std::chrono::milliseconds(ms), [] { return wake_flag.load(); });
+    wake_flag.store(false, std::memory_order_relaxed);
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// TX task side
+// ---------------------------------------------------------------------------
+
+void net_stream_write(const char* data, size_t len) {
+    if (!running.load(std::memory_order_relaxed) || !len)
+        return;
+
+    uint32_t h   = head_.load(std::memory_order_relaxed);
+    size_t   off = h & (NET_RING - 1);
+    size_t   n1  = len < NET_RING - off ? len : NET_RING - off;
+    claim_.store(h + (uint32_t)len, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(ring + off, data, n1);
+    memcpy(ring, data + n1, len - n1);
+    head_.store(h + (uint32_t)len, std::memory_order_release);
+    wake();
+}
+
+// ---------------------------------------------------------------------------
+// nmea_net task
+// ---------------------------------------------------------------------------
+
+// True once the TX task may have overwritten ring position `pos`, i.e.
+// the writer has lapped a reader there.  Call after taking the bytes out.
+static bool lapped(uint32_t pos) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return claim_.load(std::memory_order_relaxed) - pos > NET_RING;
+}
+
+static void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static void drop_client(int i) {
+    close(clients[i].fd);
+    clients[i] = clients[--client_count];
+    stats.clients = client_count;
+}
+
+static void accept_clients() {
+    int fd;
+    while ((fd = accept(listen_fd, nullptr, nullptr)) >= 0) {
+        if (client_count >= NET_MAX_CLIENTS) {
+            close(fd);
+            stats.refused = stats.refused + 1;
+            continue;
+        }
+        set_nonblocking(fd);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifndef ARDUINO_ARCH_ESP32
+        // lwIP's send buffer is a few kB (TCP_SND_BUF); match it so a
+        // stalled client fills up as soon as it would on the board.
+        int sndbuf = 5744;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+#endif
+        clients[client_count++] = { fd, head_.load(std::memory_order_acquire) };
+        stats.clients  = client_count;
+        stats.accepted = stats.accepted + 1;
+    }
+}
+
+// Send client i what it has not had yet, straight from the ring.  False if
+// it had to be dropped.
+static bool serve_client(int i, uint32_t h) {
+    Client& c = clients[i];
+    while (c.pos != h) {
+        uint32_t lag = h - c.pos;
+        if (lag > NET_CLIENT_LAG_MAX || lapped(c.pos)) {
+            stats.dropped_slow = stats.dropped_slow + 1;
+            drop_client(i);
+            return false;
+        }
+        size_t off = c.pos & (NET_RING - 1);
+        size_t n   = lag < NET_RING - off ? lag : NET_RING - off;
+        ssize_t sent = send(c.fd, ring + off, n, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;             // window full: retry on the next pass
+            drop_client(i);              // reset or closed
+            return false;
+        }
+        // send() has copied the bytes; if the TX task got to them first
+        // the client already has a corrupt sentence and cannot be resynced.
+        if (lapped(c.pos)) {
+            stats.dropped_slow = stats.dropped_slow + 1;
+            drop_client(i);
+            return false;
+        }
+        c.pos += (uint32_t)sent;
+        stats.bytes_sent = stats.bytes_sent + (uint32_t)sent;
+    }
+    return true;
+}
+
+// Clients are not expected to talk; read and discard, and notice EOF.
+static bool poll_client_input(int i) {
+    char    buf[64];
+    ssize_t n;
+    while ((n = recv(clients[i].fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {}
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        drop_client(i);
+        return false;
+    }
+    return true;
+}
+
+// One datagram per pass with everything new, copied out of the ring first
+// so that a burst written meanwhile cannot garble it.
+static void send_udp(uint32_t h) {
+    uint32_t len = h - udp_pos;
+    if (!len)
+        return;
+    if (!udp_on.load(std::memory_order_relaxed) || udp_fd < 0 || len > NET_UDP_MAX) {
+        udp_pos = h;
+        return;
+    }
+    size_t off = udp_pos & (NET_RING - 1);
+    size_t n1  = len < NET_RING - off ? len : NET_RING - off;
+    memcpy(udp_buf, ring + off, n1);
+    memcpy(udp_buf + n1, ring, len - n1);
+    if (lapped(udp_pos) || sendto(udp_fd, udp_buf, len, MSG_DONTWAIT,
+                                  (sockaddr*)&udp_to, sizeof(udp_to)) < 0)
+        stats.udp_errors = stats.udp_errors + 1;
+    else
+        stats.udp_datagrams = stats.udp_datagrams + 1;
+    udp_pos = h;
+}
+
+static void net_pass() {
+    accept_clients();
+
+    uint32_t h = head_.load(std::memory_order_acquire);
+    for (int i = 0; i < client_count; ) {
+        if (poll_client_input(i) && serve_client(i, h))
+            i++;
+    }
+    send_udp(h);
+}
+
+static void net_task(void*) {
+    for (;;) {
+        // Woken by each burst; the timeout picks up new connections and
+        // retries clients whose window was full.
+        wait_for_data(50);
+        net_pass();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Setup
+// ---------------------------------------------------------------------------
+
+void net_stream_begin(IPAddress broadcast) {
+    Preferences prefs;
+    prefs.begin("nmea", true);
+    udp_on = prefs.getBool("udp", false);
+    prefs.end();
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(NET_TCP_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 2) < 0) {
+        Serial.printf("Warning: NMEA TCP port %d unavailable\n", NET_TCP_PORT);
+        close(listen_fd);
+        listen_fd = -1;
+        return;
+    }
+    set_nonblocking(listen_fd);
+
+    udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    setsockopt(udp_fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+    udp_to.sin_family      = AF_INET;
+    udp_to.sin_port        = htons(NET_UDP_PORT);
+    udp_to.sin_addr.s_addr = htonl((uint32_t)broadcast[0] << 24 | (uint32_t)broadcast[1] << 16
+                                   | (uint32_t)broadcast[2] << 8 | broadcast[3]);
+
+    udp_pos = head_.load(std::memory_order_relaxed);
+    running = true;
+#ifdef ARDUINO_ARCH_ESP32
+    xTaskCreate(net_task, "nmea_net", NET_TASK_STACK, nullptr, NET_TASK_PRIORITY, &net_handle);
+#else
+    std::thread(net_task, nullptr).detach();
+#endif
+    stats.udp = udp_on;
+}
+
+void net_stream_set_udp(bool on) {
+    if (on == udp_on.load())
+        return;
+    udp_on = on;
+    stats.udp = on;
+    Preferences prefs;
+    prefs.begin("nmea", false);
+    prefs.putBool("udp", on);
+    prefs.end();
+}
+
+NetStreamStats net_stream_stats() {
+    NetStreamStats s;
+    s.clients       = stats.clients;
+    s.accepted      = stats.accepted;
+    s.refused       = stats.refused;
+    s.dropped_slow  = stats.dropped_slow;
+    s.bytes_sent    = stats.bytes_sent;
+    s.udp_datagrams = stats.udp_datagrams;
+    s.udp_errors    = stats.udp_errors;
+    s.udp           = stats.udp;
+    return s;
+}
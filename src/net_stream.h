@@ -0,0 +1,72 @@
+#pragma once
+
+/*
+ * net_stream.h
+ *
+ * NMEA over Wi-Fi: the exact byte stream handed to the UART is also served
+ * to TCP clients on port 10110 (the usual NMEA-0183 port, e.g. for OpenCPN)
+ * and, when enabled, sent as UDP broadcast on the AP subnet.
+ *
+ * The TX task only copies each burst into a byte ring and bumps an atomic
+ * write position (net_stream_write(), installed as the uart_tx tap), then
+ * wakes the nmea_net task.  That task runs below async_tcp and does all
+ * socket work with non-blocking calls: every client keeps its own read
+ * position in the ring and is sent straight from it, so a sentence is
+ * encoded once and never copied per client.
+ *
+ * A client whose unsent backlog in the ring exceeds NET_CLIENT_LAG_MAX
+ * (its TCP window is full and it is not reading) is disconnected and
+ * counted as dropped; it never holds up the UART or the other clients.
+ * So is one the TX task lapped while its bytes were being sent, before
+ * the next pass could see the backlog.
+ * New clients start at the next burst.  The UDP setting is kept in NVS
+ * (Preferences namespace "nmea", key "udp").
+ */
+
+#include <Arduino.h>
+
+#ifndef NET_TCP_PORT
+#define NET_TCP_PORT        10110
+#endif
+#ifndef NET_UDP_PORT
+#define NET_UDP_PORT        10110
+#endif
+#ifndef NET_MAX_CLIENTS
+#define NET_MAX_CLIENTS     4
+#endif
+
+// Byte ring shared with the TX task; a power of two.
+#ifndef NET_RING
+#define NET_RING            4096
+#endif
+
+// Backlog at which a client is dropped; must leave the TX task room to
+// write without reaching the bytes being sent.
+#ifndef NET_CLIENT_LAG_MAX
+#define NET_CLIENT_LAG_MAX  (NET_RING / 2)
+#endif
+
+struct NetStreamStats {
+    uint32_t clients;          // connected now
+    uint32_t accepted;         // since boot
+    uint32_t refused;          // over NET_MAX_CLIENTS
+    uint32_t dropped_slow;     // disconnected for lagging
+    uint32_t bytes_sent;       // TCP, all clients
+    uint32_t udp_datagrams;
+    uint32_t udp_errors;
+    bool     udp;
+};
+
+// Open the listening socket and start the nmea_net task.  `broadcast` is
+// the AP subnet broadcast address for UDP.
+void net_stream_begin(IPAddress broadcast);
+
+// --- TX task (uart_tx tap) ---
+
+// Publish bytes just handed to the UART.  Never blocks.
+void net_stream_write(const char* data, size_t len);
+
+// --- any task ---
+
+void           net_stream_set_udp(bool on);     // also stored in NVS
+NetStreamStats net_stream_stats();
@@ -0,0 +1,94 @@
+/*
+ * nmea.cpp
+ *
+ * NMEA 0183 sentence formatting — see nmea.h.
+ */
+
+#include "nmea.h"
+
+bool nmea_tenths(float v, uint32_t* tenths)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    int32_t  exp  = (int32_t)((bits >> 23) & 0xFF);
+    uint64_t mant = bits & 0x7FFFFF;
+    if (exp >= 127 + 24)                  // >= 2^24, infinity or NaN
+        return false;
+    if (exp)
+        mant |= 0x800000;                 // normal: implicit leading 1
+    else
+        exp = 1;                          // subnormal
+
+    // |v| * 10 = mant * 10 * 2^shift
+    uint64_t t     = mant * 10;
+    int32_t  shift = exp - 127 - 23;
+    if (shift >= 0) {
+        t <<= shift;
+    } else if (shift <= -40) {
+        t = 0;                            // below 2^-16: rounds to 0.0
+    } else {
+        uint64_t rem  = t & ((1ULL << -shift) - 1);
+        uint64_t half = 1ULL << (-shift - 1);
+        t >>= -shift;
+        if (rem > half || (rem == half && (t & 1)))
+            t++;
+    }
+    if (t >= 10000000)                    // 1e6 and up
+        return false;
+    *tenths = (uint32_t)t;
+    return true;
+}
+
+size_t makeTHS(int16_t deci, char* out)
+{
+    uint8_t cs = 0;
+    char*   p  = nmea_put_text(out, "$HETHS,", cs);
+    p = nmea_put_deci(p, deci, cs);
+    p = nmea_put_text(p, ",A", cs);
+    return nmea_finish(out, p, cs);
+}
+
+size_t makeHDG(int16_t deci, char* out)
+{
+    uint8_t cs = 0;
+    char*   p  = nmea_put_text(out, "$HEHDG,", cs);
+    p = nmea_put_deci(p, deci, cs);
+    p = nmea_put_text(p, ",,,,", cs);
+    return nmea_finish(out, p, cs);
+}
+
+size_t makeROT(int32_t deci_per_min, char* out)
+{
+    if (deci_per_min >  99999) deci_per_min =  99999;
+    if (deci_per_min < -99999) deci_per_min = -99999;
+
+    uint8_t cs = 0;
+    char*   p  = nmea_put_text(out, "$HEROT,", cs);
+    p = nmea_put_deci(p, deci_per_min, cs);
+    p = nmea_put_text(p, ",A", cs);
+    return nmea_finish(out, p, cs);
+}
+
+static uint8_t hex_value(char c)
+{
+    return (uint8_t)(c <= '9' ? c - '0' : c - 'A' + 10);
+}
+
+void nmea_set_talker(char* data, size_t len, const char* id)
+{
+    char* end = data + len;
+    while (data < end) {
+        char* nl   = (char*)memchr(data, '\n', end - data);
+        char* next = nl ? nl + 1 : end;
+        char* star = (char*)memchr(data, '*', next - data);
+        if (data[0] == '$' && star && star + 2 < next && star - data > 3) {
+            uint8_t cs = (uint8_t)(hex_value(star[1]) << 4 | hex_value(star[2]));
+            cs ^= (uint8_t)(data[1] ^ data[2] ^ id[0] ^ id[1]);
+            data[1] = id[0];
+            data[2] = id[1];
+            star[1] = NMEA_HEX_DIGITS[cs >> 4];
+            star[2] = NMEA_HEX_DIGITS[cs & 0x0F];
+        }
+        data = next;
+    }
+}
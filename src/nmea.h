@@ -0,0 +1,130 @@
+#pragma once
+
+/*
+ * nmea.h
+ *
+ * NMEA 0183 sentence formatting.
+ *
+ * The ESP32-C3 has no FPU, so sentences are built from deci-degrees with
+ * integer arithmetic only, and the XOR checksum is accumulated while the
+ * bytes are written instead of in a second pass.  All sentence types share
+ * the same constexpr field writers, so the built-in default table
+ * (default_table.h) is produced by the very same code at compile time.
+ */
+
+#include <Arduino.h>
+
+// Longest sentence makeHDTFixed() produces, including "\r\n" and the terminator.
+#define NMEA_HDT_MAX  24
+
+// Longest sentence of any type below, including "\r\n" and the terminator.
+#define NMEA_SENTENCE_MAX  32
+
+// XOR of all characters of s — usable at compile time for fixed fields.
+constexpr uint8_t nmea_checksum(const char* s, uint8_t cs = 0) {
+    return *s ? nmea_checksum(s + 1, (uint8_t)(cs ^ (uint8_t)*s)) : cs;
+}
+
+constexpr char NMEA_HEX_DIGITS[] = "0123456789ABCDEF";
+
+// ---------------------------------------------------------------------------
+// Field writers — each appends at p, folds what it wrote into cs and
+// returns the new end.
+// ---------------------------------------------------------------------------
+
+// Fixed text, e.g. the "$HEHDT," prefix or the ",T" suffix.  A leading '$'
+// is not part of the checksum.
+constexpr char* nmea_put_text(char* p, const char* s, uint8_t& cs) {
+    for (; *s; s++) {
+        *p++ = *s;
+        if (*s != '$')
+            cs ^= (uint8_t)*s;
+    }
+    return p;
+}
+
+// Tenths as "[-]d.d" — deci 3319 -> "331.9".
+constexpr char* nmea_put_deci(char* p, int32_t deci, uint8_t& cs) {
+    uint32_t v = (uint32_t)deci;
+    if (deci < 0) {
+        *p++ = '-';
+        cs  ^= '-';
+        v    = (uint32_t)(-deci);
+    }
+
+    // Integer part, most significant digit first.
+    uint32_t whole      = v / 10;
+    char     digits[10] = {};
+    int      n          = 0;
+    do {
+        digits[n++] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole);
+    while (n) {
+        char c = digits[--n];
+        *p++ = c;
+        cs  ^= (uint8_t)c;
+    }
+
+    char tenth = (char)('0' + v % 10);
+    p[0] = '.';
+    p[1] = tenth;
+    cs  ^= (uint8_t)'.' ^ (uint8_t)tenth;
+    return p + 2;
+}
+
+// "*CS\r\n" and the terminator; returns the sentence length from `out`.
+constexpr size_t nmea_finish(char* out, char* p, uint8_t cs) {
+    p[0] = '*';
+    p[1] = NMEA_HEX_DIGITS[cs >> 4];
+    p[2] = NMEA_HEX_DIGITS[cs & 0x0F];
+    p[3] = '\r';
+    p[4] = '\n';
+    p[5] = '\0';
+    return (size_t)(p + 5 - out);
+}
+
+// ---------------------------------------------------------------------------
+// Sentences — all take deci-units and return the length excluding the
+// terminator.
+// ---------------------------------------------------------------------------
+
+// deci-degrees → "$HEHDT,xxx.x,T*CS\r\n"  (out must hold NMEA_HDT_MAX bytes)
+constexpr size_t makeHDTFixed(int16_t deci, char *out)
+{
+    uint8_t cs = 0;
+    char*   p  = nmea_put_text(out, "$HEHDT,", cs);
+    p = nmea_put_deci(p, deci, cs);
+    p = nmea_put_text(p, ",T", cs);
+    return nmea_finish(out, p, cs);
+}
+
+// "$HEHDT,-0.0,T*02\r\n": what the float formatter sent for a negative
+// heading that rounds to zero (DECI_NEG_ZERO in sequence.h).
+constexpr size_t makeHDTNegZero(char *out)
+{
+    uint8_t cs = 0;
+    char*   p  = nmea_put_text(out, "$HEHDT,-0.0,T", cs);
+    return nmea_finish(out, p, cs);
+}
+
+// |v| * 10 rounded as "%.1f" rounds it: half to even on the float's exact
+// binary value, in integer arithmetic.  False for |v| >= 1e6, infinities
+// and NaN.  The /update parser uses it for values near a tie.
+bool nmea_tenths(float v, uint32_t* tenths);
+
+// True heading and status, mode A (autonomous):  "$HETHS,xxx.x,A*CS\r\n"
+size_t makeTHS(int16_t deci, char* out);
+
+// Heading, deviation and variation, the last two left empty as on a
+// gyrocompass:  "$HEHDG,xxx.x,,,,*CS\r\n"
+size_t makeHDG(int16_t deci, char* out);
+
+// Rate of turn in deci-degrees per minute, negative = bow turns to port;
+// clamped to +/-9999.9.  Status A (valid):  "$HEROT,x.x,A*CS\r\n"
+size_t makeROT(int32_t deci_per_min, char* out);
+
+// Replace the two-character talker ID ("HE") of every sentence in `data`
+// by `id` and patch the checksums: they change by the XOR of the four
+// characters, so nothing else is read.
+void nmea_set_talker(char* data, size_t len, const char* id);
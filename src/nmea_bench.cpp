@@ -0,0 +1,237 @@
+/*
+ * nmea_bench.cpp
+ *
+ * Compares the snprintf/float makeHDT() the emulator shipped with against
+ * the integer makeHDTFixed(): cycles per sentence, and byte-for-byte output
+ * over every int16 deci-degree value.  The same for the upload path as a
+ * whole, body text through HeadingParser and SequencePlayer to the
+ * sentence, over every centi-degree value in ±360° and ties.  And the
+ * per-tick cost of keyframe interpolation and of the /metrics update.
+ * See nmea_bench.h.
+ */
+
+#ifdef NMEA_BENCH
+
+#include "nmea_bench.h"
+#include "heading_parser.h"
+#include "keyframes.h"
+#include "metrics.h"
+#include "nmea.h"
+#include "sequence.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+static inline uint32_t cycles() { return ESP.getCycleCount(); }
+static const char* const CYCLE_UNIT = "CPU cycles";
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint32_t cycles() { return (uint32_t)__rdtsc(); }
+static const char* const CYCLE_UNIT = "TSC ticks";
+#else
+#include <chrono>
+static inline uint32_t cycles() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static const char* const CYCLE_UNIT = "ns";
+#endif
+
+// The original formatter, kept verbatim as the reference.
+static void makeHDT_snprintf(float heading, char *out)
+{
+    char body[32];
+    snprintf(body, sizeof(body), "HEHDT,%.1f,T", heading);
+
+    uint8_t cs = 0;
+    for (int i = 0; body[i] != 0; i++)
+        cs ^= body[i];
+
+    char hex[3];
+    snprintf(hex, sizeof(hex), "%02X", cs);
+
+    snprintf(out, NMEA_HDT_MAX, "$%s*%s\r\n", body, hex);
+}
+
+// Keeps the optimiser from discarding the formatted output.
+static volatile uint8_t sink;
+
+// ---------------------------------------------------------------------------
+// Upload path: body text -> HeadingParser -> SequencePlayer -> sentence
+// ---------------------------------------------------------------------------
+
+static const size_t CHAIN_BATCH = 500;
+
+static char           chain_body[CHAIN_BATCH * 12];
+static HeadingBuffer  chain_buf;
+static HeadingParser  chain_parser;
+
+// "v0,v1,..." into chain_body; returns its length.
+static size_t build_body(const char* const* values, size_t n) {
+    size_t len = 0;
+    for (size_t i = 0; i < n; i++)
+        len += (size_t)snprintf(chain_body + len, sizeof(chain_body) - len, "%s%s",
+                                i ? "," : "", values[i]);
+    return len;
+}
+
+// Sends `values` as one body through the parser and SequencePlayer and
+// formats each entry as the TX task does (Talker: the preformatted
+// sentence if there is one, else makeHDTFixed()), against snprintf of the
+// value's toFloat().  Returns the mismatches and counts the values.
+static uint32_t compare_upload(const char* const* values, size_t n, uint32_t* compared) {
+    size_t len = build_body(values, n);
+    chain_parser.begin(&chain_buf);
+    chain_parser.feed(chain_body, len);
+    if (!chain_parser.finish() || chain_buf.count != n) {
+        Serial.printf("bench: upload rejected: %s\n", chain_parser.error());
+        return (uint32_t)n;
+    }
+
+    HeadingTable tbl = {};
+    tbl.deci  = chain_buf.data;
+    tbl.count = chain_buf.count;
+    SequencePlayer player;
+    player.begin(&tbl);
+
+    uint32_t mismatches = 0;
+    char     ref[NMEA_HDT_MAX];
+    char     out[NMEA_HDT_MAX];
+    for (size_t i = 0; i < n; i++) {
+        HeadingTick h = {};
+        player.next_heading(&h);
+        if (h.hdt) {
+            memcpy(out, h.hdt, h.hdt_len);
+            out[h.hdt_len] = '\0';
+        } else {
+            makeHDTFixed(h.deci, out);
+        }
+        makeHDT_snprintf((float)atof(values[i]), ref);
+        if (strcmp(ref, out) != 0 && mismatches++ < 5)
+            Serial.printf("bench: mismatch at \"%s\": %s vs %s", values[i], ref, out);
+    }
+    *compared += (uint32_t)n;
+    return mismatches;
+}
+
+void nmea_bench_run() {
+    const int REPS = 2000;
+    char      ref[NMEA_HDT_MAX];
+    char      out[NMEA_HDT_MAX];
+
+    // 1. Identical output for every representable value.
+    uint32_t compared   = 0;
+    uint32_t mismatches = 0;
+    for (int32_t d = -INT16_MAX; d <= INT16_MAX; d++, compared++) {
+        makeHDT_snprintf(d / 10.0f, ref);
+        makeHDTFixed((int16_t)d, out);
+        if (strcmp(ref, out) != 0) {
+            if (mismatches++ < 5)
+                Serial.printf("bench: mismatch at %ld: %s vs %s", (long)d, ref, out);
+        }
+    }
+    Serial.printf("bench: %lu values compared, %lu mismatches\n",
+                  (unsigned long)compared, (unsigned long)mismatches);
+
+    // 1b. The upload path end to end against the same reference.
+    uint32_t chain_compared   = 0;
+    uint32_t chain_mismatches = 0;
+    static const char* const EDGES[] = {
+        "20.25", "30.35", "-0.04", "12.25", "0.35", "-359.65", "-0", "+0",
+        "0.05", "-0.05", "331.4500001", "331.4499999", "3276.7", "-3276.7",
+    };
+    chain_mismatches += compare_upload(EDGES, sizeof(EDGES) / sizeof(EDGES[0]),
+                                       &chain_compared);
+    static char        text[CHAIN_BATCH][10];
+    static const char* batch[CHAIN_BATCH];
+    for (int32_t first = -36000; first <= 36000; first += CHAIN_BATCH) {
+        size_t n = 0;
+        for (int32_t c = first; c <= 36000 && n < CHAIN_BATCH; c++, n++) {
+            int32_t a = c < 0 ? -c : c;
+            snprintf(text[n], sizeof(text[n]), "%s%ld.%02ld", c < 0 ? "-" : "",
+                     (long)(a / 100), (long)(a % 100));
+            batch[n] = text[n];
+        }
+        chain_mismatches += compare_upload(batch, n, &chain_compared);
+    }
+    Serial.printf("bench: %lu uploaded values compared, %lu mismatches\n",
+                  (unsigned long)chain_compared, (unsigned long)chain_mismatches);
+
+    // 2. Cost per sentence over a typical heading sweep.
+    uint32_t t0 = cycles();
+    for (int i = 0; i < REPS; i++) {
+        makeHDT_snprintf((i % 3600) / 10.0f, out);
+        sink = out[9];
+    }
+    uint32_t t1 = cycles();
+    for (int i = 0; i < REPS; i++) {
+        makeHDTFixed((int16_t)(i % 3600), out);
+        sink = out[9];
+    }
+    uint32_t t2 = cycles();
+
+    Serial.printf("bench: makeHDT snprintf  %lu %s/sentence\n",
+                  (unsigned long)((t1 - t0) / REPS), CYCLE_UNIT);
+    Serial.printf("bench: makeHDTFixed      %lu %s/sentence\n",
+                  (unsigned long)((t2 - t1) / REPS), CYCLE_UNIT);
+
+    // 2b. Per uploaded value, text to sentence: toFloat() and snprintf
+    //     against HeadingParser and makeHDTFixed(), over centi-degree
+    //     values of which one in ten is a tie.
+    for (size_t i = 0; i < CHAIN_BATCH; i++) {
+        snprintf(text[i], sizeof(text[i]), "%lu.%02lu", (unsigned long)(i * 37 % 36000 / 100),
+                 (unsigned long)(i * 37 % 100));
+        batch[i] = text[i];
+    }
+    size_t len = build_body(batch, CHAIN_BATCH);
+    uint32_t u0 = cycles();
+    for (size_t i = 0; i < CHAIN_BATCH; i++) {
+        makeHDT_snprintf((float)atof(batch[i]), out);
+        sink = out[9];
+    }
+    uint32_t u1 = cycles();
+    chain_parser.begin(&chain_buf);
+    chain_parser.feed(chain_body, len);
+    chain_parser.finish();
+    for (size_t i = 0; i < chain_buf.count; i++) {
+        makeHDTFixed(chain_buf.data[i], out);
+        sink = out[9];
+    }
+    uint32_t u2 = cycles();
+
+    Serial.printf("bench: upload toFloat+snprintf %lu %s/value\n",
+                  (unsigned long)((u1 - u0) / CHAIN_BATCH), CYCLE_UNIT);
+    Serial.printf("bench: upload parser+Fixed     %lu %s/value\n",
+                  (unsigned long)((u2 - u1) / CHAIN_BATCH), CYCLE_UNIT);
+
+    // 3. Keyframe interpolation per tick: a 50 Hz track of 64 keyframes
+    //    five seconds apart, so segment changes are included at their rate.
+    static KeyframeTrack track;
+    for (int interp = KEY_LINEAR; interp <= KEY_CUBIC; interp++) {
+        track.clear();
+        for (uint32_t k = 0; k < 64; k++)
+            track.add(k * 5000, (int16_t)((k * 1370) % 3600));
+        track.configure((KeyInterp)interp, true, 20);
+        size_t   ticks = track.ticks();
+        uint32_t t3    = cycles();
+        for (size_t i = 0; i < ticks; i++)
+            sink = (uint8_t)track.next(i);
+        uint32_t t4 = cycles();
+        Serial.printf("bench: keyframes %-7s %lu %s/tick\n",
+                      interp == KEY_LINEAR ? "linear" : "cubic",
+                      (unsigned long)((t4 - t3) / ticks), CYCLE_UNIT);
+    }
+
+    // 4. The TX task's metrics update per tick (micros() not included),
+    //    with spacings spread over the histogram; cleared again afterwards.
+    uint32_t now = 0;
+    uint32_t t5  = cycles();
+    for (int i = 0; i < REPS; i++) {
+        now += 100000 + (uint32_t)((i * 7919) % 24001) - 12000;
+        metrics_tx_tick(now, 100000);
+    }
+    uint32_t t6 = cycles();
+    metrics_tx_reset();
+    Serial.printf("bench: metrics_tx_tick   %lu %s/tick\n",
+                  (unsigned long)((t6 - t5) / REPS), CYCLE_UNIT);
+}
+
+#endif  // NMEA_BENCH
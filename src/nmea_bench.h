@@ -0,0 +1,17 @@
+#pragma once
+
+/*
+ * nmea_bench.h
+ *
+ * Boot-time formatter, keyframe and metrics benchmark, compiled only with
+ * -DNMEA_BENCH:
+ *
+ *   PLATFORMIO_BUILD_FLAGS=-DNMEA_BENCH pio run -e airm2m_core_esp32c3 -t upload
+ *   PLATFORMIO_BUILD_FLAGS=-DNMEA_BENCH pio run -e native && .pio/build/native/program --duration 1
+ *
+ * Results are printed on the console Serial before the emulator starts.
+ */
+
+#ifdef NMEA_BENCH
+void nmea_bench_run();
+#endif
@@ -0,0 +1,138 @@
+/*
+ * sequence.cpp
+ *
+ * Heading storage and the double-buffered table — see sequence.h.
+ */
+
+#include "sequence.h"
+#include "nmea.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The sentence sent for DECI_NEG_ZERO, built at compile time.
+struct NegZeroHdt {
+    char   bytes[NMEA_HDT_MAX];
+    size_t len;
+};
+
+static constexpr NegZeroHdt build_neg_zero() {
+    NegZeroHdt s = {};
+    s.len = makeHDTNegZero(s.bytes);
+    return s;
+}
+
+static constexpr NegZeroHdt HDT_NEG_ZERO = build_neg_zero();
+
+bool HeadingBuffer::push(int16_t deci) {
+    if (count == capacity) {
+        if (capacity >= SEQ_MAX_ENTRIES) return false;
+        size_t want = capacity ? capacity * 2 : 128;
+        if (want > SEQ_MAX_ENTRIES) want = SEQ_MAX_ENTRIES;
+        int16_t* p = (int16_t*)realloc(data, want * sizeof(int16_t));
+        if (!p) return false;
+        data     = p;
+        capacity = want;
+    }
+    data[count++] = deci;
+    return true;
+}
+
+bool HeadingBuffer::reserve(size_t n) {
+    if (n > SEQ_MAX_ENTRIES) return false;
+    if (n <= capacity) return true;
+    int16_t* p = (int16_t*)realloc(data, n * sizeof(int16_t));
+    if (!p) return false;
+    data     = p;
+    capacity = n;
+    return true;
+}
+
+bool HeadingBuffer::append(const void* src, size_t n) {
+    if (n > capacity - count) return false;
+    memcpy(data + count, src, n * sizeof(int16_t));
+    count += n;
+    return true;
+}
+
+void HeadingBuffer::shrink() {
+    if (count == 0 || count == capacity) return;
+    int16_t* p = (int16_t*)realloc(data, count * sizeof(int16_t));
+    if (p) {
+        data     = p;
+        capacity = count;
+    }
+}
+
+void HeadingBuffer::release() {
+    free(data);
+    data     = nullptr;
+    count    = 0;
+    capacity = 0;
+}
+
+void SequencePlayer::begin(const HeadingTable* initial) {
+    index_ = 0;
+    pending_.store(nullptr, std::memory_order_relaxed);
+    active_.store(initial, std::memory_order_release);
+}
+
+void SequencePlayer::publish(const HeadingTable* next) {
+    pending_.store(next, std::memory_order_release);
+}
+
+const HeadingTable* SequencePlayer::retract() {
+    return pending_.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+bool SequencePlayer::swap_due(const HeadingTable* next) const {
+    switch (next->swap) {
+    case SWAP_NOW:
+        return true;
+    case SWAP_AT:
+        // An index past the end of the current table is never reached;
+        // fall back to the wrap point.
+        if (next->swap_at < active_.load(std::memory_order_relaxed)->count)
+            return index_ == next->swap_at;
+        return index_ == 0;
+    case SWAP_WRAP:
+    default:
+        return index_ == 0;
+    }
+}
+
+void SequencePlayer::next_heading(HeadingTick* out) {
+    const HeadingTable* next = pending_.load(std::memory_order_acquire);
+    out->swapped = false;
+    if (next && swap_due(next)) {
+        // Claim it; loses only if the web task retracted it just now.
+        if (pending_.compare_exchange_strong(next, nullptr, std::memory_order_acq_rel)) {
+            active_.store(next, std::memory_order_release);
+            index_       = 0;
+            out->swapped = true;
+        }
+    }
+
+    const HeadingTable* tbl = active_.load(std::memory_order_relaxed);
+    out->hdt     = nullptr;
+    out->hdt_len = 0;
+    if (tbl->wave) {
+        out->deci = tbl->wave->next(index_);
+    } else if (tbl->keys) {
+        out->deci = tbl->keys->next(index_);
+    } else {
+        out->deci = tbl->deci[index_];
+        if (tbl->image) {
+            out->hdt     = tbl->image + index_ * tbl->stride;
+            out->hdt_len = tbl->stride;
+        } else if (out->deci == DECI_NEG_ZERO) {
+            out->deci    = 0;
+            out->hdt     = HDT_NEG_ZERO.bytes;
+            out->hdt_len = HDT_NEG_ZERO.len;
+        }
+    }
+    out->index   = index_;
+
+    out->wrapped = (++index_ >= tbl->count);
+    if (out->wrapped)
+        index_ = 0;
+}
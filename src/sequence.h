@@ -0,0 +1,137 @@
+#pragma once
+
+/*
+ * sequence.h
+ *
+ * Heading sequences and the double-buffered table shared between the web
+ * task (writer) and the TX task (reader).
+ *
+ * Uploaded headings are stored as int16 deci-degrees (331.9° -> 3319) in a
+ * HeadingBuffer that grows on demand, and each sentence is formatted only
+ * when it is sent.  Two bytes per entry instead of a 20-byte string plus a
+ * pointer, so a sequence can run to SEQ_MAX_ENTRIES (an hour at 10 Hz by
+ * default) and a short one costs only what it uses.
+ *
+ * The TX task only ever reads the active table.  The web task fills a
+ * spare table and publishes it with one atomic pointer store; the TX task
+ * adopts it at the point chosen by the table's swap policy:
+ *
+ *   SWAP_NOW    on the very next tick, starting from entry 0
+ *   SWAP_WRAP   when the current table wraps back to entry 0 (default)
+ *   SWAP_AT     when the current table is about to send entry `swap_at`;
+ *               the new table starts from its entry 0
+ *
+ * Until it is adopted, a published table can be withdrawn again with
+ * retract(), so a second upload never has to wait for a slow swap point.
+ * Old and new entries are never mixed: a table is not written while it is
+ * active or pending.
+ */
+
+#include <Arduino.h>
+#include <atomic>
+#include "keyframes.h"
+#include "waveform.h"
+
+#ifndef SEQ_MAX_ENTRIES
+#define SEQ_MAX_ENTRIES  36000
+#endif
+
+enum SwapPolicy : uint8_t {
+    SWAP_NOW = 0,
+    SWAP_WRAP,
+    SWAP_AT,
+};
+
+// Stored for an uploaded value with a minus sign that rounds to 0.0, such
+// as "-0.04": the original float formatter sent those as "-0.0".  It is
+// the one int16 that is never a heading (the binary upload marker);
+// next_heading() hands it on as 0 with the "-0.0" HDT sentence.
+constexpr int16_t DECI_NEG_ZERO = INT16_MIN;
+
+// Growable array of deci-degree headings (web task only).
+struct HeadingBuffer {
+    int16_t* data     = nullptr;
+    size_t   count    = 0;
+    size_t   capacity = 0;
+
+    void clear() { count = 0; }
+
+    // Append one value, growing the allocation geometrically.  False when
+    // SEQ_MAX_ENTRIES is reached or the heap is exhausted.
+    bool push(int16_t deci);
+
+    // Make room for `n` entries in all, in one allocation.  False over
+    // SEQ_MAX_ENTRIES or when the heap is exhausted.
+    bool reserve(size_t n);
+
+    // Append `n` int16 values in host byte order from `src`, which need
+    // not be aligned.  Room must have been reserved.
+    bool append(const void* src, size_t n);
+
+    // Give back unused capacity once the final size is known.
+    void shrink();
+
+    // Give back all of it.
+    void release();
+};
+
+// What the TX task transmits, one of:
+//   deci    uploaded deci-degree headings, formatted on the fly
+//   image   `count` preformatted $HEHDT sentences `stride` bytes apart
+//           (the built-in default table), with `deci` alongside
+//   wave    a generator producing each heading on demand (waveform.h)
+//   keys    keyframes interpolated on demand (keyframes.h)
+struct HeadingTable {
+    const int16_t*     deci;
+    const char*        image;
+    size_t             stride;
+    WaveGenerator*     wave;
+    KeyframeTrack*     keys;
+    size_t             count;
+    SwapPolicy         swap;
+    size_t             swap_at;     // SWAP_AT only
+};
+
+// One step of the heading stream.
+struct HeadingTick {
+    int16_t     deci;        // heading for this tick
+    const char* hdt;         // its preformatted $HEHDT sentence, or nullptr
+    size_t      hdt_len;
+    size_t      index;       // its entry in the table
+    bool        wrapped;     // the table cycled back to entry 0
+    bool        swapped;     // a new table was adopted for this tick
+};
+
+class SequencePlayer {
+public:
+    // Start transmitting `initial` (before the TX task runs).
+    void begin(const HeadingTable* initial);
+
+    // --- web task ---
+
+    // Hand `next` to the TX task.  Any table still pending is replaced.
+    void publish(const HeadingTable* next);
+
+    // Withdraw the pending table if the TX task has not adopted it yet.
+    // Returns it (now free to rewrite), or nullptr.
+    const HeadingTable* retract();
+
+    const HeadingTable* active() const { return active_.load(std::memory_order_acquire); }
+    bool                pending() const { return pending_.load(std::memory_order_acquire) != nullptr; }
+    const HeadingTable* queued() const { return pending_.load(std::memory_order_acquire); }
+
+    // --- TX task ---
+
+    // Heading for this tick.  Applies a due swap first and advances the
+    // index.
+    void next_heading(HeadingTick* out);
+
+    size_t index() const { return index_; }
+
+private:
+    bool swap_due(const HeadingTable* next) const;
+
+    std::atomic<const HeadingTable*> active_{nullptr};
+    std::atomic<const HeadingTable*> pending_{nullptr};
+    size_t                           index_ = 0;     // TX task only
+};
@@ -0,0 +1,168 @@
+/*
+ * slots.cpp
+ *
+ * Sequence slots on LittleFS — see slots.h.
+ */
+
+#include "slots.h"
+#include <Preferences.h>
+
+#define SLOT_DIR    "/slots"
+#define SLOT_MAGIC  0x31515348u             // "HSQ1" little-endian
+
+struct SlotHeader {
+    uint32_t magic;
+    uint32_t count;
+    uint32_t reserved[2];
+};
+static_assert(sizeof(SlotHeader) == 16, "slot header layout");
+
+static bool mounted = false;
+
+static void slot_path(const char* name, const char* ext, char* out, size_t len) {
+    snprintf(out, len, SLOT_DIR "/%s%s", name, ext);
+}
+
+bool slots_begin() {
+    mounted = LittleFS.begin(true);
+    if (!mounted) {
+        Serial.println("Warning: no LittleFS partition, sequence slots unavailable");
+        return false;
+    }
+    LittleFS.mkdir(SLOT_DIR);
+    return true;
+}
+
+bool slot_name_ok(const char* name) {
+    size_t n = 0;
+    for (; name[n]; n++) {
+        char c = name[n];
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+               || c == '_' || c == '-';
+        if (!ok || n >= SLOT_NAME_MAX)
+            return false;
+    }
+    return n > 0;
+}
+
+const char* slot_save(const char* name, const int16_t* deci, size_t count) {
+    if (!mounted)
+        return "no filesystem";
+    if (!slot_name_ok(name))
+        return "bad slot name";
+
+    char path[48], tmp[48];
+    slot_path(name, ".seq", path, sizeof(path));
+    slot_path(name, ".tmp", tmp, sizeof(tmp));
+    SlotInfo list[SLOT_MAX];
+    if (!LittleFS.exists(path) && slot_list(list, SLOT_MAX) >= SLOT_MAX)
+        return "all slots in use";
+
+    File f = LittleFS.open(tmp, "w", true);
+    if (!f)
+        return "cannot create slot file";
+    SlotHeader h = { SLOT_MAGIC, (uint32_t)count, { 0, 0 } };
+    size_t     body = count * sizeof(int16_t);
+    bool       ok   = f.write((const uint8_t*)&h, sizeof(h)) == sizeof(h)
+                   && f.write((const uint8_t*)deci, body) == body;
+    f.close();
+    if (!ok) {
+        LittleFS.remove(tmp);
+        return "filesystem full";
+    }
+    if (!LittleFS.rename(tmp, path))         // replaces the old file atomically
+        return "rename failed";
+    return nullptr;
+}
+
+bool slot_remove(const char* name) {
+    char path[48];
+    if (!mounted || !slot_name_ok(name))
+        return false;
+    slot_path(name, ".seq", path, sizeof(path));
+    return LittleFS.remove(path);
+}
+
+size_t slot_list(SlotInfo* out, size_t max) {
+    if (!mounted)
+        return 0;
+    File   dir = LittleFS.open(SLOT_DIR);
+    size_t n   = 0;
+    if (!dir || !dir.isDirectory())
+        return 0;
+    for (File f = dir.openNextFile(); f && n < max; f = dir.openNextFile()) {
+        const char* name = f.name();
+        size_t      len  = strlen(name);
+        if (len < 5 || len - 4 > SLOT_NAME_MAX || strcmp(name + len - 4, ".seq") != 0)
+            continue;
+        SlotHeader h;
+        if (f.read((uint8_t*)&h, sizeof(h)) != sizeof(h) || h.magic != SLOT_MAGIC)
+            continue;
+        memcpy(out[n].name, name, len - 4);
+        out[n].name[len - 4] = '\0';
+        out[n].count         = h.count;
+        n++;
+    }
+    return n;
+}
+
+void slot_get_boot(char* name) {
+    Preferences prefs;
+    prefs.begin("nmea", true);
+    if (!prefs.getString("boot_slot", name, SLOT_NAME_MAX + 1))
+        name[0] = '\0';
+    prefs.end();
+}
+
+void slot_set_boot(const char* name) {
+    Preferences prefs;
+    prefs.begin("nmea", false);
+    prefs.putString("boot_slot", name);
+    prefs.end();
+}
+
+// ---------------------------------------------------------------------------
+// Loading
+// ---------------------------------------------------------------------------
+
+const char* SlotLoader::begin(const char* name, HeadingBuffer* buf, size_t first) {
+    char path[48];
+    buf_   = buf;
+    count_ = 0;
+    buf->clear();
+    if (!mounted)
+        return "no filesystem";
+    if (!slot_name_ok(name))
+        return "bad slot name";
+    slot_path(name, ".seq", path, sizeof(path));
+    file_ = LittleFS.open(path, "r");
+    if (!file_)
+        return "no such slot";
+
+    SlotHeader h;
+    if (file_.read((uint8_t*)&h, sizeof(h)) != sizeof(h) || h.magic != SLOT_MAGIC)
+        return "not a slot file";
+    if (h.count == 0 || h.count > SEQ_MAX_ENTRIES
+        || file_.size() != sizeof(h) + h.count * sizeof(int16_t))
+        return "slot file damaged";
+    if (!buf->reserve(h.count))
+        return "out of memory";
+    count_ = h.count;
+
+    size_t n = first < count_ ? first : count_;
+    if (file_.read((uint8_t*)buf->data, n * sizeof(int16_t)) != n * sizeof(int16_t))
+        return "read error";
+    buf->count = n;
+    return nullptr;
+}
+
+const char* SlotLoader::finish() {
+    size_t rest = count_ - buf_->count;
+    size_t got  = rest ? file_.read((uint8_t*)(buf_->data + buf_->count), rest * sizeof(int16_t))
+                       : 0;
+    file_.close();
+    if (got != rest * sizeof(int16_t))
+        return "read error";
+    buf_->count = count_;
+    return nullptr;
+}
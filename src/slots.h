@@ -0,0 +1,76 @@
+#pragma once
+
+/*
+ * slots.h
+ *
+ * Named heading sequences kept on the LittleFS data partition, so an
+ * uploaded scenario survives a power cycle, and the choice of one to start
+ * from at boot.
+ *
+ * A slot is the file /slots/<name>.seq: a 16-byte header followed by the
+ * headings as little-endian int16 deci-degrees, the layout of a
+ * HeadingBuffer, so loading is a read() straight into the buffer with no
+ * parsing:
+ *
+ *   uint32  magic   'HSQ1'
+ *   uint32  count   number of values that follow
+ *   uint32  0       reserved
+ *   uint32  0       reserved
+ *
+ * Slots are written to a temporary file and renamed over the old one, so
+ * a power cut during a save leaves the previous contents in place.  The
+ * boot slot is kept in NVS (Preferences namespace "nmea", key "boot_slot");
+ * none means the built-in default table.
+ *
+ * Boot loads in two steps so that start-up time does not grow with the
+ * sequence: SlotLoader::begin() reads the header and the first
+ * SLOT_BOOT_ENTRIES values, the TX task starts on them, and finish() reads
+ * the rest.  At 50 Hz those entries last five seconds; reading a full
+ * 36 000-entry slot takes a small fraction of that.
+ */
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "sequence.h"
+
+#define SLOT_NAME_MAX      15       // [A-Za-z0-9_-]
+#define SLOT_MAX           8
+#define SLOT_BOOT_ENTRIES  256
+
+struct SlotInfo {
+    char     name[SLOT_NAME_MAX + 1];
+    uint32_t count;
+};
+
+// Mount the filesystem (formatting it on first use).  False if there is
+// no usable data partition; slots are then unavailable.
+bool slots_begin();
+
+bool slot_name_ok(const char* name);
+
+// Store `count` headings as slot `name`.  nullptr on success, else why not.
+const char* slot_save(const char* name, const int16_t* deci, size_t count);
+
+bool   slot_remove(const char* name);
+size_t slot_list(SlotInfo* out, size_t max);
+
+// Boot slot name, "" for the default table.  `name` holds SLOT_NAME_MAX + 1.
+void slot_get_boot(char* name);
+void slot_set_boot(const char* name);
+
+class SlotLoader {
+public:
+    // Open slot `name`, size `buf` for all of it and read the first
+    // `first` values into it.  nullptr on success, else why not.
+    const char* begin(const char* name, HeadingBuffer* buf, size_t first);
+
+    // Read the remaining values.  nullptr on success.
+    const char* finish();
+
+    size_t count() const { return count_; }
+
+private:
+    File           file_;
+    HeadingBuffer* buf_   = nullptr;
+    size_t         count_ = 0;
+};
@@ -0,0 +1,157 @@
+/*
+ * talker.cpp
+ *
+ * Multi-sentence scheduler — see talker.h.
+ */
+
+#include "talker.h"
+
+static const char* const NAMES[SENT_COUNT] = { "hdt", "ths", "rot", "hdg" };
+
+// Length of each type for a three-digit heading (ROT: a two-digit rate).
+static const uint8_t TYPICAL_BYTES[SENT_COUNT] = {
+    19,     // $HEHDT,xxx.x,T*CS\r\n
+    19,     // $HETHS,xxx.x,A*CS\r\n
+    18,     // $HEROT,-xx.x,A*CS\r\n
+    21,     // $HEHDG,xxx.x,,,,*CS\r\n
+};
+
+static uint32_t pack(const TalkerMix& m) {
+    uint32_t v = 0;
+    for (int i = 0; i < SENT_COUNT; i++)
+        v |= (uint32_t)m.every[i] << (8 * i);
+    return v;
+}
+
+static TalkerMix unpack(uint32_t v) {
+    TalkerMix m;
+    for (int i = 0; i < SENT_COUNT; i++)
+        m.every[i] = (uint8_t)(v >> (8 * i));
+    return m;
+}
+
+const char* sentence_name(SentenceType type) {
+    return type < SENT_COUNT ? NAMES[type] : "?";
+}
+
+uint32_t talker_load_permille(const TalkerMix& mix, uint32_t tick_ms, uint32_t baud) {
+    // bytes per second needed vs. baud / 10 available, both scaled by tick_ms
+    uint64_t need = 0;
+    for (int i = 0; i < SENT_COUNT; i++)
+        if (mix.every[i])
+            need += (uint64_t)TYPICAL_BYTES[i] * 1000 * 10000 / mix.every[i];
+    uint64_t have = (uint64_t)baud * tick_ms;
+    return have ? (uint32_t)(need / have) : UINT32_MAX;
+}
+
+void Talker::begin(const TalkerMix& mix, uint32_t tick_ms, uint32_t baud) {
+    deferred_  = 0;
+    have_prev_ = false;
+    mix_.store(pack(mix), std::memory_order_relaxed);
+    set_line(tick_ms, baud);
+}
+
+void Talker::set_line(uint32_t tick_ms, uint32_t baud) {
+    tick_ms_ = tick_ms;
+    budget_  = baud / 10 * tick_ms / 1000;
+    restart(mix_.load(std::memory_order_acquire));
+}
+
+void Talker::set_mix(const TalkerMix& mix) {
+    mix_.store(pack(mix), std::memory_order_release);
+}
+
+TalkerMix Talker::mix() const {
+    return unpack(mix_.load(std::memory_order_acquire));
+}
+
+void Talker::restart(uint32_t packed) {
+    TalkerMix m = unpack(packed);
+    applied_ = packed;
+
+    // Stagger types that share a period: the n-th of them starts n ticks in.
+    for (int i = 0; i < SENT_COUNT; i++) {
+        uint8_t same = 0;
+        for (int j = 0; j < i; j++)
+            if (m.every[j] == m.every[i])
+                same++;
+        every_[i]     = m.every[i];
+        countdown_[i] = m.every[i] ? same % m.every[i] : 0;
+    }
+    rot_sum_   = 0;
+    rot_ticks_ = 0;
+}
+
+size_t Talker::tick(const HeadingTick& h, char* out) {
+    uint32_t packed = mix_.load(std::memory_order_acquire);
+    if (packed != applied_)
+        restart(packed);
+
+    // ROT: accumulate the shortest-arc change since the previous tick.
+    if (have_prev_) {
+        int32_t d = (int32_t)h.deci - prev_deci_;
+        d %= 3600;
+        if (d >  1800) d -= 3600;
+        if (d < -1800) d += 3600;
+        rot_sum_ += d;
+    }
+    rot_ticks_++;
+    prev_deci_ = h.deci;
+    have_prev_ = true;
+
+    char*    p    = out;
+    uint32_t left = budget_;
+
+    for (int i = 0; i < SENT_COUNT; i++) {
+        if (!every_[i])
+            continue;
+        if (countdown_[i]) {
+            countdown_[i]--;
+            continue;
+        }
+
+        char   buf[NMEA_SENTENCE_MAX];
+        size_t len;
+        switch ((SentenceType)i) {
+        case SENT_HDT:
+            if (h.hdt) {
+                memcpy(buf, h.hdt, h.hdt_len);
+                len = h.hdt_len;
+            } else {
+                len = makeHDTFixed(h.deci, buf);
+            }
+            break;
+        case SENT_THS:
+            len = makeTHS(h.deci, buf);
+            break;
+        case SENT_ROT: {
+            // 0.1° over rot_ticks_ * tick_ms  ->  0.1°/min, rounded
+            int64_t span = (int64_t)rot_ticks_ * tick_ms_;
+            int64_t num  = (int64_t)rot_sum_ * 60000;
+            int64_t rate = (num + (num >= 0 ? span / 2 : -span / 2)) / span;
+            len = makeROT((int32_t)rate, buf);
+            break;
+        }
+        case SENT_HDG:
+        default:
+            len = makeHDG(h.deci, buf);
+            break;
+        }
+
+        if (len > left) {
+            deferred_ = deferred_ + 1;        // stays due; retried next tick
+            continue;
+        }
+        memcpy(p, buf, len);
+        p    += len;
+        left -= (uint32_t)len;
+        sent_ = sent_ + 1;
+
+        countdown_[i] = every_[i] - 1;
+        if (i == SENT_ROT) {
+            rot_sum_   = 0;
+            rot_ticks_ = 0;
+        }
+    }
+    return (size_t)(p - out);
+}
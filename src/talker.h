@@ -0,0 +1,99 @@
+#pragma once
+
+/*
+ * talker.h
+ *
+ * Sentence scheduler: turns the heading stream (one heading per TX tick,
+ * sequence.h) into an interleaved mix of $HEHDT, $HETHS, $HEROT and
+ * $HEHDG, each at its own rate.
+ *
+ * Rates are given as "every N ticks" (0 = off), so at the 100 ms tick
+ * every=1 is 10 Hz and every=10 is 1 Hz.  Types with the same period are
+ * staggered by one tick each so they do not all land on the same tick.
+ *
+ * ROT is derived incrementally: every tick adds the shortest-arc change
+ * of heading to an accumulator, and an ROT sentence reports the mean rate
+ * since the previous one, in degrees per minute.
+ *
+ * The line is budgeted per tick: a tick may queue at most the bytes the
+ * UART can send in one tick period (baud / 10 for 8N1).  A sentence that
+ * does not fit waits for the next tick and is counted as deferred; types
+ * are served in enum order, so HDT is never starved by the others.
+ *
+ * The mix is four bytes packed in one atomic word, so the web task can
+ * change it while the TX task runs.
+ */
+
+#include <Arduino.h>
+#include <atomic>
+#include "nmea.h"
+#include "sequence.h"
+
+enum SentenceType : uint8_t {
+    SENT_HDT = 0,
+    SENT_THS,
+    SENT_ROT,
+    SENT_HDG,
+    SENT_COUNT,
+};
+
+// Ticks between sentences of each type, 0 = off.
+struct TalkerMix {
+    uint8_t every[SENT_COUNT];
+};
+
+// Room for one tick's sentences.
+#define TALKER_BURST_MAX  (SENT_COUNT * NMEA_SENTENCE_MAX)
+
+// Lower-case sentence name ("hdt", ...), e.g. for query parameters.
+const char* sentence_name(SentenceType type);
+
+// Average line load of `mix`, in per mille of what `baud` carries (8N1),
+// assuming three-digit headings.  Above 1000 the mix cannot be sustained
+// and sentences will be deferred.
+uint32_t talker_load_permille(const TalkerMix& mix, uint32_t tick_ms, uint32_t baud);
+
+class Talker {
+public:
+    // Set the line parameters and the initial mix (before the TX task runs).
+    void begin(const TalkerMix& mix, uint32_t tick_ms, uint32_t baud);
+
+    // --- web task ---
+
+    // Replace the mix; the TX task picks it up on its next tick.
+    void set_mix(const TalkerMix& mix);
+    TalkerMix mix() const;
+
+    // Sentences pushed to a later tick because the line was full.
+    uint32_t deferred() const { return deferred_; }
+
+    // Sentences formatted since boot.
+    uint32_t sent() const { return sent_; }
+
+    // --- TX task ---
+
+    // New tick period and baud rate, applied from the next tick() on.
+    void set_line(uint32_t tick_ms, uint32_t baud);
+
+    // Format this tick's sentences for heading `h` into `out`
+    // (TALKER_BURST_MAX bytes).  Returns the number of bytes to send.
+    size_t tick(const HeadingTick& h, char* out);
+
+private:
+    void restart(uint32_t packed);
+
+    std::atomic<uint32_t> mix_{0};            // TalkerMix, packed
+    volatile uint32_t     deferred_ = 0;
+    volatile uint32_t     sent_     = 0;
+
+    // TX task only
+    uint32_t  applied_   = 0;                 // mix the schedule was built for
+    uint8_t   every_[SENT_COUNT] = {};
+    uint8_t   countdown_[SENT_COUNT] = {};    // ticks until due; 0 = due now
+    uint32_t  tick_ms_   = 100;
+    uint32_t  budget_    = 0;                 // bytes per tick
+    bool      have_prev_ = false;
+    int16_t   prev_deci_ = 0;
+    int32_t   rot_sum_   = 0;                 // heading change since last ROT, 0.1°
+    uint32_t  rot_ticks_ = 0;
+};
@@ -0,0 +1,189 @@
+/*
+ * trace.cpp
+ *
+ * Event trace ring and its dumps — see trace.h.
+ */
+
+#include "trace.h"
+
+TraceEvent            trace_ring[TRACE_EVENTS];
+std::atomic<uint32_t> trace_head{0};
+
+static const char* route_names[TRACE_ROUTES_MAX] = { "(not found)" };
+static uint8_t     route_count = 1;
+
+// Chrome trace tracks: TX task events, HTTP handlers, the LED (which both
+// the loop and the web task drive).
+static const char* const THREADS[] = { "nmea_tx", "async_tcp", "led" };
+static const uint8_t     THREAD_COUNT = sizeof(THREADS) / sizeof(THREADS[0]);
+
+static const char* const SOURCES[] = { "sequence", "live", "log" };
+
+uint8_t trace_route(const char* uri) {
+    if (route_count >= TRACE_ROUTES_MAX)
+        return 0;
+    route_names[route_count] = uri;
+    return route_count++;
+}
+
+// ---------------------------------------------------------------------------
+// Dump
+// ---------------------------------------------------------------------------
+
+enum : uint8_t { STAGE_HEADER = 0, STAGE_NAMES, STAGE_EVENTS, STAGE_TRAILER, STAGE_DONE };
+
+TraceDump::TraceDump(bool json) : json_(json) {
+    end_    = trace_head.load(std::memory_order_acquire);
+    next_   = end_ > TRACE_EVENTS ? end_ - TRACE_EVENTS : 0;
+    now_us_ = micros();
+}
+
+size_t TraceDump::read(uint8_t* out, size_t cap) {
+    size_t n = 0;
+    while (n < cap) {
+        if (piece_pos_ == piece_len_) {
+            piece_pos_ = piece_len_ = 0;
+            if (!next_piece())
+                break;
+        }
+        size_t k = piece_len_ - piece_pos_;
+        if (k > cap - n)
+            k = cap - n;
+        memcpy(out + n, piece_ + piece_pos_, k);
+        piece_pos_ += k;
+        n          += k;
+    }
+    return n;
+}
+
+static void put_u16(char* p, uint16_t v) {
+    p[0] = (char)v;
+    p[1] = (char)(v >> 8);
+}
+
+static void put_u32(char* p, uint32_t v) {
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+bool TraceDump::next_piece() {
+    char*  p   = piece_;
+    size_t cap = sizeof(piece_);
+    int    n   = 0;
+
+    switch (stage_) {
+    case STAGE_HEADER:
+        stage_ = STAGE_NAMES;
+        if (json_) {
+            n = snprintf(p, cap, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dump_us\":%u},"
+                         "\"traceEvents\":[\n", (unsigned)now_us_);
+        } else {
+            memcpy(p, "NMTR", 4);
+            p[4] = TRACE_VERSION;
+            p[5] = TRACE_RECORD_LEN;
+            put_u16(p + 6, route_count);
+            put_u32(p + 8, now_us_);
+            n = 12;
+        }
+        break;
+
+    case STAGE_NAMES:
+        if (json_ && route_ < THREAD_COUNT) {
+            n = snprintf(p, cap, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                         "\"args\":{\"name\":\"%s\"}}", route_ ? ",\n" : "",
+                         (unsigned)route_ + 1, THREADS[route_]);
+            route_++;
+        } else if (!json_ && route_ < route_count) {
+            size_t len = strlen(route_names[route_]);
+            if (len > cap - 1)
+                len = cap - 1;
+            p[0] = (char)len;
+            memcpy(p + 1, route_names[route_], len);
+            n = (int)(1 + len);
+            route_++;
+        } else {
+            stage_ = STAGE_EVENTS;
+        }
+        break;
+
+    case STAGE_EVENTS: {
+        if (next_ == end_) {
+            stage_ = STAGE_TRAILER;
+            break;
+        }
+        TraceEvent& e  = trace_ring[next_ & (TRACE_EVENTS - 1)];
+        uint32_t    s1 = e.stamp.load(std::memory_order_acquire);
+        uint32_t    t  = e.t_us;
+        uint8_t     ty = e.type;
+        uint8_t     a  = e.a;
+        uint16_t    b  = e.b;
+        uint32_t    c  = e.c;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t    s2 = e.stamp.load(std::memory_order_relaxed);
+        next_++;
+        if (s1 != next_ || s2 != s1)
+            break;                       // being written, or already overwritten
+
+        if (!json_) {
+            put_u32(p, t);
+            p[4] = (char)ty;
+            p[5] = (char)a;
+            put_u16(p + 6, b);
+            put_u32(p + 8, c);
+            n = TRACE_RECORD_LEN;
+            break;
+        }
+
+        // Events from different tasks may be a little out of order, so
+        // micros() is unwrapped by the signed difference.
+        ts_us_  = have_t_ ? ts_us_ + (int32_t)(t - prev_t_) : t;
+        prev_t_ = t;
+        have_t_ = true;
+        long long ts = ts_us_;
+        switch (ty) {
+        case TRACE_SENT:
+            n = snprintf(p, cap, ",\n{\"name\":\"sent\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,"
+                         "\"pid\":1,\"tid\":1,\"args\":{\"index\":%u,\"bytes\":%u,\"from\":\"%s\"}}",
+                         ts, (unsigned)c, (unsigned)b, a < 3 ? SOURCES[a] : "?");
+            break;
+        case TRACE_SWAP:
+            n = snprintf(p, cap, ",\n{\"name\":\"swap\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,"
+                         "\"pid\":1,\"tid\":1,\"args\":{\"entries\":%u}}", ts, (unsigned)c);
+            break;
+        case TRACE_HTTP_BEGIN:
+            n = snprintf(p, cap, ",\n{\"name\":\"%s\",\"cat\":\"http\",\"ph\":\"B\",\"ts\":%lld,"
+                         "\"pid\":1,\"tid\":2,\"args\":{\"content_length\":%u}}",
+                         a < route_count ? route_names[a] : "?", ts, (unsigned)c);
+            break;
+        case TRACE_HTTP_END:
+            n = snprintf(p, cap, ",\n{\"name\":\"%s\",\"cat\":\"http\",\"ph\":\"E\",\"ts\":%lld,"
+                         "\"pid\":1,\"tid\":2}",
+                         a < route_count ? route_names[a] : "?", ts);
+            break;
+        case TRACE_LED:
+            n = snprintf(p, cap, ",\n{\"name\":\"led\",\"ph\":\"C\",\"ts\":%lld,"
+                         "\"pid\":1,\"tid\":3,\"args\":{\"on\":%u}}", ts, (unsigned)a);
+            break;
+        case TRACE_MISSED:
+            n = snprintf(p, cap, ",\n{\"name\":\"missed\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,"
+                         "\"pid\":1,\"tid\":1,\"args\":{\"periods\":%u}}", ts, (unsigned)c);
+            break;
+        default:
+            break;
+        }
+        break;
+    }
+
+    case STAGE_TRAILER:
+        stage_ = STAGE_DONE;
+        if (json_)
+            n = snprintf(p, cap, "\n]}\n");
+        break;
+
+    default:
+        return false;
+    }
+
+    piece_len_ = n > 0 ? ((size_t)n < cap ? (size_t)n : cap - 1) : 0;
+    return true;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+/*
+ * trace.h
+ *
+ * Event trace: a fixed ring of the last TRACE_EVENTS timestamped events,
+ * recorded from the TX task, the web handlers and the LED, and read back
+ * over /trace to see what the emulator did around a reported glitch.
+ *
+ *   sent      a burst went to the UART: sequence index, bytes, source
+ *   swap      the TX task adopted a new table
+ *   http      a request handler started / returned (route, duration)
+ *   led       the LED went on or off
+ *   missed    the TX task ran late by this many timer periods
+ *
+ * Recording is lock-free and never waits: a writer claims the next slot
+ * with one atomic increment, fills it and stamps it with its sequence
+ * number last.  A reader copies a slot and checks the stamp before and
+ * after, so an event being written or overwritten meanwhile is skipped
+ * rather than read torn.  Any task may record; the cost is micros(), the
+ * increment and five stores, small enough to leave on.
+ *
+ * Dumps (TraceDump) format the ring as it is when they start, a piece
+ * at a time, so they need no buffer the size of the ring and fit the
+ * chunked responses of the async server.  Events recorded after the start
+ * are left for the next dump; events overwritten before their turn are
+ * skipped.
+ *
+ *   binary   "NMTR" u8 version u8 record size u16 route count,
+ *            u32 micros() at the dump, then per route u8 length + name,
+ *            then records { u32 t_us, u8 type, u8 a, u16 b, u32 c },
+ *            little-endian
+ *   json     Chrome trace event format (chrome://tracing, Perfetto)
+ */
+
+#include <Arduino.h>
+#include <atomic>
+
+// Ring size, a power of two; 16 bytes each.
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS  1024
+#endif
+static_assert((TRACE_EVENTS & (TRACE_EVENTS - 1)) == 0, "TRACE_EVENTS must be a power of two");
+
+#define TRACE_ROUTES_MAX  32
+#define TRACE_VERSION     1
+#define TRACE_RECORD_LEN  12
+
+enum TraceType : uint8_t {
+    TRACE_SENT = 1,         // a = TraceSource, b = bytes, c = sequence index
+    TRACE_SWAP,             // c = entries in the new table
+    TRACE_HTTP_BEGIN,       // a = route, c = content length
+    TRACE_HTTP_END,         // a = route, c = microseconds in the handler
+    TRACE_LED,              // a = 1 on / 0 off
+    TRACE_MISSED,           // c = timer periods missed
+};
+
+enum TraceSource : uint8_t {
+    TRACE_FROM_SEQUENCE = 0,
+    TRACE_FROM_LIVE,
+    TRACE_FROM_LOG,         // c = sentences sent from the log so far
+};
+
+struct TraceEvent {
+    std::atomic<uint32_t> stamp;   // sequence number + 1 once written, 0 while writing
+    uint32_t              t_us;
+    uint8_t               type;
+    uint8_t               a;
+    uint16_t              b;
+    uint32_t              c;
+};
+
+extern TraceEvent            trace_ring[TRACE_EVENTS];
+extern std::atomic<uint32_t> trace_head;
+
+// Record an event (any task).
+inline void trace(TraceType type, uint8_t a, uint16_t b, uint32_t c) {
+    uint32_t    t = micros();
+    uint32_t    n = trace_head.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent& e = trace_ring[n & (TRACE_EVENTS - 1)];
+    e.stamp.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    e.t_us = t;
+    e.type = type;
+    e.a    = a;
+    e.b    = b;
+    e.c    = c;
+    e.stamp.store(n + 1, std::memory_order_release);
+}
+
+// Name HTTP route `uri` (a string that outlives the trace) and return its
+// number for TRACE_HTTP_* events; 0 is kept for requests no route took.
+uint8_t trace_route(const char* uri);
+
+// A dump in progress.  Copyable, so it can live in the response callback.
+class TraceDump {
+public:
+    // Start on the events recorded so far.
+    explicit TraceDump(bool json);
+
+    // Write the next at most `cap` bytes into `out`; 0 once done.
+    size_t read(uint8_t* out, size_t cap);
+
+private:
+    bool next_piece();           // format the next header, event or trailer
+
+    bool     json_;
+    uint8_t  stage_ = 0;         // header, routes, events, trailer, done
+    uint8_t  route_ = 0;
+    uint32_t next_;              // sequence number of the next event
+    uint32_t end_;
+    uint32_t now_us_;
+    bool     have_t_ = false;
+    uint32_t prev_t_ = 0;        // last timestamp, to unwrap micros()
+    int64_t  ts_us_  = 0;
+    char     piece_[192];
+    size_t   piece_len_ = 0;
+    size_t   piece_pos_ = 0;
+};
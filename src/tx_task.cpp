@@ -0,0 +1,60 @@
+/*
+ * tx_task.cpp
+ *
+ * ESP32 implementation of the transmitter task — see tx_task.h.
+ * The host build supplies its own backend in host/tx_task_host.cpp.
+ */
+
+#ifdef ARDUINO_ARCH_ESP32
+
+#include "tx_task.h"
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Above lwIP/tcpip (18) so network work never pre-empts a send, below the
+// Wi-Fi driver task (23) so the access point stays healthy.
+#ifndef TX_TASK_PRIORITY
+#define TX_TASK_PRIORITY  (configMAX_PRIORITIES - 5)
+#endif
+#define TX_TASK_STACK     4096
+
+static TaskHandle_t       tx_handle = nullptr;
+static esp_timer_handle_t tx_timer  = nullptr;
+static TxWakeFn           wake_fn   = nullptr;
+
+// esp_timer callback — runs in the esp_timer task, just wakes the TX task.
+static void on_tx_timer(void*) {
+    xTaskNotifyGive(tx_handle);
+}
+
+static void tx_task(void*) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Serve until the next deadline is in the future, then sleep until
+        // it.  micros() is esp_timer_get_time(), so deadlines and the timer
+        // share one clock.
+        for (;;) {
+            uint32_t next = wake_fn(micros());
+            int32_t  wait = (int32_t)(next - micros());
+            if (wait > 0) {
+                esp_timer_start_once(tx_timer, (uint64_t)wait);
+                break;
+            }
+        }
+    }
+}
+
+void tx_task_start(TxWakeFn wake) {
+    wake_fn = wake;
+    xTaskCreate(tx_task, "nmea_tx", TX_TASK_STACK, nullptr, TX_TASK_PRIORITY, &tx_handle);
+
+    esp_timer_create_args_t args = {};
+    args.callback = on_tx_timer;
+    args.name     = "nmea_tx";
+    esp_timer_create(&args, &tx_timer);
+    xTaskNotifyGive(tx_handle);          // first wake-up now
+}
+
+#endif  // ARDUINO_ARCH_ESP32
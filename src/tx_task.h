@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+ * tx_task.h
+ *
+ * High-priority NMEA transmitter task and the one timer that paces every
+ * output channel.
+ *
+ * A hardware timer (esp_timer) wakes a dedicated FreeRTOS task, and that
+ * task calls the wake function, which serves whatever is due and returns
+ * the next deadline; the timer is then armed for it.  The web server runs
+ * in the lower-priority async_tcp task, so HTTP traffic can delay neither
+ * the timer nor the transmitter.
+ *
+ * Each output keeps its own deadlines in a TxClock.  They are absolute —
+ * the next one is the last plus the period, not "now" plus the period —
+ * so outputs at different rates share the timer without pacing each other
+ * and a late wake-up never shifts the deadlines after it.  If an output
+ * could not be served for one or more of its periods (the task is already
+ * behind), it is served once and told how many periods it missed; it
+ * sends a single sentence rather than a burst.
+ */
+
+#include <Arduino.h>
+
+// Periodic deadlines of one output (TX task only).
+struct TxClock {
+    uint32_t period_us = 0;
+    uint32_t due_us    = 0;     // next deadline, micros()
+    uint32_t served_us = 0;     // deadline of the tick being (or last) served
+
+    // First deadline at `now_us`.
+    void start(uint32_t period_ms, uint32_t now_us) {
+        period_us = period_ms * 1000;
+        due_us    = now_us;
+        served_us = now_us;
+    }
+
+    // New period; the next deadline follows one new period after the one
+    // being served.
+    void set_period(uint32_t period_ms) {
+        period_us = period_ms * 1000;
+        due_us    = served_us + period_us;
+    }
+
+    // Serve the current tick again `wait_us` from now instead of moving on.
+    void retry(uint32_t now_us, uint32_t wait_us) {
+        due_us = now_us + wait_us;
+    }
+
+    // True once the deadline has come at `now_us`: moves to the next one
+    // and stores the number of whole periods skipped in `missed`.
+    bool take(uint32_t now_us, uint32_t* missed) {
+        int32_t late = (int32_t)(now_us - due_us);
+        if (late < 0)
+            return false;
+        *missed   = (uint32_t)late / period_us;
+        served_us = due_us + *missed * period_us;
+        due_us    = served_us + period_us;
+        return true;
+    }
+};
+
+// Earlier of two deadlines.
+inline uint32_t tx_earliest(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) <= 0 ? a : b;
+}
+
+// Serves what is due at `now_us` (micros()) and returns the next deadline.
+typedef uint32_t (*TxWakeFn)(uint32_t now_us);
+
+// Create the task and start the timer.  Call once from setup(); the first
+// wake-up runs straight away.
+void tx_task_start(TxWakeFn wake);
@@ -0,0 +1,103 @@
+/*
+ * uart_tx.cpp
+ *
+ * Non-blocking NMEA output — see uart_tx.h.
+ */
+
+#include "uart_tx.h"
+
+void UartTx::note_blocked(uint32_t since_us) {
+    uint32_t dt = micros() - since_us;
+    stats_.blocked_us = stats_.blocked_us + dt;
+    if (dt > stats_.blocked_max_us)
+        stats_.blocked_max_us = dt;
+}
+
+// Driver write, timed.  Also moves on the time the line falls idle.
+void UartTx::timed_write(const char* data, size_t len) {
+    uint32_t t0 = micros();
+    if ((int32_t)(idle_us_ - t0) < 0)
+        idle_us_ = t0;
+    idle_us_ += (uint32_t)((uint64_t)len * 10000000 / port_->baudRate());
+    port_->write((const uint8_t*)data, len);
+    note_blocked(t0);
+    if (tap_)
+        tap_(data, len);
+}
+
+void UartTx::begin(HardwareSerial& p, uint32_t baud, uint32_t config,
+                   int8_t rx_pin, int8_t tx_pin) {
+    port_ = &p;
+    port_->setTxBufferSize(UART_TX_RING);
+    port_->begin(baud, config, rx_pin, tx_pin);
+    capacity_ = port_->availableForWrite();
+}
+
+size_t UartTx::send(const char* data, size_t len) {
+    int room = port_->availableForWrite();
+    if (room < capacity_)
+        stats_.backlog = stats_.backlog + 1;
+
+    // Common case: the whole burst fits.
+    if ((int)len <= room) {
+        timed_write(data, len);
+        stats_.bytes_queued = stats_.bytes_queued + len;
+        return len;
+    }
+
+    // Otherwise queue whole sentences while they fit and drop the rest.
+    size_t      queued = 0;
+    const char* end    = data + len;
+    while (data < end) {
+        const char* nl = (const char*)memchr(data, '\n', end - data);
+        size_t      n  = nl ? (size_t)(nl + 1 - data) : (size_t)(end - data);
+        if ((int)n <= room) {
+            timed_write(data, n);
+            room   -= (int)n;
+            queued += n;
+        } else {
+            stats_.dropped = stats_.dropped + 1;
+        }
+        data += n;
+    }
+    stats_.bytes_queued = stats_.bytes_queued + queued;
+    return queued;
+}
+
+void UartTx::missed(uint32_t missed) {
+    stats_.underruns = stats_.underruns + missed;
+}
+
+uint32_t UartTx::set_baud(uint32_t baud) {
+    // An empty ring can still leave bytes in the hardware FIFO, so wait by
+    // the clock as well: the line is idle once every byte written has had
+    // its time on the wire.
+    uint32_t t0   = micros();
+    int32_t  idle = (int32_t)(idle_us_ - t0);
+    uint32_t wait = drain_us();
+    if (idle > 0 && (uint32_t)idle > wait)
+        wait = (uint32_t)idle;
+    if (wait)
+        return wait;
+    port_->updateBaudRate(baud);
+    note_blocked(t0);
+    return 0;
+}
+
+uint32_t UartTx::drain_us() const {
+    int pending = capacity_ - port_->availableForWrite();
+    if (pending <= 0)
+        return 0;
+    return (uint32_t)((uint64_t)pending * 10000000 / port_->baudRate());
+}
+
+UartTxStats UartTx::stats() const {
+    UartTxStats s;
+    s.bytes_queued   = stats_.bytes_queued;
+    s.dropped        = stats_.dropped;
+    s.backlog        = stats_.backlog;
+    s.underruns      = stats_.underruns;
+    s.blocked_us     = stats_.blocked_us;
+    s.blocked_max_us = stats_.blocked_max_us;
+    return s;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+/*
+ * uart_tx.h
+ *
+ * Non-blocking NMEA output, one UartTx per UART.
+ *
+ * The UART driver is given a TX ring buffer large enough for several
+ * bursts; its interrupt refills the 128-byte hardware FIFO from there, so
+ * queueing a burst is a memory copy.  UartTx::send() only queues sentences
+ * that fit in the free space as a whole and never waits for room: a
+ * sentence that does not fit is dropped and counted rather than
+ * stretching the TX interval.  A baud rate change waits for the ring to
+ * drain the same way, by being retried rather than by blocking, so the TX
+ * task never stalls on one port while others are due.
+ *
+ * Counters (read from any task, written by the TX task only):
+ *
+ *   bytes_queued    bytes handed to the driver
+ *   dropped         whole sentences refused because the ring was full
+ *   backlog         bursts queued while the previous one was still being
+ *                   sent — the line is behind the schedule
+ *   underruns       TX slots that went out empty because the TX task ran
+ *                   late (missed timer periods)
+ *   blocked_us      time spent inside the driver's write(), and the
+ *   blocked_max_us  longest single call; ~0 unless something is wrong
+ */
+
+#include <Arduino.h>
+
+// TX ring size; room for several bursts even at 50 Hz / 115200 baud.
+#ifndef UART_TX_RING
+#define UART_TX_RING  1024
+#endif
+
+struct UartTxStats {
+    uint32_t bytes_queued;
+    uint32_t dropped;
+    uint32_t backlog;
+    uint32_t underruns;
+    uint32_t blocked_us;
+    uint32_t blocked_max_us;
+};
+
+// Also pass every byte handed to the driver to a tap (called in the TX
+// task, so it must not block), e.g. net_stream_write().
+typedef void (*UartTxTap)(const char* data, size_t len);
+
+// One UART used for NMEA output.
+class UartTx {
+public:
+    // Size the driver's TX ring and open the port.  Replaces port.begin().
+    void begin(HardwareSerial& port, uint32_t baud, uint32_t config,
+               int8_t rx_pin, int8_t tx_pin);
+
+    void set_tap(UartTxTap tap) { tap_ = tap; }
+
+    // --- TX task ---
+
+    // Queue the sentences in `data` (complete "$...\r\n" sentences) without
+    // blocking.  Returns the number of bytes queued.
+    size_t send(const char* data, size_t len);
+
+    // Record `missed` empty TX slots.
+    void missed(uint32_t missed);
+
+    // Switch baud rate once everything queued has left at the old one
+    // (between two ticks).  Never waits: returns 0 once switched, else the
+    // time until the line is idle, to try again then.
+    uint32_t set_baud(uint32_t baud);
+
+    // Time until everything queued so far has left the wire (8N1).
+    uint32_t drain_us() const;
+
+    // --- any task ---
+
+    UartTxStats stats() const;
+
+private:
+    void note_blocked(uint32_t since_us);
+    void timed_write(const char* data, size_t len);
+
+    HardwareSerial*      port_     = nullptr;
+    volatile UartTxStats stats_    = {};
+    int                  capacity_ = 0;     // free space when the ring is empty
+    UartTxTap            tap_      = nullptr;
+    uint32_t             idle_us_  = 0;     // micros() the last byte queued has left
+};
@@ -0,0 +1,87 @@
+/*
+ * waveform.cpp
+ *
+ * On-device heading generator — see waveform.h.
+ */
+
+#include "waveform.h"
+#include "fixmath.h"
+
+bool wave_shape_from_name(const char* name, WaveShape* out) {
+    static const char* const NAMES[] = { "sine", "sawtooth", "triangle", "square", "random" };
+    for (uint8_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); i++) {
+        if (strcmp(name, NAMES[i]) == 0) {
+            *out = (WaveShape)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WaveGenerator::configure(const WaveParams& p) {
+    p_ = p;
+    if (p_.length < 2) p_.length = 2;
+
+    // periods turns spread over length-1 steps, in Q32.  Rounded up so the
+    // last entry lands just past the period boundary rather than short of it.
+    uint64_t turns = (uint64_t)p_.periods << 32;
+    phase_step_ = (uint32_t)((turns + p_.length - 2) / (p_.length - 1));
+    phase_      = 0;
+    walk_       = 0;
+    rng_        = 0x9E3779B9u ^ p_.centre_deci;
+}
+
+// Normalised shape value for a Q32 phase, Q15 (-32767 .. 32767).
+static int32_t shape_q15(WaveShape shape, uint32_t phase) {
+    switch (shape) {
+    case WAVE_SAWTOOTH:
+        // -1 at the start of each period, rising to +1 at its end.
+        return (int32_t)(phase >> 16) - 32768;
+    case WAVE_TRIANGLE: {
+        // 4 quarter ramps: 0 -> 1 -> 0 -> -1 -> 0
+        int32_t q = (int32_t)((phase >> 15) & 0x7FFF);       // position in quarter
+        switch (phase >> 30) {
+        case 0:  return q;
+        case 1:  return 32767 - q;
+        case 2:  return -q;
+        default: return q - 32767;
+        }
+    }
+    case WAVE_SQUARE:
+        return (phase < 0x80000000u) ? 32767 : -32767;
+    case WAVE_SINE:
+    default:
+        return sin_q15(phase);
+    }
+}
+
+int16_t WaveGenerator::next(size_t index) {
+    int32_t offset;
+
+    if (p_.shape == WAVE_RANDOM) {
+        // xorshift32, step uniformly distributed in [-step, +step]
+        rng_ ^= rng_ << 13;
+        rng_ ^= rng_ >> 17;
+        rng_ ^= rng_ << 5;
+        int32_t span = 2 * (int32_t)p_.step_deci + 1;
+        walk_ += (int32_t)(rng_ % (uint32_t)span) - (int32_t)p_.step_deci;
+
+        int32_t amp = p_.amp_deci;
+        if (walk_ >  amp) walk_ =  2 * amp - walk_;
+        if (walk_ < -amp) walk_ = -2 * amp - walk_;
+        if (walk_ >  amp) walk_ =  amp;       // step larger than 2 * amp
+        if (walk_ < -amp) walk_ = -amp;
+        offset = walk_;
+    } else {
+        if (index == 0) phase_ = 0;
+        int32_t f = shape_q15(p_.shape, phase_);
+        phase_ += phase_step_;
+        // amp * f / 32767, rounded to nearest
+        int32_t prod = (int32_t)p_.amp_deci * f;
+        offset = (prod + (prod >= 0 ? 16383 : -16383)) / 32767;
+    }
+
+    int32_t h = (p_.centre_deci + offset) % 3600;
+    if (h < 0) h += 3600;
+    return (int16_t)h;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+/*
+ * waveform.h
+ *
+ * On-device heading generator.  A scenario is a handful of parameters
+ * (shape, centre, amplitude, periods, cycle length) instead of a table of
+ * precomputed values; the TX task asks for one heading per tick and gets it
+ * from integer maths (sin_q15() for the sine), so no table is ever built
+ * and the cycle length is independent of SEQ_MAX_ENTRIES.
+ *
+ * For the periodic shapes, entry i of an N-entry cycle sits at
+ * t = i * periods / (N - 1), matching the function page's original
+ * computeValues(): the cycle starts and ends on the same point.
+ *
+ *   sine       centre + amp * sin(2*pi*t)
+ *   sawtooth   ramps centre - amp .. centre + amp once per period
+ *   triangle   0 -> +amp -> -amp -> 0 once per period, in phase with sine
+ *   square     +amp for the first half of each period, -amp for the second
+ *   random     random walk: each tick moves by up to +/- step, reflected
+ *              at centre +/- amp; continues across cycle wraps
+ *
+ * Results are wrapped into 0.0 .. 359.9 degrees.
+ */
+
+#include <Arduino.h>
+
+enum WaveShape : uint8_t {
+    WAVE_SINE = 0,
+    WAVE_SAWTOOTH,
+    WAVE_TRIANGLE,
+    WAVE_SQUARE,
+    WAVE_RANDOM,
+};
+
+struct WaveParams {
+    WaveShape shape;
+    int16_t   centre_deci;     // 0.1° units
+    uint16_t  amp_deci;        // peak deviation, 0.1° units
+    uint16_t  periods;         // complete cycles per sequence (periodic shapes)
+    uint32_t  length;          // sentences per sequence, >= 2
+    uint16_t  step_deci;       // random walk: largest move per tick
+};
+
+// Parse "sine", "sawtooth", "triangle", "square", "random".
+bool wave_shape_from_name(const char* name, WaveShape* out);
+
+class WaveGenerator {
+public:
+    // Load new parameters (web task, while this generator is not in use).
+    void configure(const WaveParams& p);
+
+    // Heading for entry `index` of the cycle, in deci-degrees 0 .. 3599.
+    // TX task only; must be called with consecutive indices, wrapping to 0.
+    int16_t next(size_t index);
+
+    const WaveParams& params() const { return p_; }
+
+private:
+    WaveParams p_          = {};
+    uint32_t   phase_      = 0;    // Q32 fraction of a period
+    uint32_t   phase_step_ = 0;
+    int32_t    walk_       = 0;    // random walk offset from centre, 0.1°
+    uint32_t   rng_        = 1;
+};
@@ -9,8 +9,11 @@
  *   - Drag (or touch-drag) the compass needle to a heading value.
  *   - Tap "Add to sequence" to append that heading to the list.
  *   - Repeat until 125 headings have been collected.
- *   - The page then POSTs the full comma-separated list to /update
- *     and shows a confirmation message.
+ *   - The page then POSTs the 125 headings to /update as binary int16
+ *     deci-degrees and shows a confirmation message.
+ *   - Or tick "Live steer": the needle position is streamed over the /live
+ *     WebSocket (at most once per TX interval) and transmitted at once;
+ *     the drag-to-wire latency is shown below the toggle.
  */
 
 static const char WEB_PAGE[] = R"html(
@@ -145,6 +148,40 @@ static const char WEB_PAGE[] = R"html(
       accent-color: #58a6ff;
     }
 
+    #live-section {
+      width: 240px;
+      margin-bottom: 12px;
+      background: #161b22;
+      border: 1px solid #30363d;
+      border-radius: 6px;
+      padding: 10px 12px;
+    }
+
+    #live-section label {
+      display: flex;
+      align-items: center;
+      gap: 8px;
+      cursor: pointer;
+      font-size: 0.9em;
+      color: #c9d1d9;
+      user-select: none;
+    }
+
+    #live-section input[type="checkbox"] {
+      width: 15px;
+      height: 15px;
+      accent-color: #f85149;
+      cursor: pointer;
+    }
+
+    #live-lat {
+      margin-top: 6px;
+      font-size: 0.78em;
+      color: #8b949e;
+      font-family: monospace;
+      min-height: 1.2em;
+    }
+
     #progress-bar-track {
       width: 240px;
       height: 6px;
@@ -241,6 +278,15 @@ static const char WEB_PAGE[] = R"html(
       </div>
     </div>
 
+    <!-- Live steering over the /live WebSocket -->
+    <div id="live-section">
+      <label>
+        <input type="checkbox" id="live-checkbox" onchange="toggleLive()">
+        Live steer (output follows the needle)
+      </label>
+      <div id="live-lat"></div>
+    </div>
+
     <div id="progress-bar-track">
       <div id="progress-bar-fill"></div>
     </div>
@@ -347,6 +393,8 @@ static const char WEB_PAGE[] = R"html(
       // Keep the function-generator link in sync with the current knob position
       const fl = document.getElementById('func-link');
       if (fl) fl.href = '/addfunction?h=' + heading.toFixed(1);
+
+      liveQueue();
     }
 
     // --- Pointer input ---
@@ -400,6 +448,103 @@ static const char WEB_PAGE[] = R"html(
       document.getElementById('drift-val').textContent = (n >= 0 ? '+' : '') + n.toFixed(1) + '\u00b0';
     }
 
+    // --- Live steering ---
+    // Positions go out as 6-byte frames ('H', 0, seq, deci), at most once
+    // per TX interval: a drag between two sends only moves the value the
+    // next send carries.  The device acks each transmitted position with
+    // the time from arrival to the last byte on the wire; adding the time
+    // the position waited here and half a ping round trip gives
+    // drag-to-wire latency.
+    let liveWs       = null;
+    let liveInterval = 100;          // ms, from /line
+    let liveSeq      = 0;
+    let liveLast     = 0;            // time of the last send
+    let liveTimer    = null;
+    let liveDragAt   = 0;            // first change not yet sent, 0 = none
+    let liveRtt      = 0;            // ms, smoothed
+    let pingAt       = 0;
+    const liveHold   = new Array(64).fill(0);   // ms waited here, by seq
+
+    function toggleLive() {
+      if (document.getElementById('live-checkbox').checked) startLive();
+      else stopLive();
+    }
+
+    function startLive() {
+      fetch('/line').then(r => r.text()).then(t => {
+        const m = /interval=(\d+)ms/.exec(t);
+        if (m) liveInterval = parseInt(m[1], 10);
+      }).catch(() => {});
+
+      liveWs = new WebSocket('ws://' + location.host + '/live');
+      liveWs.binaryType = 'arraybuffer';
+      liveWs.onopen = () => {
+        liveDragAt = performance.now();
+        liveFlush();
+        livePing();
+      };
+      liveWs.onmessage = e => onLiveMessage(new DataView(e.data));
+      liveWs.onclose = () => {
+        liveWs = null;
+        document.getElementById('live-checkbox').checked = false;
+        document.getElementById('live-lat').textContent = '';
+      };
+    }
+
+    function stopLive() {
+      if (!liveWs) return;
+      if (liveWs.readyState === 1) liveWs.send(new Uint8Array([82]));   // 'R'
+      liveWs.close();
+    }
+
+    function livePing() {
+      if (!liveWs || liveWs.readyState !== 1) return;
+      pingAt = performance.now();
+      liveWs.send(new Uint8Array([80]));                                 // 'P'
+      setTimeout(livePing, 1000);
+    }
+
+    function liveQueue() {
+      if (!liveWs || liveWs.readyState !== 1) return;
+      if (!liveDragAt) liveDragAt = performance.now();
+      if (liveTimer) return;
+      const wait = liveLast + liveInterval - performance.now();
+      if (wait <= 0) liveFlush();
+      else liveTimer = setTimeout(liveFlush, wait);
+    }
+
+    function liveFlush() {
+      liveTimer = null;
+      if (!liveWs || liveWs.readyState !== 1 || !liveDragAt) return;
+      const now = performance.now();
+      liveSeq = (liveSeq + 1) & 0xffff;
+      liveHold[liveSeq & 63] = now - liveDragAt;
+      liveLast   = now;
+      liveDragAt = 0;
+
+      const f = new DataView(new ArrayBuffer(6));
+      f.setUint8(0, 72);                                                 // 'H'
+      f.setUint16(2, liveSeq, true);
+      f.setInt16(4, Math.round(heading * 10) % 3600, true);
+      liveWs.send(f.buffer);
+    }
+
+    function onLiveMessage(v) {
+      const type = v.getUint8(0);
+      if (type === 80) {                                                 // 'P' echo
+        const rtt = performance.now() - pingAt;
+        liveRtt = liveRtt ? liveRtt * 0.75 + rtt * 0.25 : rtt;
+      } else if (type === 65 && v.byteLength >= 8) {                    // 'A' ack
+        const seq    = v.getUint16(2, true);
+        const device = v.getUint32(4, true) / 1000;
+        const hold   = liveHold[seq & 63];
+        const total  = hold + liveRtt / 2 + device;
+        document.getElementById('live-lat').textContent =
+          'drag\u2192wire ' + total.toFixed(1) + ' ms (page ' + hold.toFixed(1) +
+          ' + net ' + (liveRtt / 2).toFixed(1) + ' + device ' + device.toFixed(1) + ')';
+      }
+    }
+
     // --- Add heading to sequence ---
     function addHeading() {
       if (collected.length >= 125) return;
@@ -437,13 +582,19 @@ static const char WEB_PAGE[] = R"html(
     }
 
     // --- POST sequence to ESP32 ---
+    // Binary: 8-byte header (marker -32768, interval 0 = keep, count), then
+    // int16 little-endian deci-degrees, stored by the ESP32 as they are.
     function sendSequence() {
-      const payload = collected.map(v => v.toFixed(1)).join(',');
+      const view = new DataView(new ArrayBuffer(8 + 2 * collected.length));
+      view.setInt16(0, -32768, true);
+      view.setUint16(2, 0, true);
+      view.setUint32(4, collected.length, true);
+      collected.forEach((v, i) => view.setInt16(8 + 2 * i, Math.round(v * 10), true));
 
       fetch('/update', {
         method:  'POST',
-        headers: { 'Content-Type': 'text/plain' },
-        body:    payload
+        headers: { 'Content-Type': 'application/octet-stream' },
+        body:    view.buffer
       })
       .then(response => response.text())
       .then(() => {
@@ -0,0 +1,616 @@
+/*
+ * test_output.cpp
+ *
+ * Host tests and micro-benchmarks for the sentence path, so performance
+ * work cannot change the output unnoticed:
+ *
+ *   1. nmea_tenths() against "%.1f" over a centi-degree sweep and edge
+ *      cases; the checksum of every int16 makeHDTFixed() sentence,
+ *      recomputed independently; and nmea_set_talker() against sentences
+ *      checksummed afresh
+ *   2. the /update parser: count limit, malformed values, trailing commas,
+ *      every split of a body into two chunks, and bodies through the
+ *      parser and TX path against the original toFloat() + snprintf("%.1f")
+ *   3. the default table: count, stride, checksums, and the Scilab formula
+ *   4. golden byte streams: the bytes the TX path (SequencePlayer + Talker)
+ *      sends for a few fixed scenarios, hashed and compared with the
+ *      values recorded below
+ *   5. ns per sentence through the TX path, and heap allocations and time
+ *      per /update upload (printed, not checked)
+ *
+ * When a stream differs from its golden hash, the test prints the line to
+ * paste over GOLDEN[] below and writes the stream to
+ * /tmp/test_output-<scenario>.nmea to inspect.
+ *
+ * Run from the repository root:
+ *   pio test -e native
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "default_table.h"
+#include "heading_parser.h"
+#include "keyframes.h"
+#include "nmea.h"
+#include "sequence.h"
+#include "talker.h"
+#include "waveform.h"
+
+#include <chrono>
+
+// ---------------------------------------------------------------------------
+// Heap accounting (glibc): every malloc / realloc is counted
+// ---------------------------------------------------------------------------
+
+extern "C" void* __libc_malloc(size_t n);
+extern "C" void* __libc_realloc(void* p, size_t n);
+extern "C" void  __libc_free(void* p);
+
+static size_t heap_allocs = 0;
+
+extern "C" void* malloc(size_t n) {
+    heap_allocs++;
+    return __libc_malloc(n);
+}
+
+extern "C" void* realloc(void* p, size_t n) {
+    heap_allocs++;
+    return __libc_realloc(p, n);
+}
+
+extern "C" void free(void* p) {
+    __libc_free(p);
+}
+
+// ---------------------------------------------------------------------------
+// Sentences
+// ---------------------------------------------------------------------------
+
+// The original float formatter, as the reference.  Its last snprintf
+// went straight into out; cutting line[] to NMEA_HDT_MAX gives the same
+// bytes without a -Wformat-truncation warning.
+static void makeHDT_snprintf(float heading, char *out)
+{
+    char body[32];
+    snprintf(body, sizeof(body), "HEHDT,%.1f,T", heading);
+
+    uint8_t cs = 0;
+    for (int i = 0; body[i] != 0; i++)
+        cs ^= body[i];
+
+    char hex[3];
+    snprintf(hex, sizeof(hex), "%02X", cs);
+
+    char   line[40];
+    size_t n = (size_t)snprintf(line, sizeof(line), "$%s*%s\r\n", body, hex);
+    if (n > NMEA_HDT_MAX - 1)
+        n = NMEA_HDT_MAX - 1;
+    memcpy(out, line, n);
+    out[n] = 0;
+}
+
+// "$...*CS\r\n" with CS the XOR of everything between '$' and '*'.
+static bool checksum_ok(const char* s, size_t len) {
+    if (len < 6 || s[0] != '$' || s[len - 5] != '*' || s[len - 2] != '\r' || s[len - 1] != '\n')
+        return false;
+    uint8_t cs = 0;
+    for (size_t i = 1; i < len - 5; i++)
+        cs ^= (uint8_t)s[i];
+    char hex[3];
+    snprintf(hex, sizeof(hex), "%02X", cs);
+    return s[len - 4] == hex[0] && s[len - 3] == hex[1];
+}
+
+// nmea_tenths(), which rounds values near a tie in the parser, against
+// "%.1f" of the magnitude.
+static void test_tenths_matches_snprintf() {
+    // Ties on the decimal value, signed zero and a value rounding to it,
+    // no wrap at 360, values past int16 deci-degrees, and non-finites.
+    static const float EDGES[] = {
+        0.0f, -0.0f, 331.9f, 331.94f, 331.96f, 12.25f, 0.35f, -1.25f, -359.65f,
+        359.94f, 359.96f, 360.0f, -0.04f, -45.0f, 5000.0f, -5000.0f,
+        999999.9f, 999999.96f, -999999.96f, 16777216.0f, 1e30f, 1e-45f,
+        INFINITY, -INFINITY, NAN,
+    };
+    auto check = [](float f) {
+        char ref[48];
+        char got[24];
+        char msg[32];
+        snprintf(ref, sizeof(ref), "%.1f", fabsf(f));
+        snprintf(msg, sizeof(msg), "nmea_tenths(%.9g)", f);
+        uint32_t t;
+        if (!nmea_tenths(f, &t)) {
+            TEST_ASSERT_TRUE_MESSAGE(!(fabsf(f) < 999999.95f), msg);
+            return;
+        }
+        snprintf(got, sizeof(got), "%lu.%lu", (unsigned long)(t / 10), (unsigned long)(t % 10));
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(ref, got, msg);
+    };
+    for (float f : EDGES)
+        check(f);
+    for (int32_t c = -100000; c <= 100000; c++)
+        check(c / 100.0f);
+}
+
+static void test_hdt_fixed_checksums() {
+    char     out[NMEA_HDT_MAX];
+    uint32_t bad = 0;
+    for (int32_t d = -INT16_MAX; d <= INT16_MAX; d++) {
+        size_t len = makeHDTFixed((int16_t)d, out);
+        if (len != strlen(out) || !checksum_ok(out, len))
+            bad++;
+    }
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, bad, "malformed makeHDTFixed() sentences");
+}
+
+// nmea_set_talker() against sentences formatted with the new ID directly.
+static void test_retag() {
+    static const char* const IDS[] = { "HE", "HC", "IN", "GP", "ZZ" };
+    char burst[2 * NMEA_HDT_MAX];
+    char want[2 * NMEA_HDT_MAX];
+    char msg[40];
+    for (int32_t d = -3600; d <= 3600; d += 7) {
+        size_t n1  = makeHDTFixed((int16_t)d, burst);
+        size_t n2  = makeHDTFixed((int16_t)(d / 2), burst + n1);
+        size_t len = n1 + n2;
+        for (const char* id : IDS) {
+            memcpy(want, burst, len);
+            for (size_t i = 0; i < len; i += (i < n1 ? n1 : n2)) {
+                want[i + 1] = id[0];
+                want[i + 2] = id[1];
+                uint8_t cs = 0;
+                size_t  k  = i + 1;
+                for (; want[k] != '*'; k++)
+                    cs ^= (uint8_t)want[k];
+                snprintf(want + k + 1, 3, "%02X", cs);
+                want[k + 3] = '\r';
+            }
+            char got[sizeof(burst)];
+            memcpy(got, burst, len);
+            nmea_set_talker(got, len, id);
+            snprintf(msg, sizeof(msg), "nmea_set_talker(%s) on %d", id, (int)d);
+            TEST_ASSERT_EQUAL_MEMORY_MESSAGE(want, got, len, msg);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// /update parser
+// ---------------------------------------------------------------------------
+
+static void test_parser_cases() {
+    static const struct {
+        const char* body;
+        bool        ok;
+        size_t      count;
+        const char* error;
+        size_t      at;
+    } CASES[] = {
+        { "328.9,329.0,329.2",      true,  3, nullptr,                0 },
+        { "328.9, 329.0 ,\r\n329.2,", true, 3, nullptr,               0 },   // one trailing comma
+        { "328.9,329.0,,",          false, 2, "empty value",         12 },   // two
+        { ",328.9",                 false, 0, "empty value",          0 },
+        { "328.9,,329.0",           false, 1, "empty value",          6 },
+        { "328.94,328.95,-0.05",    true,  3, nullptr,                0 },
+        { "328.9,abc",              false, 1, "unexpected character", 6 },
+        { "328.9,32a",              false, 1, "unexpected character", 8 },
+        { "328.9;329.0",            false, 0, "unexpected character", 5 },
+        { "328.9 329.0",            false, 1, "expected ','",         6 },
+        { "328.9,-",                false, 1, "sign without digits",  6 },
+        { "3276.7,3276.8",          false, 1, "value out of range",   7 },
+        { "",                       false, 0, "no values",            0 },
+        { " \r\n",                  false, 0, "no values",            3 },
+    };
+    static HeadingBuffer buf;
+    HeadingParser        p;
+    for (const auto& c : CASES) {
+        p.begin(&buf);
+        p.feed(c.body, strlen(c.body));
+        bool ok = p.finish();
+        TEST_ASSERT_EQUAL_MESSAGE(c.ok, ok, c.body);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(c.count, buf.count, c.body);
+        if (!c.ok) {
+            TEST_ASSERT_NOT_NULL_MESSAGE(p.error(), c.body);
+            TEST_ASSERT_EQUAL_STRING_MESSAGE(c.error, p.error(), c.body);
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(c.at, p.error_offset(), c.body);
+        }
+    }
+
+    // Rounding and sign of the values above.
+    p.begin(&buf);
+    p.feed("328.94,328.95,-0.05", 19);
+    p.finish();
+    TEST_ASSERT_EQUAL_INT16(3289, buf.data[0]);
+    TEST_ASSERT_EQUAL_INT16(3290, buf.data[1]);
+    TEST_ASSERT_EQUAL_INT16(-1, buf.data[2]);
+}
+
+// Every two-chunk split of a body gives the same values.
+static void test_parser_splits() {
+    static HeadingBuffer buf;
+    HeadingParser        p;
+    const char*          body = "  331.25, -12.5 ,0,359.99,\n3276.7,";
+    size_t               len  = strlen(body);
+    p.begin(&buf);
+    p.feed(body, len);
+    TEST_ASSERT_TRUE(p.finish());
+    TEST_ASSERT_EQUAL_UINT32(5, buf.count);
+    int16_t ref[5];
+    memcpy(ref, buf.data, sizeof(ref));
+    char msg[24];
+    for (size_t cut = 0; cut <= len; cut++) {
+        p.begin(&buf);
+        p.feed(body, cut);
+        p.feed(body + cut, len - cut);
+        snprintf(msg, sizeof(msg), "split at %u", (unsigned)cut);
+        TEST_ASSERT_TRUE_MESSAGE(p.finish(), msg);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(5, buf.count, msg);
+        TEST_ASSERT_EQUAL_INT16_ARRAY_MESSAGE(ref, buf.data, 5, msg);
+    }
+}
+
+// Count limit: SEQ_MAX_ENTRIES values pass, one more does not.
+static void test_parser_count_limit() {
+    static HeadingBuffer buf;
+    static char          big[SEQ_MAX_ENTRIES * 6 + 16];
+    HeadingParser        p;
+    size_t               n = 0;
+    for (size_t i = 0; i < SEQ_MAX_ENTRIES; i++)
+        n += (size_t)snprintf(big + n, sizeof(big) - n, "%s%u.5", i ? "," : "",
+                              (unsigned)(i % 360));
+    p.begin(&buf);
+    p.feed(big, n);
+    TEST_ASSERT_TRUE_MESSAGE(p.finish(), p.error());
+    TEST_ASSERT_EQUAL_UINT32(SEQ_MAX_ENTRIES, buf.count);
+    n += (size_t)snprintf(big + n, sizeof(big) - n, ",1.0");
+    p.begin(&buf);
+    p.feed(big, n);
+    TEST_ASSERT_FALSE(p.finish());
+    TEST_ASSERT_EQUAL_STRING("too many values", p.error());
+}
+
+// Values written as a body, through the parser, SequencePlayer and an
+// HDT-only Talker, against what the original toFloat() and snprintf("%.1f")
+// sent for each: exact and near ties at two to six decimals, signed zeros,
+// the int16 limit, and every centi-degree in ±360°.
+static void check_upload_chain(const char* const* values, size_t n) {
+    static char          body[SEQ_MAX_ENTRIES * 12];
+    static HeadingBuffer buf;
+    size_t               len = 0;
+    for (size_t i = 0; i < n; i++)
+        len += (size_t)snprintf(body + len, sizeof(body) - len, "%s%s", i ? "," : "",
+                                values[i]);
+    HeadingParser p;
+    p.begin(&buf);
+    p.feed(body, len);
+    TEST_ASSERT_TRUE_MESSAGE(p.finish(), p.error());
+    TEST_ASSERT_EQUAL_UINT32(n, buf.count);
+
+    HeadingTable tbl = {};
+    tbl.deci  = buf.data;
+    tbl.count = buf.count;
+    SequencePlayer player;
+    Talker         talker;
+    player.begin(&tbl);
+    talker.begin(TalkerMix{{ 1, 0, 0, 0 }}, 100, 9600);
+
+    char burst[TALKER_BURST_MAX];
+    char ref[NMEA_HDT_MAX];
+    for (size_t i = 0; i < n; i++) {
+        HeadingTick t = {};
+        player.next_heading(&t);
+        size_t got = talker.tick(t, burst);
+        burst[got] = '\0';
+        makeHDT_snprintf(String(values[i]).toFloat(), ref);
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(ref, burst, values[i]);
+    }
+}
+
+static void test_upload_matches_snprintf() {
+    static const char* const EDGES[] = {
+        "10", "20.25", "30.35", "-0.04", "400", "12.25", "0.35", "-359.65",
+        "0.05", "-0.05", "0.15", "0.25", "-1.25", "331.45", "331.4500001",
+        "331.4499999", "2.675", "2.6750", "1.005", "3276.7", "3276.749",
+        "-3276.7", "-0", "-0.0", "+0", "0", ".25", "-.04", "+12.35",
+        "0.0500000000000000000000000001", "359.949", "359.95", "359.951",
+    };
+    check_upload_chain(EDGES, sizeof(EDGES) / sizeof(EDGES[0]));
+
+    static char        text[72001][10];
+    static const char* values[SEQ_MAX_ENTRIES];
+    for (int32_t c = -36000; c <= 36000; c++) {
+        int32_t a = c < 0 ? -c : c;
+        snprintf(text[c + 36000], sizeof(text[0]), "%s%d.%02d", c < 0 ? "-" : "",
+                 (int)(a / 100), (int)(a % 100));
+    }
+    for (size_t first = 0; first < 72001; first += SEQ_MAX_ENTRIES) {
+        size_t n = 72001 - first < SEQ_MAX_ENTRIES ? 72001 - first : SEQ_MAX_ENTRIES;
+        for (size_t i = 0; i < n; i++)
+            values[i] = text[first + i];
+        check_upload_chain(values, n);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Default table
+// ---------------------------------------------------------------------------
+
+static void test_default_table() {
+    TEST_ASSERT_EQUAL_UINT32(128, DEFAULT_COUNT);
+    TEST_ASSERT_EQUAL_UINT32(DEFAULT_COUNT * DEFAULT_STRIDE, sizeof(DEFAULT_IMAGE.bytes));
+    char msg[16];
+    for (size_t i = 0; i < DEFAULT_COUNT; i++) {
+        const char* s = DEFAULT_IMAGE.bytes + i * DEFAULT_STRIDE;
+        snprintf(msg, sizeof(msg), "entry %u", (unsigned)i);
+        TEST_ASSERT_TRUE_MESSAGE(checksum_ok(s, DEFAULT_STRIDE), msg);
+
+        // h(i) = 330 + 2 sin(0.08 i - 0.5663), truncated to 0.1°.
+        int16_t want = (int16_t)((330.0 + 2.0 * sin(0.08 * (double)i - 0.5663)) * 10.0);
+        TEST_ASSERT_EQUAL_INT16_MESSAGE(want, DEFAULT_DECI.values[i], msg);
+
+        char out[NMEA_HDT_MAX];
+        makeHDTFixed(DEFAULT_DECI.values[i], out);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(s, out, DEFAULT_STRIDE, msg);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Golden streams
+// ---------------------------------------------------------------------------
+
+static HeadingTable   default_table;
+static HeadingBuffer  upload_buf;
+static HeadingTable   upload_table;
+static HeadingBuffer  ties_buf;
+static HeadingTable   ties_table;
+static WaveGenerator  wave;
+static HeadingTable   wave_table;
+static KeyframeTrack  track;
+static HeadingTable   key_table;
+
+static void setup_tables() {
+    default_table = {};
+    default_table.image  = DEFAULT_IMAGE.bytes;
+    default_table.stride = DEFAULT_STRIDE;
+    default_table.deci   = DEFAULT_DECI.values;
+    default_table.count  = DEFAULT_COUNT;
+
+    // 125 headings as the knob page sends them, crossing north.
+    char   body[1024];
+    size_t len = 0;
+    for (int i = 0; i < 125; i++)
+        len += (size_t)snprintf(body + len, sizeof(body) - len, "%s%.1f", i ? "," : "",
+                                fmod(350.0 + 0.37 * i, 360.0));
+    HeadingParser p;
+    p.begin(&upload_buf);
+    p.feed(body, len);
+    p.finish();
+    upload_table = {};
+    upload_table.deci  = upload_buf.data;
+    upload_table.count = upload_buf.count;
+
+    // Ties, a negative zero and a value past 360, which the original
+    // formatter sent as 20.2, 30.4 and -0.0 (check_upload_chain()).
+    static const char TIES[] = "10,20.25,30.35,-0.04,400";
+    p.begin(&ties_buf);
+    p.feed(TIES, sizeof(TIES) - 1);
+    p.finish();
+    ties_table = {};
+    ties_table.deci  = ties_buf.data;
+    ties_table.count = ties_buf.count;
+
+    WaveParams w = {};
+    w.shape       = WAVE_SINE;
+    w.centre_deci = 3300;
+    w.amp_deci    = 100;
+    w.periods     = 2;
+    w.length      = 250;
+    wave.configure(w);
+    wave_table = {};
+    wave_table.wave  = &wave;
+    wave_table.count = w.length;
+
+    track.clear();
+    track.add(0, 3500);
+    track.add(4000, 100);
+    track.add(7000, 3550);
+    track.add(12000, 3400);
+    track.configure(KEY_CUBIC, true, 100);
+    key_table = {};
+    key_table.keys  = &track;
+    key_table.count = track.ticks();
+}
+
+struct Scenario {
+    const char*         name;
+    const HeadingTable* table;
+    TalkerMix           mix;
+    uint32_t            baud;
+    uint32_t            ticks;
+};
+
+static const TalkerMix HDT_ONLY = {{ 1, 0, 0, 0 }};
+static const TalkerMix FULL_MIX = {{ 1, 1, 5, 10 }};
+
+static const Scenario SCENARIOS[] = {
+    { "default",         &default_table, HDT_ONLY, 9600,   1000 },
+    { "default-mix",     &default_table, FULL_MIX, 38400,  1000 },
+    { "default-mix-4800", &default_table, FULL_MIX, 4800,  1000 },   // deferrals
+    { "upload",          &upload_table,  HDT_ONLY, 9600,   1000 },
+    { "upload-mix",      &upload_table,  FULL_MIX, 38400,  1000 },
+    { "upload-ties",     &ties_table,    HDT_ONLY, 9600,   1000 },
+    { "wave-sine",       &wave_table,    HDT_ONLY, 9600,   1000 },
+    { "keys-cubic",      &key_table,     FULL_MIX, 38400,  1000 },
+};
+static const size_t SCENARIO_COUNT = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+struct Golden {
+    const char* name;
+    uint32_t    bytes;
+    uint64_t    fnv;
+};
+
+// See the header for how to re-record after an intended change of output.
+static const Golden GOLDEN[] = {
+    { "default",           19000, 0x9ac5c16a19d7657bull },
+    { "default-mix",       43781, 0x9905a0dff976c8f8ull },
+    { "default-mix-4800",  38000, 0xf2db29b35a275a47ull },
+    { "upload",            18016, 0x6f44a3e4afa74be5ull },
+    { "upload-mix",        41848, 0xc7b931f78358d978ull },
+    { "upload-ties",       18200, 0x38108c18920f02adull },
+    { "wave-sine",         19000, 0xfec6f5e180d51035ull },
+    { "keys-cubic",        42458, 0x525a72ef5bc3f7efull },
+};
+
+static uint64_t fnv1a(uint64_t h, const char* p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        h ^= (uint8_t)p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+// The bytes a scenario sends, as the TX task would: one next_heading() and
+// one talker tick per interval.
+static void run_stream(const Scenario& s, uint32_t* bytes, uint64_t* fnv, FILE* dump) {
+    static SequencePlayer player;
+    static Talker         talker;
+    player.begin(s.table);
+    talker.begin(s.mix, 100, s.baud);
+
+    char     burst[TALKER_BURST_MAX];
+    uint64_t h = 0xcbf29ce484222325ull;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < s.ticks; i++) {
+        HeadingTick t = {};
+        player.next_heading(&t);
+        size_t len = talker.tick(t, burst);
+        h  = fnv1a(h, burst, len);
+        n += (uint32_t)len;
+        if (dump)
+            fwrite(burst, 1, len, dump);
+    }
+    *bytes = n;
+    *fnv   = h;
+}
+
+static void test_golden_streams() {
+    size_t differ = 0;
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        const Scenario& s = SCENARIOS[i];
+        uint32_t        bytes;
+        uint64_t        fnv;
+        run_stream(s, &bytes, &fnv, nullptr);
+
+        const Golden* g = nullptr;
+        for (const Golden& c : GOLDEN)
+            if (strcmp(c.name, s.name) == 0)
+                g = &c;
+        if (g && g->bytes == bytes && g->fnv == fnv)
+            continue;
+
+        differ++;
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/test_output-%s.nmea", s.name);
+        FILE* dump = fopen(path, "wb");
+        if (dump) {
+            run_stream(s, &bytes, &fnv, dump);
+            fclose(dump);
+        }
+        char name[24];
+        snprintf(name, sizeof(name), "\"%s\",", s.name);
+        printf("stream %s differs, written to %s; now:\n    { %-19s %6u, 0x%016llxull },\n",
+               s.name, path, name, (unsigned)bytes, (unsigned long long)fnv);
+    }
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, differ, "streams differing from GOLDEN[]");
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------------------
+
+static double ns_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static volatile uint8_t sink;
+
+static void bench_tx() {
+    printf("\n%-18s %10s\n", "TX path", "ns/tick");
+    const uint32_t TICKS = 200000;
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        const Scenario& s = SCENARIOS[i];
+        SequencePlayer  player;
+        Talker          talker;
+        player.begin(s.table);
+        talker.begin(s.mix, 100, s.baud);
+
+        char burst[TALKER_BURST_MAX];
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint32_t k = 0; k < TICKS; k++) {
+            HeadingTick t = {};
+            player.next_heading(&t);
+            sink = (uint8_t)talker.tick(t, burst);
+        }
+        printf("%-18s %10.1f\n", s.name, ns_since(t0) / TICKS);
+    }
+}
+
+static void bench_upload() {
+    printf("\n%-18s %10s %10s %12s\n", "/update body", "bytes", "us/upload", "allocs/upload");
+    static const size_t SIZES[] = { 125, 1000, SEQ_MAX_ENTRIES };
+    static char         body[SEQ_MAX_ENTRIES * 7];
+    for (size_t count : SIZES) {
+        size_t len = 0;
+        for (size_t i = 0; i < count; i++)
+            len += (size_t)snprintf(body + len, sizeof(body) - len, "%s%.1f", i ? "," : "",
+                                    330.0 + 2.0 * sin((double)i * 0.05));
+
+        // A fresh buffer each time, as after an upload into the other bank
+        // of a different size; fed in TCP-segment chunks.
+        const int ITERS = count > 1000 ? 20 : 2000;
+        size_t    allocs = 0;
+        double    ns     = 0;
+        for (int it = 0; it < ITERS; it++) {
+            HeadingBuffer buf;
+            HeadingParser p;
+            size_t        a0 = heap_allocs;
+            auto          t0 = std::chrono::steady_clock::now();
+            p.begin(&buf);
+            for (size_t off = 0; off < len; off += 1436)
+                p.feed(body + off, len - off < 1436 ? len - off : 1436);
+            p.finish();
+            buf.shrink();
+            ns     += ns_since(t0);
+            allocs += heap_allocs - a0;
+            free(buf.data);
+        }
+        char name[24];
+        snprintf(name, sizeof(name), "%u values", (unsigned)count);
+        printf("%-18s %10u %10.1f %12.1f\n", name, (unsigned)len, ns / ITERS / 1e3,
+               (double)allocs / ITERS);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main() {
+    setup_tables();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_tenths_matches_snprintf);
+    RUN_TEST(test_hdt_fixed_checksums);
+    RUN_TEST(test_retag);
+    RUN_TEST(test_parser_cases);
+    RUN_TEST(test_parser_splits);
+    RUN_TEST(test_parser_count_limit);
+    RUN_TEST(test_upload_matches_snprintf);
+    RUN_TEST(test_default_table);
+    RUN_TEST(test_golden_streams);
+    int failures = UNITY_END();
+
+    bench_tx();
+    bench_upload();
+    return failures;
+}
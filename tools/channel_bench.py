@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""
+channel_bench.py
+
+Check that output channels do not pace one another: capture channel 0 and
+channel 1 at the same time while channel 1's rate, sentence mix and
+(on ptys) baud rate are changed through /channel, and report the HDT
+spacing of each.
+
+Works against a board built with NMEA_CHANNELS=2 (USB-TTL dongles on
+GPIO 4 and the channel 1 TX pin) or the host build (`.pio/build/native/
+program --realtime`, which prints a pty for UART1 and one for UART2).
+
+Channel 1 is switched to its own mode and then steps through --ch1-rates,
+one phase of --seconds each; every other phase also sends THS and ROT, so
+the burst size changes as well.  Channel 0's jitter is taken over the
+whole run, channel 1's per phase against that phase's interval; the first
+gap after each change is left out, since the change itself lands between
+two ticks.  --ch1-bauds gives a baud rate per phase; a pty ignores the
+line speed, so use it with the host build only.
+
+With --max-jitter-ms the script exits non-zero when any p99 jitter exceeds
+the limit.
+
+Usage:
+  tools/channel_bench.py --port /dev/ttyUSB0 --port2 /dev/ttyUSB1 --url http://192.168.4.1
+  tools/channel_bench.py --port /dev/pts/3 --port2 /dev/pts/4 --url http://127.0.0.1:8080 \\
+      --ch1-rates 20,5,50 --ch1-bauds 115200,9600,38400 --max-jitter-ms 2
+"""
+
+import argparse
+import os
+import sys
+import threading
+import time
+import urllib.request
+
+from jitter_bench import BAUD, open_uart, percentile
+
+
+def capture_hdt(fd, stop, out):
+    """Append (arrival time, talker) of every ...HDT sentence start to `out`."""
+    pending = b''
+    while not stop.is_set():
+        chunk = os.read(fd, 256)
+        now = time.monotonic()
+        pending += chunk
+        while True:
+            start = pending.find(b'$')
+            if start < 0 or len(pending) - start < 6:
+                pending = pending[start:] if start >= 0 else b''
+                break
+            head = pending[start + 1:start + 6]
+            if head[2:] == b'HDT':
+                out.append((now, head[:2].decode(errors='replace')))
+            pending = pending[start + 1:]
+
+
+def channel(url, query):
+    req = urllib.request.Request('%s/channel?%s' % (url, query), data=b'', method='POST')
+    with urllib.request.urlopen(req, timeout=5) as r:
+        return r.read().decode()
+
+
+def jitter(name, stamps, nominal_ms):
+    gaps = sorted((b - a) * 1000 for a, b in zip(stamps, stamps[1:]))
+    if not gaps:
+        print('%-10s no sentences' % name)
+        return float('inf')
+    dev = sorted(abs(g - nominal_ms) for g in gaps)
+    print('%-10s n=%-4d interval %6.1f ms  p50 %.2f  min %.2f  max %.2f ms  '
+          '|jitter| p99 %.2f  max %.2f ms'
+          % (name, len(gaps), nominal_ms, percentile(gaps, 50), gaps[0], gaps[-1],
+             percentile(dev, 99), dev[-1]))
+    return percentile(dev, 99)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('--port', required=True, help='channel 0 UART device or pty')
+    ap.add_argument('--port2', required=True, help='channel 1 UART device or pty')
+    ap.add_argument('--baud', type=int, default=9600, choices=sorted(BAUD),
+                    help='channel 0 baud rate')
+    ap.add_argument('--url', default='http://192.168.4.1')
+    ap.add_argument('--interval-ms', type=float, default=100.0,
+                    help='channel 0 interval')
+    ap.add_argument('--ch1-rates', default='20,5,50', help='channel 1 rate (Hz) per phase')
+    ap.add_argument('--ch1-bauds', help='channel 1 baud rate per phase (ptys only)')
+    ap.add_argument('--seconds', type=float, default=5.0, help='length of each phase')
+    ap.add_argument('--max-jitter-ms', type=float,
+                    help='fail if any p99 |jitter| exceeds this')
+    args = ap.parse_args()
+
+    rates = [int(r) for r in args.ch1_rates.split(',')]
+    bauds = [int(b) for b in args.ch1_bauds.split(',')] if args.ch1_bauds else None
+    if bauds and len(bauds) != len(rates):
+        ap.error('--ch1-bauds needs one baud rate per phase')
+    baud1 = bauds[0] if bauds else 38400
+
+    channel(args.url, 'ch=1&enable=1&rate=%d&baud=%d&hdt=1&ths=0&rot=0&talker=HC'
+            % (rates[0], baud1))
+    fd0 = open_uart(args.port, args.baud)
+    fd1 = open_uart(args.port2, baud1)
+
+    stop = threading.Event()
+    got0, got1 = [], []
+    readers = [threading.Thread(target=capture_hdt, args=(fd, stop, out), daemon=True)
+               for fd, out in ((fd0, got0), (fd1, got1))]
+    for r in readers:
+        r.start()
+
+    # Phase boundaries as offsets into got1, and the settings of each.
+    phases = []
+    for i, rate in enumerate(rates):
+        if i:
+            mix = 'ths=1&rot=2' if i % 2 else 'ths=0&rot=0'
+            query = 'ch=1&rate=%d&%s' % (rate, mix)
+            if bauds:
+                query += '&baud=%d' % bauds[i]
+            channel(args.url, query)
+        phases.append((len(got1), rate))
+        time.sleep(args.seconds)
+    stop.set()
+    end1 = len(got1)
+    print(channel(args.url, '').strip())
+
+    worst = jitter('ch0', [t for t, _ in got0[1:]], args.interval_ms)
+    for i, (start, rate) in enumerate(phases):
+        stop_at = phases[i + 1][0] if i + 1 < len(phases) else end1
+        stamps = [t for t, _ in got1[start + 1:stop_at]]
+        name = 'ch1 %dHz' % rate + (' %d' % bauds[i] if bauds else '')
+        worst = max(worst, jitter(name, stamps, 1000.0 / rate))
+
+    if args.max_jitter_ms is not None:
+        ok = worst <= args.max_jitter_ms
+        print('%s: p99 |jitter| %.2f ms, limit %.2f ms'
+              % ('PASS' if ok else 'FAIL', worst, args.max_jitter_ms))
+        sys.exit(0 if ok else 1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""
+gzip_pages.py
+
+Build step: compress the HTML pages for serving.
+
+Reads the readable pages from src/web_page.h and src/func_page.h (the
+R"html( ... )html" raw string in each), gzips them and writes
+src/web_assets.h with, per page, the compressed bytes, their length and an
+ETag derived from the page content.  The file is only rewritten when its
+content changes, so an unchanged page does not trigger a rebuild.
+
+Runs automatically as a PlatformIO pre-build script (extra_scripts in
+platformio.ini); it can also be run by hand from the repository root:
+
+  tools/gzip_pages.py
+"""
+
+import gzip
+import hashlib
+import os
+import re
+
+PAGES = [
+    # (source header, prefix of the generated symbols)
+    ('web_page.h',  'WEB_PAGE'),
+    ('func_page.h', 'FUNC_PAGE'),
+]
+
+RAW_STRING = re.compile(r'R"html\((.*?)\)html"', re.S)
+
+
+def extract(path):
+    with open(path, encoding='utf-8') as f:
+        m = RAW_STRING.search(f.read())
+    if not m:
+        raise SystemExit('%s: no R"html( ... )html" page found' % path)
+    return m.group(1).encode('utf-8')
+
+
+def c_array(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append('    ' + ', '.join('0x%02x' % b for b in data[i:i + 16]) + ',')
+    return '\n'.join(lines)
+
+
+def generate(src_dir):
+    out = [
+        '#pragma once',
+        '',
+        '/*',
+        ' * web_assets.h',
+        ' *',
+        ' * GENERATED by tools/gzip_pages.py from web_page.h and func_page.h at',
+        ' * build time - do not edit, edit the readable pages instead.',
+        ' *',
+        ' * Each page as gzip bytes (sent with Content-Encoding: gzip) and a',
+        ' * strong ETag computed from the uncompressed page.',
+        ' */',
+        '',
+        '#include <Arduino.h>',
+        '',
+    ]
+    report = []
+    for header, prefix in PAGES:
+        page = extract(os.path.join(src_dir, header))
+        gz = gzip.compress(page, compresslevel=9, mtime=0)
+        etag = hashlib.sha1(page).hexdigest()[:16]
+        out += [
+            '// %s: %d bytes, %d gzip' % (header, len(page), len(gz)),
+            'static const uint8_t %s_GZ[] = {' % prefix,
+            c_array(gz),
+            '};',
+            'static const size_t  %s_GZ_LEN  = %d;' % (prefix, len(gz)),
+            'static const size_t  %s_RAW_LEN = %d;' % (prefix, len(page)),
+            'static const char    %s_ETAG[]  = "\\"%s\\"";' % (prefix, etag),
+            '',
+        ]
+        report.append('%-12s %6d -> %5d bytes gzip (-%d %%)'
+                      % (header, len(page), len(gz), 100 - 100 * len(gz) // len(page)))
+    return '\n'.join(out), report
+
+
+def main(src_dir):
+    text, report = generate(src_dir)
+    target = os.path.join(src_dir, 'web_assets.h')
+    try:
+        with open(target, encoding='utf-8') as f:
+            unchanged = f.read() == text
+    except OSError:
+        unchanged = False
+    if not unchanged:
+        with open(target, 'w', encoding='utf-8') as f:
+            f.write(text)
+    for line in report:
+        print('gzip_pages: ' + line)
+
+
+try:
+    Import('env')                       # noqa: F821 - running under SCons
+    main(env.subst('$PROJECT_SRC_DIR'))  # noqa: F821
+except NameError:
+    if __name__ == '__main__':
+        main(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'src'))
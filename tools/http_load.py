@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+"""
+http_load.py
+
+HTTP load test: request latency percentiles under concurrent clients.
+
+Runs N client threads for T seconds against the emulator.  Each client
+loops over a request mix and times every request from connect to the last
+response byte:
+
+  line     GET /line                          (small API answer)
+  page     GET / with If-None-Match: <ETag>   (304 revalidation)
+  update   POST /update, 125 headings         (streamed body, parser)
+
+With --slow-upload one extra client keeps a /update body trickling in for
+the whole run; a server that handled one request at a time would stall
+every other client behind it.  Such a client holds the single upload slot,
+so the other clients' uploads are answered 503 (counted as "busy", not as
+errors).
+
+Reports count, errors and p50 / p90 / p99 / max latency per request type,
+and the overall request rate.  Works against a board or the host build:
+
+  tools/http_load.py --url http://192.168.4.1 --clients 4
+  tools/http_load.py --url http://127.0.0.1:8080 --clients 16 --seconds 10 --slow-upload
+
+Pass --max-p99-ms to exit with status 1 when any p99 is above it.
+"""
+
+import argparse
+import socket
+import sys
+import threading
+import time
+import urllib.parse
+
+UPLOAD = ','.join('%.1f' % (330 + (i % 20) * 0.5) for i in range(125)).encode()
+
+
+def request(host, port, method, path, headers=None, body=b''):
+    """Return (status, response headers dict); raise on a network error."""
+    req = '%s %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n' % (method, path, host)
+    for name, value in (headers or {}).items():
+        req += '%s: %s\r\n' % (name, value)
+    if body or method == 'POST':
+        req += 'Content-Length: %d\r\n' % len(body)
+    s = socket.create_connection((host, port), timeout=10)
+    try:
+        s.sendall(req.encode() + b'\r\n' + body)
+        data = b''
+        while True:
+            chunk = s.recv(65536)
+            if not chunk:
+                break
+            data += chunk
+    finally:
+        s.close()
+    head = data.partition(b'\r\n\r\n')[0].decode('latin-1').split('\r\n')
+    if not head[0].startswith('HTTP/'):
+        raise IOError('no HTTP response')
+    hdrs = {}
+    for line in head[1:]:
+        name, _, value = line.partition(':')
+        hdrs[name.strip().lower()] = value.strip()
+    return int(head[0].split()[1]), hdrs
+
+
+def pct(vals, p):
+    vals = sorted(vals)
+    return vals[min(len(vals) - 1, int(round(p / 100.0 * (len(vals) - 1))))]
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.times = {}         # kind -> [seconds]
+        self.errors = {}        # kind -> count
+        self.busy = {}          # kind -> 503 count
+
+    def add(self, kind, dt=None, error=False, busy=False):
+        with self.lock:
+            self.times.setdefault(kind, [])
+            self.errors.setdefault(kind, 0)
+            self.busy.setdefault(kind, 0)
+            if error:
+                self.errors[kind] += 1
+            elif busy:
+                self.busy[kind] += 1
+            else:
+                self.times[kind].append(dt)
+
+
+def client(host, port, etag, mix, stop, stats):
+    reqs = {
+        'line':   ('GET', '/line', {}, b''),
+        'page':   ('GET', '/', {'If-None-Match': etag}, b''),
+        'update': ('POST', '/update', {'Content-Type': 'text/plain'}, UPLOAD),
+    }
+    i = 0
+    while not stop.is_set():
+        kind = mix[i % len(mix)]
+        i += 1
+        method, path, hdrs, body = reqs[kind]
+        t0 = time.monotonic()
+        try:
+            status, _ = request(host, port, method, path, hdrs, body)
+        except (OSError, ValueError, IndexError):
+            stats.add(kind, error=True)
+            continue
+        dt = time.monotonic() - t0
+        ok = {'line': 200, 'page': 304, 'update': 200}[kind]
+        if status == 503 and kind == 'update':
+            stats.add(kind, busy=True)
+        else:
+            stats.add(kind, dt, error=status != ok)
+
+
+def slow_upload(host, port, stop, seconds):
+    """Send one /update body a few bytes at a time over the whole run."""
+    try:
+        s = socket.create_connection((host, port), timeout=seconds + 10)
+        s.sendall(('POST /update HTTP/1.1\r\nHost: %s\r\nContent-Type: text/plain\r\n'
+                   'Content-Length: %d\r\nConnection: close\r\n\r\n'
+                   % (host, len(UPLOAD))).encode())
+        step = max(1, len(UPLOAD) * 0.05 // seconds)
+        sent = 0
+        while sent < len(UPLOAD) - 1 and not stop.is_set():
+            s.sendall(UPLOAD[sent:sent + int(step)])
+            sent += int(step)
+            time.sleep(0.05)
+        s.sendall(UPLOAD[sent:])
+        s.recv(4096)
+        s.close()
+    except OSError as e:
+        print('slow upload: %s' % e, file=sys.stderr)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('--url', default='http://192.168.4.1')
+    ap.add_argument('--clients', type=int, default=8)
+    ap.add_argument('--seconds', type=float, default=5)
+    ap.add_argument('--mix', default='line,page,line,update',
+                    help='comma-separated request kinds each client cycles through')
+    ap.add_argument('--slow-upload', action='store_true',
+                    help='keep one upload body trickling in during the run')
+    ap.add_argument('--max-p99-ms', type=float, default=0,
+                    help='fail (exit 1) if any p99 latency is above this')
+    args = ap.parse_args()
+
+    u = urllib.parse.urlparse(args.url)
+    host, port = u.hostname, u.port or 80
+    mix = args.mix.split(',')
+
+    _, hdrs = request(host, port, 'GET', '/')
+    etag = hdrs.get('etag', '')
+
+    stats = Stats()
+    stop = threading.Event()
+    threads = [threading.Thread(target=client, args=(host, port, etag, mix[k % len(mix):] +
+                                                     mix[:k % len(mix)], stop, stats))
+               for k in range(args.clients)]
+    if args.slow_upload:
+        threads.append(threading.Thread(target=slow_upload,
+                                        args=(host, port, stop, args.seconds)))
+    t0 = time.monotonic()
+    for t in threads:
+        t.start()
+    time.sleep(args.seconds)
+    stop.set()
+    for t in threads:
+        t.join()
+    elapsed = time.monotonic() - t0
+
+    total = sum(len(v) for v in stats.times.values())
+    print('%d clients, %.1f s%s: %d requests, %.1f req/s'
+          % (args.clients, elapsed, ', slow upload' if args.slow_upload else '',
+             total, total / elapsed))
+    print('  %-7s %6s %6s %5s   %7s %7s %7s %7s ms'
+          % ('', 'ok', 'errors', 'busy', 'p50', 'p90', 'p99', 'max'))
+    worst = 0.0
+    for kind in sorted(stats.times):
+        t = stats.times[kind]
+        if t:
+            p = [pct(t, 50) * 1e3, pct(t, 90) * 1e3, pct(t, 99) * 1e3, max(t) * 1e3]
+            worst = max(worst, p[2])
+            print('  %-7s %6d %6d %5d   %7.2f %7.2f %7.2f %7.2f'
+                  % ((kind, len(t), stats.errors[kind], stats.busy[kind]) + tuple(p)))
+        else:
+            print('  %-7s %6d %6d %5d' % (kind, 0, stats.errors[kind], stats.busy[kind]))
+
+    errors = sum(stats.errors.values())
+    if args.max_p99_ms:
+        ok = worst <= args.max_p99_ms and errors == 0
+        print('%s: worst p99 %.2f ms (limit %.2f), %d errors'
+              % ('PASS' if ok else 'FAIL', worst, args.max_p99_ms, errors))
+        sys.exit(0 if ok else 1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""
+jitter_bench.py
+
+Measure NMEA sentence spacing on the UART while hammering the web server
+with parallel HTTP requests.
+
+Works against a board (USB-TTL dongle on GPIO 4, AP at 192.168.4.1) or the
+host build (`.pio/build/native/program --realtime`, pty path and port 8080).
+
+Each run first records an idle baseline, then the same number of sentences
+with N threads issuing GET / and POST /update back to back, and prints
+interval percentiles and jitter (deviation from the nominal interval) for
+both phases.
+
+With --rate the emulator is first switched to that output rate and --baud
+through /line (e.g. the 50 Hz / 38400 baud IEC 61162-2 mode).  With
+--rate-steps N a third phase then alternates the rate alone between
+--rate and half of it, N times, while capturing: the baud is unchanged,
+so no change may wait for the line to drain, and every interval must be
+one of the two nominal ones.  With --max-jitter-ms the script exits
+non-zero when the p99 jitter of any phase exceeds the limit, so it can
+serve as a pass/fail timing test.
+
+Usage:
+  tools/jitter_bench.py --port /dev/ttyUSB0 --url http://192.168.4.1
+  tools/jitter_bench.py --port /dev/pts/3   --url http://127.0.0.1:8080
+  tools/jitter_bench.py --port /dev/pts/3   --url http://127.0.0.1:8080 \
+      --baud 38400 --rate 50 --max-jitter-ms 2
+  tools/jitter_bench.py --port /dev/pts/3   --url http://127.0.0.1:8080 \
+      --baud 38400 --rate 50 --rate-steps 20 --max-jitter-ms 2
+"""
+
+import argparse
+import os
+import sys
+import termios
+import threading
+import time
+import urllib.request
+
+BAUD = {4800: termios.B4800, 9600: termios.B9600, 19200: termios.B19200,
+        38400: termios.B38400, 57600: termios.B57600, 115200: termios.B115200}
+
+
+def open_uart(path, baud):
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+    attrs = termios.tcgetattr(fd)
+    # raw 8N1
+    attrs[0] = 0
+    attrs[1] = 0
+    attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+    attrs[3] = 0
+    attrs[4] = attrs[5] = BAUD[baud]
+    attrs[6][termios.VMIN] = 1
+    attrs[6][termios.VTIME] = 0
+    termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    termios.tcflush(fd, termios.TCIFLUSH)
+    return fd
+
+
+def capture(fd, count):
+    """Return arrival times (s) of the '$' that starts each sentence."""
+    stamps = []
+    while len(stamps) < count:
+        chunk = os.read(fd, 256)
+        now = time.monotonic()
+        stamps.extend(now for b in chunk if b == ord('$'))
+    return stamps[:count]
+
+
+def capture_while(fd, thread):
+    """Arrival times of the sentence starts until `thread` has finished."""
+    stamps = []
+    while thread.is_alive():
+        chunk = os.read(fd, 256)
+        now = time.monotonic()
+        stamps.extend(now for b in chunk if b == ord('$'))
+    return stamps
+
+
+def load_worker(url, stop, counts):
+    body = ','.join('%.1f' % (i * 2.5 % 360) for i in range(125)).encode()
+    while not stop.is_set():
+        try:
+            urllib.request.urlopen(url + '/', timeout=5).read()
+            req = urllib.request.Request(url + '/update', data=body,
+                                         headers={'Content-Type': 'text/plain'})
+            urllib.request.urlopen(req, timeout=5).read()
+            counts[0] += 2
+        except OSError:
+            counts[1] += 1
+
+
+def percentile(sorted_vals, p):
+    k = min(len(sorted_vals) - 1, int(round(p / 100.0 * (len(sorted_vals) - 1))))
+    return sorted_vals[k]
+
+
+def report(name, stamps, *nominal_ms):
+    """Jitter is the deviation from the nearest of the nominal intervals."""
+    gaps = sorted((b - a) * 1000 for a, b in zip(stamps, stamps[1:]))
+    jitter = sorted(min(abs(g - n) for n in nominal_ms) for g in gaps)
+    print('%-6s n=%d  interval p50 %.2f  p99 %.2f  min %.2f  max %.2f ms  '
+          '|jitter| p99 %.2f  max %.2f ms'
+          % (name, len(gaps), percentile(gaps, 50), percentile(gaps, 99),
+             gaps[0], gaps[-1], percentile(jitter, 99), jitter[-1]))
+    return percentile(jitter, 99)
+
+
+def set_line(url, baud, rate, quiet=False):
+    """Switch the emulator's output settings; raises on rejection.
+    With baud None only the rate is sent."""
+    query = 'rate=%d' % rate if baud is None else 'baud=%d&rate=%d' % (baud, rate)
+    req = urllib.request.Request('%s/line?%s' % (url, query), data=b'', method='POST')
+    with urllib.request.urlopen(req, timeout=5) as r:
+        reply = r.read().decode().strip()
+    if not quiet:
+        print('line: ' + reply)
+
+
+def rate_stepper(url, rates, steps, interval_s, done):
+    """Alternate the output rate alone, `steps` times."""
+    for i in range(steps):
+        time.sleep(interval_s)
+        set_line(url, None, rates[i % 2], quiet=True)
+        done[0] += 1
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('--port', required=True, help='UART device or pty path')
+    ap.add_argument('--baud', type=int, default=9600, choices=sorted(BAUD))
+    ap.add_argument('--url', default='http://192.168.4.1')
+    ap.add_argument('--sentences', type=int, default=300)
+    ap.add_argument('--threads', type=int, default=4)
+    ap.add_argument('--interval-ms', type=float, default=100.0)
+    ap.add_argument('--rate', type=int, help='set output rate (Hz) and --baud first')
+    ap.add_argument('--rate-steps', type=int, default=0,
+                    help='then alternate the rate alone (--rate and half of it) this many times')
+    ap.add_argument('--max-jitter-ms', type=float,
+                    help='fail if p99 |jitter| of any phase exceeds this')
+    args = ap.parse_args()
+    if args.rate_steps and not args.rate:
+        ap.error('--rate-steps needs --rate')
+
+    if args.rate:
+        set_line(args.url, args.baud, args.rate)
+        args.interval_ms = 1000.0 / args.rate
+
+    fd = open_uart(args.port, args.baud)
+    capture(fd, 2)                       # resynchronise on a sentence start
+
+    worst = report('idle', capture(fd, args.sentences), args.interval_ms)
+
+    stop = threading.Event()
+    counts = [0, 0]
+    workers = [threading.Thread(target=load_worker, args=(args.url, stop, counts), daemon=True)
+               for _ in range(args.threads)]
+    for w in workers:
+        w.start()
+    t0 = time.monotonic()
+    stamps = capture(fd, args.sentences)
+    elapsed = time.monotonic() - t0
+    stop.set()
+
+    worst = max(worst, report('load', stamps, args.interval_ms))
+    print('HTTP load: %d requests (%.1f/s), %d errors, %d threads'
+          % (counts[0], counts[0] / elapsed, counts[1], args.threads))
+
+    if args.rate_steps:
+        # One change every ten intervals of the slower rate, so each settles.
+        rates = (max(1, args.rate // 2), args.rate)
+        nominal = tuple(1000.0 / r for r in rates)
+        done = [0]
+        stepper = threading.Thread(target=rate_stepper,
+                                   args=(args.url, rates, args.rate_steps,
+                                         nominal[0] * 10 / 1000.0, done),
+                                   daemon=True)
+        stepper.start()
+        stamps = capture_while(fd, stepper)
+        if args.rate_steps % 2:
+            set_line(args.url, None, args.rate, quiet=True)
+        worst = max(worst, report('rates', stamps, *nominal))
+        print('rate changes: %d, baud %d unchanged' % (done[0], args.baud))
+
+    if args.max_jitter_ms is not None:
+        ok = worst <= args.max_jitter_ms
+        print('%s: p99 |jitter| %.2f ms, limit %.2f ms'
+              % ('PASS' if ok else 'FAIL', worst, args.max_jitter_ms))
+        sys.exit(0 if ok else 1)
+
+
+if __name__ == '__main__':
+    main()
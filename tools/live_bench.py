@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""
+live_bench.py
+
+Measure live-steer latency end to end: from sending a knob position over
+the /live WebSocket to its $HEHDT sentence arriving on the UART.
+
+Works against a board (USB-TTL dongle on GPIO 4, AP at 192.168.4.1) or the
+host build (`.pio/build/native/program --realtime`, pty path and port 8080).
+
+Two phases:
+
+  latency    --count positions, one at a time: send, then wait for the
+             first sentence carrying that heading.  Reports the measured
+             send -> sentence-complete time and the device's own
+             arrival -> on-the-wire figure from its ack, as percentiles.
+  coalesce   positions sent --flood-hz times a second for --flood-s
+             seconds; /live/stats then shows how many were transmitted
+             and how many were coalesced into a later one.
+
+Only HDT is matched, so any sentence mix works as long as HDT is on.
+
+Usage:
+  tools/live_bench.py --port /dev/ttyUSB0 --url http://192.168.4.1
+  tools/live_bench.py --port /dev/pts/3   --url http://127.0.0.1:8080 --count 100
+"""
+
+import argparse
+import base64
+import os
+import random
+import socket
+import struct
+import time
+import urllib.parse
+import urllib.request
+
+from jitter_bench import open_uart, percentile
+
+
+class WebSocket:
+    """Just enough of a client for binary frames."""
+
+    def __init__(self, host, port, path):
+        self.s = socket.create_connection((host, port), timeout=5)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.s.sendall(('GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\n'
+                        'Connection: Upgrade\r\nSec-WebSocket-Key: %s\r\n'
+                        'Sec-WebSocket-Version: 13\r\n\r\n' % (path, host, key)).encode())
+        head = b''
+        while b'\r\n\r\n' not in head:
+            chunk = self.s.recv(1)
+            if not chunk:
+                raise IOError('connection closed during handshake')
+            head += chunk
+        if b' 101 ' not in head.split(b'\r\n')[0]:
+            raise IOError('no WebSocket upgrade: %r' % head.split(b'\r\n')[0])
+        self.buf = b''
+
+    def send(self, payload):
+        mask = os.urandom(4)
+        data = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+        self.s.sendall(bytes([0x82, 0x80 | len(payload)]) + mask + data)
+
+    def recv(self, timeout):
+        """One frame's payload, or None on timeout."""
+        self.s.settimeout(timeout)
+        try:
+            while True:
+                if len(self.buf) >= 2:
+                    n = self.buf[1] & 0x7F
+                    if len(self.buf) >= 2 + n:
+                        payload, self.buf = self.buf[2:2 + n], self.buf[2 + n:]
+                        return payload
+                chunk = self.s.recv(4096)
+                if not chunk:
+                    raise IOError('connection closed')
+                self.buf += chunk
+        except socket.timeout:
+            return None
+
+    def close(self):
+        try:
+            self.s.sendall(b'\x88\x80' + os.urandom(4))
+        finally:
+            self.s.close()
+
+
+def heading_frame(seq, deci):
+    return struct.pack('<BBHh', ord('H'), 0, seq & 0xFFFF, deci)
+
+
+def wait_for(fd, text, timeout):
+    """Time the sentence containing `text` was complete, or None."""
+    line = b''
+    end = time.monotonic() + timeout
+    while time.monotonic() < end:
+        for b in os.read(fd, 256):
+            line += bytes([b])
+            if b == ord('\n'):
+                if text in line:
+                    return time.monotonic()
+                line = b''
+    return None
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('--port', required=True, help='UART device (or host pty)')
+    ap.add_argument('--baud', type=int, default=9600)
+    ap.add_argument('--url', default='http://192.168.4.1')
+    ap.add_argument('--count', type=int, default=50)
+    ap.add_argument('--flood-hz', type=float, default=200)
+    ap.add_argument('--flood-s', type=float, default=3)
+    args = ap.parse_args()
+
+    u = urllib.parse.urlparse(args.url)
+    host, port = u.hostname, u.port or 80
+    fd = open_uart(args.port, args.baud)
+    ws = WebSocket(host, port, '/live')
+
+    # --- latency: one position at a time ---
+    e2e, device, lost = [], [], 0
+    seq = 0
+    for i in range(args.count):
+        seq += 1
+        deci = random.randrange(3600)
+        text = ('$HEHDT,%d.%d,' % (deci // 10, deci % 10)).encode()
+        t0 = time.monotonic()
+        ws.send(heading_frame(seq, deci))
+        t1 = wait_for(fd, text, 2.0)
+        if t1 is None:
+            lost += 1
+            continue
+        e2e.append((t1 - t0) * 1e3)
+        # the ack for this position follows shortly (from the loop task)
+        end = time.monotonic() + 0.5
+        while time.monotonic() < end:
+            f = ws.recv(0.5)
+            if f and f[0] == ord('A'):
+                a_seq, wire_us = struct.unpack('<HI', f[2:8])
+                if a_seq == seq:
+                    device.append(wire_us / 1e3)
+                    break
+        time.sleep(random.uniform(0, 0.05))       # land anywhere in the tick
+
+    e2e.sort()
+    device.sort()
+    print('latency, %d positions (%d not seen on the UART):' % (args.count, lost))
+    for name, v in (('send -> UART', e2e), ('device ack', device)):
+        if v:
+            print('  %-13s p50 %7.2f  p90 %7.2f  p99 %7.2f  max %7.2f ms'
+                  % (name, percentile(v, 50), percentile(v, 90), percentile(v, 99), v[-1]))
+
+    # --- coalescing: far faster than the TX rate ---
+    before = urllib.request.urlopen(args.url + '/live/stats', timeout=5).read().decode()
+    sent = 0
+    t_end = time.monotonic() + args.flood_s
+    while time.monotonic() < t_end:
+        seq += 1
+        ws.send(heading_frame(seq, (seq * 7) % 3600))
+        sent += 1
+        time.sleep(1.0 / args.flood_hz)
+    time.sleep(0.3)
+    after = urllib.request.urlopen(args.url + '/live/stats', timeout=5).read().decode()
+
+    def field(text, name):
+        return int(text.split(name + '=')[1].split()[0])
+
+    applied = field(after, 'applied') - field(before, 'applied')
+    print('coalesce, %d positions in %.1f s: %d transmitted (%.1f/s), %d coalesced'
+          % (sent, args.flood_s, applied, applied / args.flood_s, sent - applied))
+
+    ws.send(b'R')
+    ws.close()
+
+
+if __name__ == '__main__':
+    main()
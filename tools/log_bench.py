@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""
+log_bench.py
+
+Check that a recorded log is replayed with its original timing: upload it
+to /logs, play it once, capture the UART and compare when each sentence
+started with when the log says it should.
+
+Works against a board (USB-TTL dongle on GPIO 4, AP at 192.168.4.1) or the
+host build (`.pio/build/native/program --realtime --fs <dir>`, pty path and
+port 8080).
+
+Without --log a test log is generated: --sentences lines with random gaps
+of 0 to 400 ms (0 = same burst), stamped with the time of day and starting
+just before midnight so the day wrap is crossed.  A given log is read with
+the same timestamp rules as the device (src/log_player.h), seconds or
+hh:mm:ss[.fff]; untimed lines are not supported here.
+
+Timing is judged on the sentences that find the line idle: a sentence
+due before the one ahead of it has left (at --baud) waits for it, and on
+the host pty such a burst arrives in one read, so those are only counted.
+Reports the timing error (actual minus logged start, relative to the
+first sentence) and the /logs counters.  With --max-error-ms the script
+exits non-zero if any sentence is missing or its |error| exceeds the
+limit.
+
+Usage:
+  tools/log_bench.py --port /dev/pts/3 --url http://127.0.0.1:8080
+  tools/log_bench.py --port /dev/ttyUSB0 --url http://192.168.4.1 \
+      --log seatrial.log --max-error-ms 10
+"""
+
+import argparse
+import os
+import random
+import re
+import sys
+import time
+import urllib.request
+
+from jitter_bench import BAUD, open_uart, percentile
+
+STAMP = re.compile(r'^[\s,;]*(?:.*?(\d{1,2}):(\d\d):(\d\d)(?:\.(\d+))?Z?|(\d+)(?:\.(\d+))?)[\s,;]*$')
+
+
+def checksum(body):
+    cs = 0
+    for c in body.encode():
+        cs ^= c
+    return '%02X' % cs
+
+
+def make_log(count):
+    lines, t = [], (23 * 3600 + 59 * 60 + 50) * 1000
+    for i in range(count):
+        body = 'HEHDT,%d.%d,T' % (i * 7 % 3600 // 10, i * 7 % 10)
+        ms = t % 86400000
+        lines.append('%02d:%02d:%02d.%03d $%s*%s' % (ms // 3600000, ms // 60000 % 60,
+                                                      ms // 1000 % 60, ms % 1000,
+                                                      body, checksum(body)))
+        t += random.choice((0, random.randrange(20, 400)))
+    return '\n'.join(lines) + '\n'
+
+
+def parse_log(text):
+    """[(ms relative to the first line, sentence)], as the device reads it."""
+    out, base, prev, day = [], None, None, 0
+    for line in text.splitlines():
+        i = min((line.find(c) for c in '$!' if c in line), default=-1)
+        if i < 0:
+            continue
+        m = STAMP.match(line[:i])
+        if not m:
+            continue
+        if m.group(1):
+            ms = ((int(m.group(1)) * 60 + int(m.group(2))) * 60 + int(m.group(3))) * 1000
+            ms += int((m.group(4) or '0')[:3].ljust(3, '0')) + day
+            if prev is not None and ms < prev:
+                day += 86400000
+                ms += 86400000
+        elif m.group(5):
+            ms = int(m.group(5)) * 1000 + int((m.group(6) or '0')[:3].ljust(3, '0'))
+        else:
+            raise SystemExit('untimed line: ' + line)
+        base = ms if base is None else base
+        rel = max(ms - base, out[-1][0] if out else 0)
+        prev = ms
+        out.append((rel, line[i:].rstrip()))
+    return out
+
+
+def request(url, data=b'', ctype='text/plain'):
+    req = urllib.request.Request(url, data=data, headers={'Content-Type': ctype})
+    with urllib.request.urlopen(req, timeout=30) as r:
+        return r.read().decode()
+
+
+def capture(fd, sentences, timeout):
+    """[(time the '$' arrived, line)] until the log has been seen."""
+    first, got, line, start = sentences[0], [], b'', None
+    end = time.monotonic() + timeout
+    while time.monotonic() < end and len(got) < len(sentences):
+        chunk = os.read(fd, 256)
+        now = time.monotonic()
+        for b in chunk:
+            if b == ord('$') or b == ord('!'):
+                start = now
+            line += bytes([b])
+            if b == ord('\n'):
+                text = line.decode(errors='replace').strip()
+                if got or text == first:
+                    got.append((start, text))
+                line = b''
+    return got
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('--port', required=True, help='UART device or pty path')
+    ap.add_argument('--baud', type=int, default=9600, choices=sorted(BAUD))
+    ap.add_argument('--url', default='http://192.168.4.1')
+    ap.add_argument('--log', help='log file to replay (default: generated)')
+    ap.add_argument('--name', default='bench')
+    ap.add_argument('--sentences', type=int, default=200)
+    ap.add_argument('--max-error-ms', type=float,
+                    help='fail if a sentence is missing or |error| exceeds this')
+    args = ap.parse_args()
+
+    text = open(args.log).read() if args.log else make_log(args.sentences)
+    log = parse_log(text)
+    if not log:
+        raise SystemExit('no timed sentences in the log')
+    print('log: %d sentences over %.1f s, %d bytes' % (len(log), log[-1][0] / 1000.0, len(text)))
+
+    fd = open_uart(args.port, args.baud)
+    t0 = time.monotonic()
+    request('%s/logs?name=%s' % (args.url, args.name), text.encode())
+    print('upload: %.0f ms' % ((time.monotonic() - t0) * 1e3))
+    request('%s/logs?play=%s&loop=0' % (args.url, args.name))
+    got = capture(fd, [s for _, s in log], log[-1][0] / 1000.0 + 10)
+    request('%s/logs?stop=1' % args.url)
+
+    errors, queued, matched, free = [], 0, 0, 0.0
+    for (rel, sentence), (at, seen) in zip(log, got):
+        if seen != sentence:
+            print('mismatch: expected %r, got %r' % (sentence, seen))
+            break
+        matched += 1
+        if rel < free:
+            queued += 1                  # behind the previous sentence
+        else:
+            errors.append((at - got[0][0]) * 1e3 - rel)
+        free = max(float(rel), free) + (len(sentence) + 2) * 10000.0 / args.baud
+    missing = len(log) - matched
+
+    mags = sorted(abs(e) for e in errors)
+    print('replayed %d/%d (%d queued behind another)  error p50 %.2f  p90 %.2f  p99 %.2f  '
+          'max %.2f ms  (last %+.2f ms)'
+          % (matched, len(log), queued, percentile(mags, 50), percentile(mags, 90),
+             percentile(mags, 99), mags[-1], errors[-1]) if errors else 'nothing replayed')
+    print('logs: ' + urllib.request.urlopen(args.url + '/logs', timeout=5).read()
+          .decode().splitlines()[0])
+
+    if args.max_error_ms is not None:
+        worst = mags[-1] if mags else float('inf')
+        ok = not missing and worst <= args.max_error_ms
+        print('%s: %d missing, max |error| %.2f ms, limit %.2f ms'
+              % ('PASS' if ok else 'FAIL', missing, worst, args.max_error_ms))
+        sys.exit(0 if ok else 1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""
+net_bench.py
+
+Check NMEA over Wi-Fi against the UART: several TCP clients on port 10110
+(plus, with --udp, a UDP listener) read the stream while the UART is
+captured, and one or more stalled clients connect and never read.
+
+Works against a board (USB-TTL dongle on GPIO 4, AP at 192.168.4.1) or the
+host build (`.pio/build/native/program --realtime`, pty path and port 8080).
+
+Reports, for each reading client, whether its bytes are an exact slice of
+the UART stream; the UART interval jitter over the run (a stalled client
+must not disturb it); and the /net counters, where every stalled client
+should show up in dropped_slow.  Stalled clients fill their TCP window
+sooner at a high output rate, so try --baud 115200 --rate 50.  With
+--max-jitter-ms the script exits non-zero when a stream differs, a stalled
+client was not dropped, or the p99 jitter exceeds the limit.
+
+Usage:
+  tools/net_bench.py --port /dev/ttyUSB0 --url http://192.168.4.1 --udp
+  tools/net_bench.py --port /dev/pts/3   --url http://127.0.0.1:8080 \
+      --baud 115200 --rate 50 --max-jitter-ms 2
+"""
+
+import argparse
+import os
+import socket
+import sys
+import threading
+import time
+import urllib.parse
+import urllib.request
+
+from jitter_bench import BAUD, open_uart, report, set_line
+
+
+def uart_reader(fd, stop, data, stamps):
+    while not stop.is_set():
+        chunk = os.read(fd, 256)
+        now = time.monotonic()
+        stamps.extend(now for b in chunk if b == ord('$'))
+        data.extend(chunk)
+
+
+def tcp_reader(sock, stop, data):
+    sock.settimeout(0.2)
+    while not stop.is_set():
+        try:
+            chunk = sock.recv(4096)
+        except socket.timeout:
+            continue
+        if not chunk:
+            break
+        data.extend(chunk)
+
+
+def udp_reader(sock, stop, data):
+    sock.settimeout(0.2)
+    while not stop.is_set():
+        try:
+            data.extend(sock.recv(2048))
+        except socket.timeout:
+            pass
+
+
+def net_stats(url):
+    text = urllib.request.urlopen(url + '/net', timeout=5).read().decode()
+    return dict(f.split('=') for f in text.split())
+
+
+def trim(data):
+    """From the first sentence start to the end of the last sentence."""
+    start = data.find(b'$')
+    end = data.rfind(b'\n')
+    return bytes(data[start:end + 1]) if start >= 0 and end > start else b''
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('--port', required=True, help='UART device or pty path')
+    ap.add_argument('--baud', type=int, default=9600, choices=sorted(BAUD))
+    ap.add_argument('--url', default='http://192.168.4.1')
+    ap.add_argument('--clients', type=int, default=3)
+    ap.add_argument('--stalled', type=int, default=1)
+    ap.add_argument('--udp', action='store_true', help='also enable and check UDP broadcast')
+    ap.add_argument('--seconds', type=float, default=10)
+    ap.add_argument('--interval-ms', type=float, default=100.0)
+    ap.add_argument('--rate', type=int, help='set output rate (Hz) and --baud first')
+    ap.add_argument('--max-jitter-ms', type=float,
+                    help='fail on a mismatch, an undropped stalled client or p99 |jitter| above this')
+    args = ap.parse_args()
+
+    if args.rate:
+        set_line(args.url, args.baud, args.rate)
+        args.interval_ms = 1000.0 / args.rate
+    host = urllib.parse.urlparse(args.url).hostname
+    before = net_stats(args.url)
+    urllib.request.urlopen(args.url + '/net?udp=%d' % args.udp, timeout=5).read()
+
+    stop = threading.Event()
+    uart, stamps = bytearray(), []
+    fd = open_uart(args.port, args.baud)
+    threads = [threading.Thread(target=uart_reader, args=(fd, stop, uart, stamps), daemon=True)]
+    threads[0].start()
+    time.sleep(0.5)                       # UART capture starts first
+
+    streams, stalled = [], []
+    for _ in range(args.clients):
+        data = bytearray()
+        s = socket.create_connection((host, 10110), timeout=5)
+        t = threading.Thread(target=tcp_reader, args=(s, stop, data), daemon=True)
+        t.start()
+        threads.append(t)
+        streams.append(('tcp', data))
+    for _ in range(args.stalled):
+        s = socket.socket()
+        s.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1024)
+        s.connect((host, 10110))
+        stalled.append(s)
+    if args.udp:
+        u = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        u.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        u.bind(('', 10110))
+        data = bytearray()
+        t = threading.Thread(target=udp_reader, args=(u, stop, data), daemon=True)
+        t.start()
+        streams.append(('udp', data))
+
+    time.sleep(args.seconds)
+    after = net_stats(args.url)
+    time.sleep(0.5)                       # let the UART catch up with the sockets
+    stop.set()
+    for t in threads[1:]:
+        t.join()
+
+    ok = True
+    ref = bytes(uart)
+    for i, (kind, data) in enumerate(streams):
+        body = trim(data)
+        same = len(body) > 0 and body in ref
+        ok &= same
+        print('%s client %d: %d bytes, %s' % (kind, i, len(data),
+                                              'identical to UART' if same else 'DIFFERS from UART'))
+
+    worst = report('uart', stamps, args.interval_ms)
+    dropped = int(after['dropped_slow']) - int(before['dropped_slow'])
+    print('stalled clients: %d connected, %d dropped' % (args.stalled, dropped))
+    print('net: ' + ' '.join('%s=%s' % kv for kv in after.items()))
+    ok &= dropped >= args.stalled
+
+    for s in stalled:
+        s.close()
+    if args.max_jitter_ms is not None:
+        ok &= worst <= args.max_jitter_ms
+        print('%s: p99 |jitter| %.2f ms, limit %.2f ms'
+              % ('PASS' if ok else 'FAIL', worst, args.max_jitter_ms))
+        sys.exit(0 if ok else 1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""
+page_bench.py
+
+Measure what the gzipped, cacheable pages save over plain HTML.
+
+For each page it issues N requests in three ways and reports bytes on the
+wire (headers included) and latency percentiles:
+
+  first   GET without validator           -> 200, gzip body
+  repeat  GET with If-None-Match: <ETag>  -> 304, no body
+  plain   the same page uncompressed, as the firmware used to send it
+          (size from decompressing the gzip body; transfer time scaled
+          from the measured gzip transfer at the same throughput)
+
+Works against a board (http://192.168.4.1) or the host build.
+
+Usage:
+  tools/page_bench.py --url http://192.168.4.1
+  tools/page_bench.py --url http://127.0.0.1:8080 --count 200
+"""
+
+import argparse
+import gzip
+import socket
+import time
+import urllib.parse
+
+PAGES = ['/', '/addfunction']
+
+
+def fetch(host, port, path, etag=None):
+    """Return (status, header bytes, body bytes, etag, seconds)."""
+    req = 'GET %s HTTP/1.1\r\nHost: %s\r\nAccept-Encoding: gzip\r\n' % (path, host)
+    if etag:
+        req += 'If-None-Match: %s\r\n' % etag
+    req += 'Connection: close\r\n\r\n'
+
+    t0 = time.monotonic()
+    s = socket.create_connection((host, port), timeout=10)
+    s.sendall(req.encode())
+    data = b''
+    while True:
+        chunk = s.recv(65536)
+        if not chunk:
+            break
+        data += chunk
+    s.close()
+    dt = time.monotonic() - t0
+
+    head, _, body = data.partition(b'\r\n\r\n')
+    lines = head.decode('latin-1').split('\r\n')
+    status = int(lines[0].split()[1])
+    tag = None
+    for line in lines[1:]:
+        name, _, value = line.partition(':')
+        if name.strip().lower() == 'etag':
+            tag = value.strip()
+    return status, len(head) + 4, body, tag, dt
+
+
+def pct(vals, p):
+    vals = sorted(vals)
+    return vals[min(len(vals) - 1, int(round(p / 100.0 * (len(vals) - 1))))]
+
+
+def row(name, status, nbytes, times):
+    print('  %-7s %3s  %6d bytes   p50 %6.2f  p95 %6.2f ms'
+          % (name, status, nbytes, pct(times, 50) * 1e3, pct(times, 95) * 1e3))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('--url', default='http://192.168.4.1')
+    ap.add_argument('--count', type=int, default=50)
+    args = ap.parse_args()
+
+    u = urllib.parse.urlparse(args.url)
+    host, port = u.hostname, u.port or 80
+
+    for path in PAGES:
+        status, head, body, etag, _ = fetch(host, port, path)
+        plain = len(gzip.decompress(body))
+
+        first = [fetch(host, port, path)[4] for _ in range(args.count)]
+        res = [fetch(host, port, path, etag) for _ in range(args.count)]
+        repeat = [r[4] for r in res]
+
+        gz_bytes = head + len(body)
+        plain_bytes = head - len('Content-Encoding: gzip\r\n') + plain
+        # Same connection overhead, body time scaled by size.
+        rtt = pct(repeat, 50)
+        scale = (plain_bytes / gz_bytes)
+        plain_times = [rtt + (t - rtt) * scale for t in first]
+
+        print('%s  (ETag %s)' % (path, etag))
+        row('plain*', 200, plain_bytes, plain_times)
+        row('first', status, gz_bytes, first)
+        row('repeat', res[0][0], res[0][1] + len(res[0][2]), repeat)
+        print('  saved: %d%% of the bytes on a first visit, %d%% on a repeat visit'
+              % (100 - 100 * gz_bytes // plain_bytes,
+                 100 - 100 * (res[0][1] + len(res[0][2])) // plain_bytes))
+    print('* estimated: not served any more; body time scaled from the gzip transfer')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,158 @@
+/*
+ * parse_bench.cpp
+ *
+ * Host benchmark: /update body parsing, String-based (the handler up to
+ * user-006) versus the streaming HeadingParser.  Reports time per body,
+ * heap allocations per body and peak heap in use while parsing.
+ *
+ * Build and run from the repository root:
+ *   g++ -std=gnu++17 -O2 -Ihost -Isrc tools/parse_bench.cpp \
+ *       src/heading_parser.cpp src/keyframes.cpp src/sequence.cpp src/nmea.cpp src/waveform.cpp \
+ *       -o /tmp/parse_bench && /tmp/parse_bench
+ */
+
+#include <Arduino.h>
+#include "heading_parser.h"
+
+#include <chrono>
+#include <malloc.h>
+#include <new>
+
+// ---------------------------------------------------------------------------
+// Heap accounting
+// ---------------------------------------------------------------------------
+
+static size_t heap_now   = 0;
+static size_t heap_peak  = 0;
+static size_t heap_allocs = 0;
+
+void* operator new(size_t n) {
+    void* p = malloc(n);
+    if (!p) throw std::bad_alloc();
+    heap_allocs++;
+    heap_now += malloc_usable_size(p);
+    if (heap_now > heap_peak) heap_peak = heap_now;
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    heap_now -= malloc_usable_size(p);
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+
+// ---------------------------------------------------------------------------
+// The two parsers
+// ---------------------------------------------------------------------------
+
+static float legacy_out[128];
+
+// Loop from the original apply_uploaded_sequence(), minus formatting.
+// The body is copied into a String first, as server.arg("plain") did.
+static size_t parse_legacy(const char* raw) {
+    String body(raw);
+    size_t count = 0;
+    int    start = 0;
+
+    while (count < 128) {
+        int    sep = body.indexOf(',', start);
+        String tok = (sep < 0) ? body.substring(start)
+                                : body.substring(start, sep);
+        tok.trim();
+        if (tok.length() == 0) break;
+
+        legacy_out[count++] = tok.toFloat();
+
+        if (sep < 0) break;
+        start = sep + 1;
+    }
+    return count;
+}
+
+static HeadingBuffer stream_out;
+static HeadingParser parser;
+
+// Fed in HTTP_RAW_BUFLEN-sized chunks like the WebServer raw callback.
+static size_t parse_streaming(const char* raw, size_t len) {
+    parser.begin(&stream_out);
+    for (size_t off = 0; off < len; off += 1436)
+        parser.feed(raw + off, len - off < 1436 ? len - off : 1436);
+    parser.finish();
+    return parser.count();
+}
+
+// ---------------------------------------------------------------------------
+
+struct Result {
+    double ns_per_body;
+    double allocs_per_body;
+    size_t peak_bytes;
+};
+
+template <typename F>
+static Result run(F fn, int iters) {
+    heap_allocs = 0;
+    heap_peak   = heap_now;
+    size_t base = heap_now;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++) fn();
+    auto t1 = std::chrono::steady_clock::now();
+
+    Result r;
+    r.ns_per_body     = std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+    r.allocs_per_body = (double)heap_allocs / iters;
+    r.peak_bytes      = heap_peak - base;
+    return r;
+}
+
+int main() {
+    // 125 headings as the web page sends them: "331.9,332.0,..."
+    char   body[1024];
+    size_t len = 0;
+    for (int i = 0; i < 125; i++)
+        len += snprintf(body + len, sizeof(body) - len, "%s%.1f", i ? "," : "",
+                        330.0 + 2.0 * sin(i * 0.05));
+
+    const int iters = 20000;
+    parse_streaming(body, len);          // let the output buffer reach its size
+    Result legacy = run([&] { parse_legacy(body); }, iters);
+    Result stream = run([&] { parse_streaming(body, len); }, iters);
+
+    printf("body: 125 values, %zu bytes, %d iterations\n\n", len, iters);
+    printf("%-12s %12s %14s %12s\n", "parser", "us/body", "allocs/body", "peak heap");
+    printf("%-12s %12.2f %14.1f %10zu B\n", "String", legacy.ns_per_body / 1e3,
+           legacy.allocs_per_body, legacy.peak_bytes);
+    printf("%-12s %12.2f %14.1f %10zu B\n", "streaming", stream.ns_per_body / 1e3,
+           stream.allocs_per_body, stream.peak_bytes);
+
+    // Both must send the same sentences: "%.1f" of the float against
+    // makeHDTFixed() of the deci-degrees.  Also with ties and negative
+    // zeros, which this body of "%.1f" values does not have.
+    static const char TIES[] = "10,20.25,30.35,-0.04,400,12.25,0.35,-359.65,-0,331.4500001";
+    const char*       bodies[] = { body, TIES };
+    for (const char* b : bodies) {
+        size_t n = parse_legacy(b);
+        if (parse_streaming(b, strlen(b)) != n) {
+            printf("MISMATCH: %zu vs %zu values\n", n, parser.count());
+            return 1;
+        }
+        for (size_t i = 0; i < n; i++) {
+            char want[24], got[24];
+            int16_t d = stream_out.data[i];
+            snprintf(want, sizeof(want), "%.1f", legacy_out[i]);
+            if (d == DECI_NEG_ZERO)
+                snprintf(got, sizeof(got), "-0.0");
+            else
+                snprintf(got, sizeof(got), "%s%d.%d", d < 0 ? "-" : "", abs(d) / 10, abs(d) % 10);
+            if (strcmp(want, got) != 0) {
+                printf("MISMATCH at %zu: %s vs %s\n", i, want, got);
+                return 1;
+            }
+        }
+    }
+    printf("\nsentences identical\n");
+    return 0;
+}
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""
+trace_dump.py
+
+Fetch the event trace from /trace in its binary form (src/trace.h) and
+print it as text, one event per line with the time relative to the dump,
+or convert it to Chrome trace JSON for chrome://tracing or Perfetto.
+
+The device can also produce the JSON itself (/trace?format=json); the
+binary dump is about a tenth of the size, so it is the one to keep from a
+rig.  A saved dump is read with --file.
+
+With --check the script also verifies the trace against the TX interval:
+sentence events of the sequence should be --interval-ms apart, and it
+exits non-zero if any gap differs by more than --max-gap-error-ms or a
+missed deadline was recorded.
+
+Usage:
+  tools/trace_dump.py --url http://192.168.4.1
+  tools/trace_dump.py --url http://192.168.4.1 --save rig.trace
+  tools/trace_dump.py --file rig.trace --json rig.json
+  tools/trace_dump.py --url http://127.0.0.1:8080 --check --interval-ms 100
+"""
+
+import argparse
+import json
+import struct
+import sys
+import urllib.request
+
+SENT, SWAP, HTTP_BEGIN, HTTP_END, LED, MISSED = range(1, 7)
+SOURCES = ('sequence', 'live', 'log')
+
+
+def parse(data):
+    """(dump time, route names, [(t_us, type, a, b, c)]) from a binary dump."""
+    if data[:4] != b'NMTR':
+        raise SystemExit('not a trace dump')
+    version, reclen, nroutes, dump_us = struct.unpack_from('<BBHI', data, 4)
+    if version != 1:
+        raise SystemExit('trace version %d not supported' % version)
+    pos, routes = 12, []
+    for _ in range(nroutes):
+        n = data[pos]
+        routes.append(data[pos + 1:pos + 1 + n].decode(errors='replace'))
+        pos += 1 + n
+    events = []
+    while pos + reclen <= len(data):
+        events.append(struct.unpack_from('<IBBHI', data, pos))
+        pos += reclen
+    return dump_us, routes, events
+
+
+def route(routes, a):
+    return routes[a] if a < len(routes) else '?'
+
+
+def describe(routes, ev):
+    _, ty, a, b, c = ev
+    if ty == SENT:
+        return 'sent      %-8s index %u, %u bytes' % (SOURCES[a] if a < 3 else '?', c, b)
+    if ty == SWAP:
+        return 'swap      %u entries' % c
+    if ty == HTTP_BEGIN:
+        return 'http >    %s (%u bytes)' % (route(routes, a), c)
+    if ty == HTTP_END:
+        return 'http <    %s %u us' % (route(routes, a), c)
+    if ty == LED:
+        return 'led       %s' % ('on' if a else 'off')
+    if ty == MISSED:
+        return 'missed    %u periods' % c
+    return 'type %u   %u %u %u' % (ty, a, b, c)
+
+
+def relative(dump_us, events):
+    """Times in µs before the dump, unwrapping micros()."""
+    out = []
+    for ev in events:
+        d = (dump_us - ev[0]) & 0xFFFFFFFF
+        out.append(-(d if d < 0x80000000 else d - 0x100000000))
+    return out
+
+
+def to_chrome(dump_us, routes, events):
+    tracks = ('nmea_tx', 'async_tcp', 'led')
+    out = [{'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': i + 1, 'args': {'name': n}}
+           for i, n in enumerate(tracks)]
+    for ts, (_, ty, a, b, c) in zip(relative(dump_us, events), events):
+        if ty == SENT:
+            out.append({'name': 'sent', 'ph': 'i', 's': 't', 'ts': ts, 'pid': 1, 'tid': 1,
+                        'args': {'index': c, 'bytes': b,
+                                 'from': SOURCES[a] if a < 3 else '?'}})
+        elif ty == SWAP:
+            out.append({'name': 'swap', 'ph': 'i', 's': 't', 'ts': ts, 'pid': 1, 'tid': 1,
+                        'args': {'entries': c}})
+        elif ty in (HTTP_BEGIN, HTTP_END):
+            e = {'name': route(routes, a), 'cat': 'http', 'ph': 'B' if ty == HTTP_BEGIN else 'E',
+                 'ts': ts, 'pid': 1, 'tid': 2}
+            if ty == HTTP_BEGIN:
+                e['args'] = {'content_length': c}
+            out.append(e)
+        elif ty == LED:
+            out.append({'name': 'led', 'ph': 'C', 'ts': ts, 'pid': 1, 'tid': 3, 'args': {'on': a}})
+        elif ty == MISSED:
+            out.append({'name': 'missed', 'ph': 'i', 's': 't', 'ts': ts, 'pid': 1, 'tid': 1,
+                        'args': {'periods': c}})
+    return {'displayTimeUnit': 'ms', 'traceEvents': out}
+
+
+def check(dump_us, events, interval_ms, max_error_ms):
+    times = relative(dump_us, events)
+    sent = [t for t, ev in zip(times, events) if ev[1] == SENT and ev[2] == 0]
+    missed = sum(ev[4] for ev in events if ev[1] == MISSED)
+    gaps = [(b - a) / 1000.0 for a, b in zip(sent, sent[1:])]
+    worst = max((abs(g - interval_ms) for g in gaps), default=0.0)
+    ok = bool(gaps) and worst <= max_error_ms and not missed
+    print('%s: %d sentence gaps, worst %.3f ms off %.0f ms, %d missed periods'
+          % ('PASS' if ok else 'FAIL', len(gaps), worst, interval_ms, missed))
+    return ok
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    src = ap.add_mutually_exclusive_group(required=True)
+    src.add_argument('--url', help='device, e.g. http://192.168.4.1')
+    src.add_argument('--file', help='saved binary dump')
+    ap.add_argument('--save', help='also write the binary dump here')
+    ap.add_argument('--json', help='write Chrome trace JSON here instead of printing')
+    ap.add_argument('--check', action='store_true', help='check sentence spacing')
+    ap.add_argument('--interval-ms', type=float, default=100.0)
+    ap.add_argument('--max-gap-error-ms', type=float, default=2.0)
+    args = ap.parse_args()
+
+    if args.url:
+        with urllib.request.urlopen(args.url + '/trace', timeout=10) as r:
+            data = r.read()
+    else:
+        data = open(args.file, 'rb').read()
+    if args.save:
+        open(args.save, 'wb').write(data)
+
+    dump_us, routes, events = parse(data)
+    if args.json:
+        json.dump(to_chrome(dump_us, routes, events), open(args.json, 'w'))
+        print('%d events -> %s' % (len(events), args.json))
+    elif not args.check:
+        for t, ev in zip(relative(dump_us, events), events):
+            print('%12.3f ms  %s' % (t / 1000.0, describe(routes, ev)))
+        print('%d events, %d bytes' % (len(events), len(data)))
+
+    if args.check:
+        sys.exit(0 if check(dump_us, events, args.interval_ms, args.max_gap_error_ms) else 1)
+
+
+if __name__ == '__main__':
+    main()
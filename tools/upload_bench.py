@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""
+upload_bench.py
+
+Compare the two /update body formats: CSV degrees ("328.9,329.0,...") and
+binary int16 little-endian deci-degrees with the 8-byte header (see
+src/heading_parser.h).
+
+Works against a board (AP at 192.168.4.1) or the host build
+(`.pio/build/native/program --realtime`, port 8080).
+
+For each sequence length (--sizes, default 125 and 10000) and format it
+posts new random headings --repeat times with swap=now and reports
+the body size and the time from starting the POST to its response, by
+which the table has been read and handed to the TX task.  With --port
+it also times each upload until its first sentence is on the UART (this
+includes the wait for the next TX tick, up to one interval).
+
+The sequence is put back to a short one at the end.
+
+Usage:
+  tools/upload_bench.py --url http://192.168.4.1
+  tools/upload_bench.py --url http://127.0.0.1:8080 --port /dev/pts/3 --repeat 20
+"""
+
+import argparse
+import os
+import random
+import struct
+import time
+import urllib.request
+
+from jitter_bench import open_uart, percentile
+
+MARKER = -32768
+
+
+def csv_body(deci):
+    return ','.join('%d.%d' % (d // 10, d % 10) for d in deci).encode()
+
+
+def bin_body(deci, interval_ms=0):
+    return struct.pack('<hHI', MARKER, interval_ms, len(deci)) + struct.pack('<%dh' % len(deci), *deci)
+
+
+def post(url, body, ctype):
+    req = urllib.request.Request(url + '/update?swap=now', data=body,
+                                 headers={'Content-Type': ctype})
+    with urllib.request.urlopen(req, timeout=30) as r:
+        text = r.read().decode()
+    if text != 'ok':
+        raise IOError('upload rejected: ' + text)
+
+
+def wait_for(fd, text, timeout):
+    """Time the sentence containing `text` was complete, or None."""
+    line = b''
+    end = time.monotonic() + timeout
+    while time.monotonic() < end:
+        for b in os.read(fd, 256):
+            line += bytes([b])
+            if b == ord('\n'):
+                if text in line:
+                    return time.monotonic()
+                line = b''
+    return None
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('--url', default='http://192.168.4.1')
+    ap.add_argument('--port', help='UART device (or host pty) to time the first sentence')
+    ap.add_argument('--baud', type=int, default=9600)
+    ap.add_argument('--sizes', default='125,10000')
+    ap.add_argument('--repeat', type=int, default=10)
+    args = ap.parse_args()
+
+    fd = open_uart(args.port, args.baud) if args.port else None
+    formats = (('csv', csv_body, 'text/plain'),
+               ('binary', bin_body, 'application/octet-stream'))
+
+    print('%-7s %-7s %8s  %-28s %s' % ('entries', 'format', 'bytes', 'POST -> ok (ms)',
+                                       'POST -> first sentence (ms)' if fd else ''))
+    run = 0
+    for n in (int(s) for s in args.sizes.split(',')):
+        for name, make, ctype in formats:
+            posted, active = [], []
+            size = 0
+            for _ in range(args.repeat):
+                # The first heading (350.0 .. 359.9) is one the sequence
+                # running before cannot contain, so its sentence marks the
+                # switch-over.
+                mark = 3500 + (run % 100)
+                run += 1
+                deci = [mark] + [random.randrange(3500) for _ in range(n - 1)]
+                body = make(deci)
+                size = len(body)
+                first = ('$HEHDT,%d.%d,' % (mark // 10, mark % 10)).encode()
+                time.sleep(random.uniform(0, 0.1))     # land anywhere in the tick
+                t0 = time.monotonic()
+                post(args.url, body, ctype)
+                posted.append((time.monotonic() - t0) * 1e3)
+                if fd is not None:
+                    t1 = wait_for(fd, first, 3.0)
+                    if t1 is not None:
+                        active.append((t1 - t0) * 1e3)
+            posted.sort()
+            active.sort()
+            col = 'p50 %7.2f  p90 %7.2f' % (percentile(posted, 50), percentile(posted, 90))
+            if active:
+                col += '       p50 %7.2f  p90 %7.2f' % (percentile(active, 50),
+                                                        percentile(active, 90))
+            print('%-7d %-7s %8d  %s' % (n, name, size, col))
+
+    post(args.url, bin_body([3300, 3305, 3310, 3305]), 'application/octet-stream')
+
+
+if __name__ == '__main__':
+    main()